@@ -0,0 +1,149 @@
+// analog.c
+#include "analog.h"
+#include "players.h"
+
+// Every stage of a config is folded into lookup tables, rebuilt only when
+// the config (or the device's own deadzone) changes. An axis then takes a
+// single load, a stick with a radial stage one more per stick.
+typedef struct
+{
+  analog_config_t config;
+  uint8_t device_deadzone; // of the input the tables were built for
+  bool has_radial;
+  uint8_t stick[256];   // per-axis stage, 0 (axis not sent) stays 0
+  uint8_t trigger[256];
+  uint16_t radial[ANALOG_RADIAL_STEPS]; // Q8 gain by squared radius
+} analog_tables_t;
+
+static analog_tables_t analog_tables[MAX_PLAYERS];
+
+static uint32_t isqrt(uint32_t value)
+{
+  uint32_t root = 0;
+  for (uint32_t bit = 1u << 14; bit; bit >>= 1)
+  {
+    if ((root | bit) * (root | bit) <= value) root |= bit;
+  }
+  return root;
+}
+
+// deadzone, response curve and anti-deadzone of a magnitude in [0, full]
+static uint32_t shape(uint32_t mag, uint32_t full, uint32_t deadzone, uint32_t anti_deadzone, uint32_t curve)
+{
+  if (deadzone >= full) return 0;
+  if (mag < deadzone) return 0;
+  mag = (mag - deadzone) * full / (full - deadzone);
+
+  uint32_t cubic = mag * mag / full * mag / full;
+  mag = (mag * (255 - curve) + cubic * curve) / 255;
+
+  if (mag && anti_deadzone < full) mag = anti_deadzone + mag * (full - anti_deadzone) / full;
+  return mag;
+}
+
+static void build_tables(analog_tables_t* tables)
+{
+  analog_config_t const* config = &tables->config;
+  uint8_t deadzone = config->deadzone > tables->device_deadzone ? config->deadzone : tables->device_deadzone;
+  uint8_t out_min = config->out_min ? config->out_min : 1;
+  uint8_t out_max = config->out_max ? config->out_max : 255;
+  if (out_min > 128) out_min = 128;
+  if (out_max < 128) out_max = 128;
+
+  // radial deadzone and circle correction scale the stick as a whole
+  tables->has_radial = config->radial || config->circle;
+  uint8_t axial_deadzone = config->radial ? 0 : deadzone;
+  uint8_t radial_deadzone = config->radial ? deadzone : 0;
+
+  for (uint32_t step = 0; step < ANALOG_RADIAL_STEPS; step++)
+  {
+    uint32_t radius = isqrt((step << ANALOG_RADIAL_SHIFT) + (1 << (ANALOG_RADIAL_SHIFT - 1)));
+    uint32_t gain = 256;
+
+    if (radius)
+    {
+      uint32_t scaled = radius;
+      if (radial_deadzone) scaled = shape(radius < 127 ? radius : 127, 127, radial_deadzone, 0, 0);
+      if (config->circle && scaled > 127) scaled = 127;
+      if (!config->circle && radius > 127) scaled += radius - 127; // corners pass
+      gain = scaled * 256 / radius;
+    }
+    tables->radial[step] = gain;
+  }
+
+  tables->stick[0] = 0;
+  for (uint32_t value = 1; value < 256; value++)
+  {
+    uint32_t mag = value < 128 ? 128 - value : value - 128;
+    if (mag > 127) mag = 127;
+    mag = shape(mag, 127, axial_deadzone, config->anti_deadzone, config->curve);
+
+    // output range around the center
+    if (value < 128) tables->stick[value] = 128 - mag * (128 - out_min) / 127;
+    else tables->stick[value] = 128 + mag * (out_max - 128) / 127;
+  }
+
+  for (uint32_t value = 0; value < 256; value++)
+  {
+    tables->trigger[value] = shape(value, 255, config->trigger_deadzone, 0, config->curve);
+  }
+}
+
+// every player starts with the pass-through config
+void analog_init(void)
+{
+  for (int i = 0; i < MAX_PLAYERS; i++)
+  {
+    analog_tables[i] = (analog_tables_t){ 0 };
+    build_tables(&analog_tables[i]);
+  }
+}
+
+// sets a player's config and rebuilds its tables
+void analog_set_config(int player_index, const analog_config_t* config)
+{
+  if (player_index < 0 || player_index >= MAX_PLAYERS) return;
+
+  analog_tables[player_index].config = *config;
+  build_tables(&analog_tables[player_index]);
+}
+
+// scales a stick around its center by the radial gain
+static void __not_in_flash_func(apply_radial)(analog_tables_t const* tables, uint8_t* x, uint8_t* y)
+{
+  if (!*x || !*y) return;
+
+  int32_t dx = (int32_t)*x - 128;
+  int32_t dy = (int32_t)*y - 128;
+  uint32_t gain = tables->radial[(uint32_t)(dx * dx + dy * dy) >> ANALOG_RADIAL_SHIFT];
+
+  dx = (dx * (int32_t)gain) >> 8;
+  dy = (dy * (int32_t)gain) >> 8;
+  *x = 128 + (dx < -127 ? -127 : dx > 127 ? 127 : dx);
+  *y = 128 + (dy < -127 ? -127 : dy > 127 ? 127 : dy);
+}
+
+// conditions the axes of an input routed to a player
+void __not_in_flash_func(analog_apply)(int player_index, input_state_t* input)
+{
+  analog_tables_t* tables = &analog_tables[player_index];
+
+  if (input->deadzone != tables->device_deadzone)
+  {
+    tables->device_deadzone = input->deadzone;
+    build_tables(tables);
+  }
+
+  if (tables->has_radial)
+  {
+    apply_radial(tables, &input->analog_1x, &input->analog_1y);
+    apply_radial(tables, &input->analog_2x, &input->analog_2y);
+  }
+
+  input->analog_1x = tables->stick[input->analog_1x];
+  input->analog_1y = tables->stick[input->analog_1y];
+  input->analog_2x = tables->stick[input->analog_2x];
+  input->analog_2y = tables->stick[input->analog_2y];
+  input->analog_l = tables->trigger[input->analog_l];
+  input->analog_r = tables->trigger[input->analog_r];
+}
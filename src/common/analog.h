@@ -0,0 +1,32 @@
+// analog.h
+
+#ifndef ANALOG_H
+#define ANALOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "input.h"
+
+// squared stick radius steps of the radial table (radius^2 >> 6)
+#define ANALOG_RADIAL_SHIFT 6
+#define ANALOG_RADIAL_STEPS (((2 * 127 * 127) >> ANALOG_RADIAL_SHIFT) + 1)
+
+// Conditioning of one player's axes, in 8-bit axis units (128 centered).
+// The zero config passes axes through unchanged.
+typedef struct
+{
+  uint8_t deadzone;         // stick offset (radius when radial) sent as centered
+  uint8_t anti_deadzone;    // smallest stick offset sent outside the deadzone
+  uint8_t curve;            // response, 0 linear .. 255 cubic
+  uint8_t trigger_deadzone; // trigger travel sent as released
+  uint8_t out_min;          // stick output range, 0 for the full range
+  uint8_t out_max;
+  bool radial;              // deadzone on the stick radius instead of each axis
+  bool circle;              // square-to-circle, diagonals clamped to the full radius
+} analog_config_t;
+
+void analog_init(void);
+void analog_set_config(int player_index, const analog_config_t* config);
+void __not_in_flash_func(analog_apply)(int player_index, input_state_t* input);
+
+#endif // ANALOG_H
@@ -12,13 +12,14 @@ unsigned char fun_player = 1;
 // shift button state into buffer and scan for matching codes
 void codes_task()
 {
-  int32_t btns = (~players[0].output_buttons & 0xffff);
-  int32_t prev_btns = (~players[0].prev_buttons & 0xffff);
+  Player_t* player = &players[players_root()];
+  int32_t btns = (~player->output_buttons & 0xffff);
+  int32_t prev_btns = (~player->prev_buttons & 0xffff);
 
   // Stash previous buttons to detect release
   if (!btns || btns != prev_btns)
   {
-    players[0].prev_buttons = players[0].output_buttons;
+    player->prev_buttons = player->output_buttons;
   }
 
   // Check if code has been entered
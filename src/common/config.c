@@ -0,0 +1,200 @@
+// config.c
+#include <string.h>
+#include "config.h"
+#include "flash_store.h"
+#include "bsp/board_api.h"
+
+// The log takes two sectors. The active one starts with a header record
+// (higher sequence wins) followed by key/value records appended as settings
+// change; the last record of a key holds its value. When the active sector
+// fills up, the current values move to the other sector, which was erased
+// at boot, so only page programs ever happen while a console is polling.
+// Filling both sectors in one session waits for an idle console to erase.
+
+#define CONFIG_SECTORS 2
+#define CONFIG_RECORDS (FLASH_SECTOR_SIZE / sizeof(config_record_t))
+#define CONFIG_PAGE_RECORDS (FLASH_PAGE_SIZE / sizeof(config_record_t))
+#define CONFIG_KEY_HEADER 0xfffe // value is the sector sequence
+#define CONFIG_KEY_ERASED 0xffff
+
+// changes are saved once settings stop changing for this long
+#define CONFIG_SAVE_DELAY_MS 1000
+
+typedef struct
+{
+  uint16_t key;
+  uint16_t check;
+  uint32_t value;
+} config_record_t;
+
+static volatile uint32_t values[CONFIG_KEY_COUNT]; // live, set from either core
+static uint32_t seen[CONFIG_KEY_COUNT];            // values at the last check
+static uint32_t saved[CONFIG_KEY_COUNT];           // values the log holds
+static uint32_t changed_ms = 0;
+
+static uint8_t active = 0;        // sector holding the log
+static uint32_t sequence = 0;     // of the active sector
+static uint16_t next_record = 0;  // first erased record of the active sector
+static bool spare_erased = false; // other sector ready to take the log
+
+static uint16_t record_check(uint16_t key, uint32_t value)
+{
+  return (uint16_t)(0x5a5a ^ key ^ value ^ (value >> 16));
+}
+
+static uint32_t sector_offset(uint8_t sector)
+{
+  return FLASH_STORE_CONFIG_OFFSET + sector * FLASH_SECTOR_SIZE;
+}
+
+static const config_record_t* sector_records(uint8_t sector)
+{
+  return (const config_record_t*)flash_store_sector(sector_offset(sector));
+}
+
+static bool record_valid(const config_record_t* record)
+{
+  return record->check == record_check(record->key, record->value);
+}
+
+// programs records into one page of the active sector, starting at first
+static void program_records(uint8_t sector, uint16_t first, const config_record_t* records, uint16_t count)
+{
+  static uint8_t page[FLASH_PAGE_SIZE] __attribute__((aligned(4)));
+  uint16_t page_first = first - (first % CONFIG_PAGE_RECORDS);
+
+  memset(page, 0xff, sizeof(page));
+  memcpy(page + (first - page_first) * sizeof(config_record_t), records, count * sizeof(config_record_t));
+  flash_store_program(sector_offset(sector) + page_first * sizeof(config_record_t), page);
+}
+
+// starts a new log in an erased sector with every current value
+static void start_sector(uint8_t sector, uint32_t new_sequence)
+{
+  config_record_t records[CONFIG_KEY_COUNT];
+  for (uint8_t key = 0; key < CONFIG_KEY_COUNT; key++)
+  {
+    records[key] = (config_record_t){ key, record_check(key, seen[key]), seen[key] };
+  }
+
+  // values first, header last, so a torn write leaves the old sector in charge
+  config_record_t header = { CONFIG_KEY_HEADER, record_check(CONFIG_KEY_HEADER, new_sequence), new_sequence };
+  program_records(sector, 1, records, CONFIG_KEY_COUNT);
+  program_records(sector, 0, &header, 1);
+
+  active = sector;
+  sequence = new_sequence;
+  next_record = 1 + CONFIG_KEY_COUNT;
+  memcpy(saved, seen, sizeof(saved));
+}
+
+// replays the log into ram. runs on core0 before core1 starts, so the
+// erases that are only ever done here cannot disturb a console.
+void config_init(void)
+{
+  memset((void*)values, 0, sizeof(values));
+
+  // newest valid sector
+  bool found = false;
+  for (uint8_t sector = 0; sector < CONFIG_SECTORS; sector++)
+  {
+    const config_record_t* header = sector_records(sector);
+    if (header->key != CONFIG_KEY_HEADER || !record_valid(header)) continue;
+    if (!found || header->value > sequence)
+    {
+      found = true;
+      active = sector;
+      sequence = header->value;
+    }
+  }
+
+  if (found)
+  {
+    const config_record_t* records = sector_records(active);
+    for (next_record = 1; next_record < CONFIG_RECORDS; next_record++)
+    {
+      const config_record_t* record = &records[next_record];
+      if (record->key == CONFIG_KEY_ERASED) break;
+
+      // torn records are skipped
+      if (record->key < CONFIG_KEY_COUNT && record_valid(record)) values[record->key] = record->value;
+    }
+  }
+
+  memcpy(seen, (const void*)values, sizeof(seen));
+  memcpy(saved, seen, sizeof(saved));
+
+  if (!found)
+  {
+    if (!flash_store_erased(sector_offset(0), FLASH_SECTOR_SIZE)) flash_store_erase(sector_offset(0));
+    start_sector(0, 1);
+  }
+
+  uint8_t spare = active ^ 1;
+  if (!flash_store_erased(sector_offset(spare), FLASH_SECTOR_SIZE)) flash_store_erase(sector_offset(spare));
+  spare_erased = true;
+}
+
+uint32_t __not_in_flash_func(config_get)(uint8_t key)
+{
+  return key < CONFIG_KEY_COUNT ? values[key] : 0;
+}
+
+// single word store, safe from either core. core0 picks the change up.
+void __not_in_flash_func(config_set)(uint8_t key, uint32_t value)
+{
+  if (key < CONFIG_KEY_COUNT) values[key] = value;
+}
+
+// saves settled changes, at most one page program per call, between polls
+void config_task(void)
+{
+  uint32_t now_ms = board_millis();
+
+  for (uint8_t key = 0; key < CONFIG_KEY_COUNT; key++)
+  {
+    if (seen[key] != values[key])
+    {
+      seen[key] = values[key];
+      changed_ms = now_ms;
+    }
+  }
+
+  if (!memcmp(seen, saved, sizeof(saved))) return;
+  if (now_ms - changed_ms < CONFIG_SAVE_DELAY_MS) return;
+
+  if (next_record == CONFIG_RECORDS)
+  {
+    // active sector is full, move to the spare one. a spare used up since
+    // boot is only erased while the console is not polling.
+    if (!spare_erased)
+    {
+      if (!flash_store_window(FLASH_STORE_ERASE_US)) return;
+
+      flash_store_erase(sector_offset(active ^ 1));
+      spare_erased = true;
+      return;
+    }
+    if (!flash_store_window(2 * FLASH_STORE_PROGRAM_US)) return;
+
+    spare_erased = false;
+    start_sector(active ^ 1, sequence + 1);
+    return;
+  }
+
+  if (!flash_store_window(FLASH_STORE_PROGRAM_US)) return;
+
+  // changed keys that fit the rest of the current page
+  config_record_t records[CONFIG_PAGE_RECORDS];
+  uint16_t room = CONFIG_PAGE_RECORDS - (next_record % CONFIG_PAGE_RECORDS);
+  uint16_t count = 0;
+  for (uint8_t key = 0; key < CONFIG_KEY_COUNT && count < room; key++)
+  {
+    if (seen[key] == saved[key]) continue;
+    records[count++] = (config_record_t){ key, record_check(key, seen[key]), seen[key] };
+    saved[key] = seen[key];
+  }
+
+  program_records(active, next_record, records, count);
+  next_record += count;
+}
@@ -0,0 +1,21 @@
+// config.h
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+// Persistent settings. Keys are stored in flash, never renumber them.
+#define CONFIG_KEY_BUTTON_MODE 0x00 // + player slot (8 slots reserved)
+#define CONFIG_KEY_TURBO       0x08 // pce turbo speed, 0 slow 1 fast
+#define CONFIG_KEY_MOUSE_SWAP  0x09 // mouse buttons swapped
+#define CONFIG_KEY_MOUSE_CURVE 0x0a // mouse sensitivity/acceleration curve
+#define CONFIG_KEY_COUNT       0x0b
+
+void config_init(void);
+uint32_t __not_in_flash_func(config_get)(uint8_t key);
+void __not_in_flash_func(config_set)(uint8_t key, uint32_t value);
+void config_task(void);
+
+#endif // CONFIG_H
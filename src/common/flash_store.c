@@ -0,0 +1,94 @@
+// flash_store.c
+#include "flash_store.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+
+// polls closer than this belong to the same frame (nuon reads several
+// packets per frame), a frame's polling is over once this passes without one
+#define FLASH_STORE_QUIET_US  1000
+// a write may start this long after a frame's polling ended
+#define FLASH_STORE_WINDOW_US 500
+// headroom left before the next poll is expected
+#define FLASH_STORE_MARGIN_US 500
+// without polls for this long, the console is not reading the controller
+#define FLASH_STORE_IDLE_US   100000
+
+static volatile uint32_t poll_us = 0;     // first poll of the last frame
+static volatile uint32_t poll_gap_us = 0; // time between the first polls of the last two frames
+static volatile uint32_t last_us = 0;     // last poll answered by core1
+
+// memory mapped contents of a flash sector
+const uint8_t* flash_store_sector(uint32_t offset)
+{
+  return (const uint8_t*)(XIP_BASE + offset);
+}
+
+// whether a flash range reads back erased
+bool flash_store_erased(uint32_t offset, uint32_t len)
+{
+  const uint32_t* words = (const uint32_t*)flash_store_sector(offset);
+  for (uint32_t i = 0; i < len / 4; i++)
+  {
+    if (words[i] != 0xffffffff) return false;
+  }
+  return true;
+}
+
+// XIP is unavailable while flash is busy, so core1 is parked in ram (it
+// registers as a lockout victim in core1_entry) and interrupts stay off.
+// before core1 runs there is nothing to park.
+static uint32_t flash_begin(void)
+{
+  if (multicore_lockout_victim_is_initialized(1)) multicore_lockout_start_blocking();
+  return save_and_disable_interrupts();
+}
+
+static void flash_end(uint32_t ints)
+{
+  restore_interrupts(ints);
+  if (multicore_lockout_victim_is_initialized(1)) multicore_lockout_end_blocking();
+}
+
+// erases one sector, roughly 50ms
+void flash_store_erase(uint32_t offset)
+{
+  uint32_t ints = flash_begin();
+  flash_range_erase(offset, FLASH_SECTOR_SIZE);
+  flash_end(ints);
+}
+
+// programs one page. bytes left 0xff keep what the page already holds, so
+// records can be appended to a partly written page.
+void flash_store_program(uint32_t offset, const uint8_t* page)
+{
+  uint32_t ints = flash_begin();
+  flash_range_program(offset, page, FLASH_PAGE_SIZE);
+  flash_end(ints);
+}
+
+// called right after a console poll is answered
+void __not_in_flash_func(flash_store_poll)(void)
+{
+  uint32_t now_us = time_us_32();
+  if (now_us - last_us > FLASH_STORE_QUIET_US)
+  {
+    poll_gap_us = now_us - poll_us;
+    poll_us = now_us;
+  }
+  last_us = now_us;
+}
+
+// Whether flash may be busy for busy_us now without core1 missing a poll:
+// the console is idle, or the last frame's polling just ended and the
+// frames so far leave room for the write before the next one starts.
+bool flash_store_window(uint32_t busy_us)
+{
+  uint32_t now_us = time_us_32();
+  uint32_t quiet_us = now_us - last_us;
+  if (quiet_us > FLASH_STORE_IDLE_US) return true;
+
+  return quiet_us > FLASH_STORE_QUIET_US &&
+         quiet_us < FLASH_STORE_QUIET_US + FLASH_STORE_WINDOW_US &&
+         poll_gap_us > (now_us - poll_us) + busy_us + FLASH_STORE_MARGIN_US;
+}
@@ -0,0 +1,29 @@
+// flash_store.h
+#ifndef FLASH_STORE_H
+#define FLASH_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+// persistent data lives in the last sectors of flash, well past the program
+#define FLASH_STORE_HID_CACHE_OFFSET (PICO_FLASH_SIZE_BYTES - 2 * FLASH_SECTOR_SIZE) // 2 sectors
+#define FLASH_STORE_CONFIG_OFFSET    (PICO_FLASH_SIZE_BYTES - 4 * FLASH_SECTOR_SIZE) // 2 sectors
+
+// worst case time flash stays busy (core1 parked, interrupts off)
+#define FLASH_STORE_PROGRAM_US 1000  // one page
+#define FLASH_STORE_ERASE_US   50000 // one sector
+
+const uint8_t* flash_store_sector(uint32_t offset);
+bool flash_store_erased(uint32_t offset, uint32_t len);
+void flash_store_erase(uint32_t offset);
+void flash_store_program(uint32_t offset, const uint8_t* page);
+
+// console timing: each console poll answered is reported (core1, or the
+// xb1 i2c irq on core0), and core0 only keeps flash busy inside the gap
+// that follows a frame's polling
+void __not_in_flash_func(flash_store_poll)(void);
+bool flash_store_window(uint32_t busy_us);
+
+#endif // FLASH_STORE_H
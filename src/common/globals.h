@@ -4,10 +4,12 @@
 
 #include "codes.h"
 #include "players.h"
+#include "input.h"
 
-#define MAX_DEVICES 6
+// tables indexed by dev_addr, 1..CFG_TUH_DEVICE_MAX (hubs take the addresses above)
+#define MAX_DEVICES (CFG_TUH_DEVICE_MAX + 1)
 
-// handles state of multi-player inputs
+// player output changed since the last published frame (core0 only)
 bool update_pending;
 
 // GameCube rumble and keyboard LED states
@@ -19,30 +21,8 @@ bool is_fun;
 unsigned char fun_inc;
 unsigned char fun_player;
 
-// common console response for controller data
-void __not_in_flash_func(post_globals)(
-  uint8_t dev_addr,
-  int8_t instance,
-  uint32_t buttons,
-  uint8_t analog_1x,
-  uint8_t analog_1y,
-  uint8_t analog_2x,
-  uint8_t analog_2y,
-  uint8_t analog_l,
-  uint8_t analog_r,
-  uint32_t keys,
-  uint8_t quad_x
-);
-
-// common console response for mouse data
-void __not_in_flash_func(post_mouse_globals)(
-  uint8_t dev_addr,
-  int8_t instance,
-  uint16_t buttons,
-  uint8_t delta_x,
-  uint8_t delta_y,
-  uint8_t spinner
-);
+// console specific output encoding
+void __not_in_flash_func(update_output)(void);
 
 int __not_in_flash_func(find_player_index)(int dev_addr, int instance);
 int __not_in_flash_func(add_player)(int dev_addr, int instance);
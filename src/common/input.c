@@ -0,0 +1,90 @@
+// input.c
+
+#include "input.h"
+#include "globals.h"
+#include "latency.h"
+#include "analog.h"
+#include "mouse.h"
+
+//
+// post_input - routes device input to its player slot, accumulates the
+//              state shared by every console, then hands off to the
+//              console's encode_input
+//
+void __not_in_flash_func(post_input)(const input_state_t* input)
+{
+  uint32_t input_us = latency_report_time();
+  latency_record(input->dev_addr, LATENCY_DECODE, input_us);
+
+  // for merging extra device instances into the root instance (ex: joycon charging grip)
+  bool is_extra = (input->instance == -1);
+  int8_t instance = is_extra ? 0 : input->instance;
+
+  int player_index = find_player_index(input->dev_addr, instance);
+  uint16_t buttons_pressed = input->is_mouse ?
+    (~(input->buttons | 0x0f00)) : ((~(input->buttons | 0x0800)) || input->keys);
+  if (player_index < 0 && buttons_pressed)
+  {
+    printf("[add player] [%d, %d]\n", input->dev_addr, instance);
+    player_index = add_player(input->dev_addr, instance);
+  }
+
+  // printf("[player_index] [%d] [%d, %d]\n", player_index, input->dev_addr, instance);
+
+  if (player_index < 0) return;
+
+  Player_t* player = &players[player_index];
+  player->input_us = input_us;
+  player->is_mouse = input->is_mouse;
+
+  // deadzones, response curve and output range of the player's axes
+  input_state_t conditioned;
+  if (!input->is_mouse)
+  {
+    conditioned = *input;
+    analog_apply(player_index, &conditioned);
+    input = &conditioned;
+  }
+
+  if (input->is_mouse)
+  {
+    player->global_buttons = input->buttons;
+
+    // accumulate the many intermediate mouse scans (~1ms), scaled by the
+    // selected curve. Player_t is packed, so through aligned locals
+    int16_t global_x = player->global_x;
+    int16_t global_y = player->global_y;
+    mouse_apply(player_index, input->delta_x, input->delta_y, &global_x, &global_y);
+    player->global_x = global_x;
+    player->global_y = global_y;
+  }
+  else
+  {
+    // extra instance buttons to merge with root player
+    if (is_extra)
+    {
+      player->altern_buttons = input->buttons;
+    }
+    else
+    {
+      player->global_buttons = input->buttons;
+    }
+
+    // cache analog and key values to player object
+    if (input->analog_1x) player->output_analog_1x = input->analog_1x;
+    if (input->analog_1y) player->output_analog_1y = input->analog_1y;
+    if (input->analog_2x) player->output_analog_2x = input->analog_2x;
+    if (input->analog_2y) player->output_analog_2y = input->analog_2y;
+    player->output_analog_l = input->analog_l;
+    player->output_analog_r = input->analog_r;
+
+    player->keypress[0] = (input->keys) & 0xff;
+    player->keypress[1] = (input->keys >> 8) & 0xff;
+    player->keypress[2] = (input->keys >> 16) & 0xff;
+  }
+
+  encode_input(player_index, input);
+
+  latency_record(input->dev_addr, LATENCY_MAP, input_us);
+  latency_hotkey(input->buttons);
+}
@@ -0,0 +1,39 @@
+// input.h
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tusb.h"
+
+// Normalized input posted by every device driver
+typedef struct
+{
+  uint8_t dev_addr;
+  int8_t instance;    // -1 merges into the root instance (ex: joycon charging grip)
+  bool is_mouse;
+
+  uint32_t buttons;   // active low
+  uint8_t analog_1x;
+  uint8_t analog_1y;
+  uint8_t analog_2x;
+  uint8_t analog_2y;
+  uint8_t analog_l;
+  uint8_t analog_r;
+  uint32_t keys;
+  uint8_t quad_x;
+  uint8_t deadzone;   // stick deadzone the device needs (axis units), 0 none
+
+  // mouse relative movement (two's complement)
+  uint8_t delta_x;
+  uint8_t delta_y;
+} input_state_t;
+
+// Function declarations
+void __not_in_flash_func(post_input)(const input_state_t* input);
+
+// console specific mapping/encoding of routed input into players[player_index]
+void __not_in_flash_func(encode_input)(int player_index, const input_state_t* input);
+
+#endif // INPUT_H
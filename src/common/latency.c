@@ -0,0 +1,126 @@
+// latency.c
+
+#include "latency.h"
+#include "globals.h"
+#include "pico/stdlib.h"
+
+// wire stage is only written by core1, all other stages by core0
+static uint32_t histograms[MAX_DEVICES][LATENCY_STAGES][LATENCY_BUCKETS];
+static uint32_t loop_histogram[LATENCY_BUCKETS]; // main loop pass (core0)
+static uint64_t core1_busy_us = 0;               // core1 time spent working
+static uint64_t core1_idle_us = 0;               // core1 time spent asleep
+
+static uint32_t report_us = 0;                 // arrival of report being processed
+static uint32_t published_us[MAX_PLAYERS];     // core0: last input published per slot
+static uint32_t sent_us[MAX_PLAYERS];          // core1: last input sent per slot
+static bool hotkey_held = false;
+
+static const char* stage_names[LATENCY_STAGES] = { "decode", "map", "publish", "wire" };
+
+// stamp arrival of a usb report (call first thing in report callbacks)
+void __not_in_flash_func(latency_report_received)(void)
+{
+  report_us = time_us_32();
+
+  // never 0, which marks a player without input
+  if (!report_us) report_us = 1;
+}
+
+uint32_t __not_in_flash_func(latency_report_time)(void)
+{
+  return report_us;
+}
+
+static inline int latency_bucket(uint32_t elapsed)
+{
+  int bucket = elapsed ? 32 - __builtin_clz(elapsed) : 0;
+  return (bucket >= LATENCY_BUCKETS) ? LATENCY_BUCKETS - 1 : bucket;
+}
+
+// add the time since input_us to a device's stage histogram
+void __not_in_flash_func(latency_record)(uint8_t dev_addr, latency_stage_t stage, uint32_t input_us)
+{
+  if (!input_us || dev_addr >= MAX_DEVICES) return;
+
+  histograms[dev_addr][stage][latency_bucket(time_us_32() - input_us)]++;
+}
+
+// add the busy time of one main loop pass
+void __not_in_flash_func(latency_loop)(uint32_t elapsed_us)
+{
+  loop_histogram[latency_bucket(elapsed_us)]++;
+}
+
+// (core1) add time spent working and asleep waiting for the console
+void __not_in_flash_func(latency_core1)(uint32_t busy_us, uint32_t idle_us)
+{
+  core1_busy_us += busy_us;
+  core1_idle_us += idle_us;
+}
+
+// (core0) record players whose newest input made it into a frame
+void __not_in_flash_func(latency_publish)(players_frame_t const* frame)
+{
+  for (int i = 0; i < MAX_PLAYERS; ++i)
+  {
+    player_output_t const* out = &frame->players[i];
+    if (out->input_us == published_us[i]) continue;
+
+    published_us[i] = out->input_us;
+    latency_record(out->dev_addr, LATENCY_PUBLISH, out->input_us);
+  }
+}
+
+// (core1) record players whose newest input was just sent to the console
+void __not_in_flash_func(latency_wire)(players_frame_t const* frame)
+{
+  for (int i = 0; i < MAX_PLAYERS; ++i)
+  {
+    player_output_t const* out = &frame->players[i];
+    if (out->input_us == sent_us[i]) continue;
+
+    sent_us[i] = out->input_us;
+    latency_record(out->dev_addr, LATENCY_WIRE, out->input_us);
+  }
+}
+
+// dump histograms when HOME + SELECT are pressed together
+void latency_hotkey(uint32_t buttons)
+{
+  bool pressed = !(buttons & 0x0440);
+  if (pressed && !hotkey_held) latency_dump();
+  hotkey_held = pressed;
+}
+
+// print all non-empty histograms over UART
+void latency_dump(void)
+{
+  printf("[latency] us buckets: <1");
+  for (int b = 1; b < LATENCY_BUCKETS; ++b) printf(" <%d", 1 << b);
+  printf("+\n");
+
+  printf("[latency] loop        :");
+  for (int b = 0; b < LATENCY_BUCKETS; ++b) printf(" %lu", (unsigned long)loop_histogram[b]);
+  printf("\n");
+
+  uint64_t core1_us = core1_busy_us + core1_idle_us;
+  if (core1_us)
+  {
+    printf("[latency] core1 busy  : %lu%% of %lu ms\n",
+      (unsigned long)(core1_busy_us * 100 / core1_us), (unsigned long)(core1_us / 1000));
+  }
+
+  for (int dev = 1; dev < MAX_DEVICES; ++dev)
+  {
+    for (int stage = 0; stage < LATENCY_STAGES; ++stage)
+    {
+      uint32_t total = 0;
+      for (int b = 0; b < LATENCY_BUCKETS; ++b) total += histograms[dev][stage][b];
+      if (!total) continue;
+
+      printf("[latency] dev %d %-7s:", dev, stage_names[stage]);
+      for (int b = 0; b < LATENCY_BUCKETS; ++b) printf(" %lu", (unsigned long)histograms[dev][stage][b]);
+      printf("\n");
+    }
+  }
+}
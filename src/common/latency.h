@@ -0,0 +1,34 @@
+// latency.h
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include "tusb.h"
+#include "players.h"
+
+// Per-device input latency histograms, measured from report arrival.
+// Buckets are log2 microseconds: bucket n holds [2^(n-1), 2^n) us.
+#define LATENCY_BUCKETS 16
+
+typedef enum
+{
+  LATENCY_DECODE = 0, // arrival -> driver posts input
+  LATENCY_MAP,        // arrival -> console encode done
+  LATENCY_PUBLISH,    // arrival -> frame published to core1
+  LATENCY_WIRE,       // arrival -> first sent to the console
+  LATENCY_STAGES
+} latency_stage_t;
+
+// Function declarations
+void __not_in_flash_func(latency_report_received)(void);
+uint32_t __not_in_flash_func(latency_report_time)(void);
+void __not_in_flash_func(latency_record)(uint8_t dev_addr, latency_stage_t stage, uint32_t input_us);
+void __not_in_flash_func(latency_publish)(players_frame_t const* frame);
+void __not_in_flash_func(latency_wire)(players_frame_t const* frame);
+void __not_in_flash_func(latency_loop)(uint32_t elapsed_us);
+void __not_in_flash_func(latency_core1)(uint32_t busy_us, uint32_t idle_us);
+void latency_hotkey(uint32_t buttons);
+void latency_dump(void);
+
+#endif // LATENCY_H
@@ -0,0 +1,94 @@
+// mouse.c
+#include "mouse.h"
+#include "config.h"
+#include "players.h"
+
+static const mouse_curve_t mouse_curves[MOUSE_CURVES] = {
+  { 256, 0,  0    }, // linear
+  { 384, 0,  0    }, // linear, faster
+  { 256, 16, 1024 }, // accelerated, up to 4x
+  { 192, 32, 1536 }, // precise when slow, up to 6x
+};
+
+// Q8 gain of each report speed for the selected curve
+static uint16_t gain_table[MOUSE_SPEED_STEPS];
+static uint16_t base = 256;
+static uint8_t curve_built = 0xff;
+
+// Q8 motion not yet sent as whole counts, per player and axis. carrying it
+// to the next report keeps slow movement from being rounded away.
+static int32_t remainder_x[MAX_PLAYERS];
+static int32_t remainder_y[MAX_PLAYERS];
+
+static void build_table(uint8_t curve_index)
+{
+  mouse_curve_t const* curve = &mouse_curves[curve_index];
+
+  for (uint32_t speed = 0; speed < MOUSE_SPEED_STEPS; speed++)
+  {
+    uint32_t gain = curve->sensitivity + curve->accel * speed;
+    if (curve->max_gain && gain > curve->max_gain) gain = curve->max_gain;
+
+    gain = gain * base / 256;
+    gain_table[speed] = gain > 0xffff ? 0xffff : gain;
+  }
+
+  curve_built = curve_index;
+}
+
+// base_gain: Q8 gain of the linear curve on this console
+void mouse_init(uint16_t base_gain)
+{
+  base = base_gain;
+  curve_built = 0xff;
+
+  for (int i = 0; i < MAX_PLAYERS; i++) mouse_reset(i);
+}
+
+// selects (and saves) the next curve
+void mouse_next_curve(void)
+{
+  uint32_t curve = config_get(CONFIG_KEY_MOUSE_CURVE);
+  config_set(CONFIG_KEY_MOUSE_CURVE, (curve + 1) % MOUSE_CURVES);
+}
+
+// drops a player's fractional motion (new occupant of the slot)
+void mouse_reset(int player_index)
+{
+  if (player_index < 0 || player_index >= MAX_PLAYERS) return;
+
+  remainder_x[player_index] = 0;
+  remainder_y[player_index] = 0;
+}
+
+// adds a saturated delta to an accumulator
+static inline int16_t add_motion(int16_t global, int32_t delta)
+{
+  int32_t sum = global + delta;
+  return sum < -32767 ? -32767 : sum > 32767 ? 32767 : sum;
+}
+
+// scales one report's motion by the curve and adds it to the accumulators
+void __not_in_flash_func(mouse_apply)(int player_index, uint8_t delta_x, uint8_t delta_y, int16_t* global_x, int16_t* global_y)
+{
+  uint32_t curve = config_get(CONFIG_KEY_MOUSE_CURVE);
+  if (curve >= MOUSE_CURVES) curve = 0;
+  if (curve != curve_built) build_table(curve);
+
+  int32_t dx = (int8_t)delta_x;
+  int32_t dy = (int8_t)delta_y;
+  uint32_t speed = dx < 0 ? -dx : dx;
+  uint32_t speed_y = dy < 0 ? -dy : dy;
+  if (speed_y > speed) speed = speed_y;
+  if (speed >= MOUSE_SPEED_STEPS) speed = MOUSE_SPEED_STEPS - 1;
+
+  int32_t gain = gain_table[speed];
+  int32_t x = dx * gain + remainder_x[player_index];
+  int32_t y = dy * gain + remainder_y[player_index];
+
+  // whole counts go out, the fraction (always 0..255) stays
+  remainder_x[player_index] = x & 0xff;
+  remainder_y[player_index] = y & 0xff;
+  *global_x = add_motion(*global_x, x >> 8);
+  *global_y = add_motion(*global_y, y >> 8);
+}
@@ -0,0 +1,36 @@
+// mouse.h
+
+#ifndef MOUSE_H
+#define MOUSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tusb.h"
+
+// Q8 gain of the linear curve, consoles may redefine it
+#ifndef MOUSE_BASE_GAIN
+#define MOUSE_BASE_GAIN 256
+#endif
+
+// report speeds (counts on the faster axis) the gain table covers, faster
+// reports use the last step
+#define MOUSE_SPEED_STEPS 128
+
+// selectable curves (CONFIG_KEY_MOUSE_CURVE)
+#define MOUSE_CURVES 4
+
+// Scaling of relative motion, gains in Q8 (256 is 1.0) relative to the
+// console's base gain.
+typedef struct
+{
+  uint16_t sensitivity; // gain of slow motion
+  uint16_t accel;       // gain added per count of report speed
+  uint16_t max_gain;    // gain cap with acceleration, 0 for no cap
+} mouse_curve_t;
+
+void mouse_init(uint16_t base_gain);
+void mouse_next_curve(void);
+void mouse_reset(int player_index);
+void __not_in_flash_func(mouse_apply)(int player_index, uint8_t delta_x, uint8_t delta_y, int16_t* global_x, int16_t* global_y);
+
+#endif // MOUSE_H
@@ -2,10 +2,35 @@
 
 #include "players.h"
 #include "globals.h"
+#include <string.h>
+#include "hardware/sync.h"
+#include "trace.h"
+#include "latency.h"
+#include "config.h"
+#include "mouse.h"
+
+#ifdef CONFIG_NGC
+extern gc_report_t gc_report;
+#endif
+#ifdef CONFIG_PCE
+extern uint32_t timer_threshold;
+#endif
 
 // Definition of global variables
 int playersCount = 0;
 
+// core0 -> core1 frame double buffer (seqlock)
+static players_frame_t frames[2];
+static volatile uint32_t frame_seq = 0;
+
+// relative motion delivered by core1 (written by core1 only)
+static volatile int32_t consumed_x[MAX_PLAYERS];
+static volatile int32_t consumed_y[MAX_PLAYERS];
+
+// consumed motion already subtracted from players[] (core0 only)
+static int32_t applied_x[MAX_PLAYERS];
+static int32_t applied_y[MAX_PLAYERS];
+
 // Used to set the LEDs on the controllers
 const uint8_t PLAYER_LEDS[] = {
   0x00, // OFF
@@ -21,101 +46,303 @@ const uint8_t PLAYER_LEDS[] = {
   0x0F, // LED10 1111
 };
 
+// slot of each (dev_addr, instance), -1 when unassigned
+static int8_t slot_index[MAX_DEVICES][CFG_TUH_HID];
+
+// bit per unoccupied players[] slot
+static uint32_t free_slots = 0;
+
+// put a slot back to its unoccupied defaults
+static void __not_in_flash_func(player_reset)(int i)
+{
+  players[i].dev_addr = 0;
+  players[i].instance = 0;
+  players[i].player_number = 0;
+  players[i].is_mouse = false;
+#ifdef CONFIG_NGC
+  players[i].gc_report = default_gc_report;
+#endif
+#ifdef CONFIG_NUON
+  players[i].global_buttons = 0x80;
+  players[i].altern_buttons = 0x80;
+  players[i].output_buttons = 0x80;
+  players[i].output_buttons_alt = 0x80;
+  players[i].output_quad_x = 0;
+#else
+  players[i].global_buttons = 0xFFFFF;
+  players[i].altern_buttons = 0xFFFFF;
+  players[i].output_buttons = 0xFFFFF;
+#endif
+  players[i].global_x = 0;
+  players[i].global_y = 0;
+  players[i].output_analog_1x = 128;
+  players[i].output_analog_1y = 128;
+  players[i].output_analog_2x = 128;
+  players[i].output_analog_2y = 128;
+  players[i].output_analog_l = 0;
+  players[i].output_analog_r = 0;
+  players[i].keypress[0] = 0;
+  players[i].keypress[1] = 0;
+  players[i].keypress[2] = 0;
+  players[i].prev_buttons = 0xFFFFF;
+  players[i].button_mode = config_get(CONFIG_KEY_BUTTON_MODE + i);
+  players[i].input_us = 0;
+}
+
 // init data structure for multi-player management
 void players_init()
 {
+  memset(slot_index, -1, sizeof(slot_index));
+
   unsigned short int i;
   for (i = 0; i < MAX_PLAYERS; ++i)
   {
-#ifdef CONFIG_NGC
-    players[i].gc_report = default_gc_report;
-#elif CONFIG_NUON
-    players[i].global_buttons = 0x80;
-    players[i].altern_buttons = 0x80;
-    players[i].output_buttons = 0x80;
-    players[i].output_buttons_alt = 0x80;
-    players[i].output_quad_x = 0;
-#else
-    players[i].global_buttons = 0xFFFFF;
-    players[i].altern_buttons = 0xFFFFF;
-    players[i].output_buttons = 0xFFFFF;
-#endif
-    players[i].global_x = 0;
-    players[i].global_y = 0;
-    players[i].output_analog_1x = 128;
-    players[i].output_analog_1y = 128;
-    players[i].output_analog_2x = 128;
-    players[i].output_analog_2y = 128;
-    players[i].output_analog_l = 0;
-    players[i].output_analog_r = 0;
-    players[i].prev_buttons = 0xFFFFF;
-    players[i].button_mode = 0;
+    player_reset(i);
   }
+  free_slots = (1u << MAX_PLAYERS) - 1;
+  playersCount = 0;
+
+  players_publish();
 }
 
 // Function to find a player in the array based on their dev_addr and instance.
 int __not_in_flash_func(find_player_index)(int dev_addr, int instance)
 {
-  for(int i = 0; i < playersCount; i++)
-  {
-    if(players[i].dev_addr == dev_addr && players[i].instance == instance)
-    {
-      return i;
-    }
-  }
-  // If we reached here, the player was not found.
-  return -1;
+  if (dev_addr < 0 || dev_addr >= MAX_DEVICES) return -1;
+  if (instance < 0 || instance >= CFG_TUH_HID) return -1;
+
+  return slot_index[dev_addr][instance];
 }
 
-// Function to add a player to the players array.
+// lowest occupied slot, the player single-port consoles output
+int __not_in_flash_func(players_root)(void)
+{
+  uint32_t occupied = ~free_slots & ((1u << MAX_PLAYERS) - 1);
+  return occupied ? __builtin_ctz(occupied) : 0;
+}
+
+// Function to add a player to the lowest free slot. Slots stay put until
+// their device is removed, so player numbers survive other unplugs.
 int __not_in_flash_func(add_player)(int dev_addr, int instance)
 {
-    if(playersCount == MAX_PLAYERS) return -1;
+  if (!free_slots) return -1;
+  if (dev_addr < 0 || dev_addr >= MAX_DEVICES) return -1;
+  if (instance < 0 || instance >= CFG_TUH_HID) return -1;
 
-    players[playersCount].dev_addr = dev_addr;
-    players[playersCount].instance = instance;
-    players[playersCount].player_number = playersCount + 1;
+  int i = __builtin_ctz(free_slots);
+  free_slots &= ~(1u << i);
 
-    players[playersCount].global_buttons = 0xFFFFF;
-    players[playersCount].altern_buttons = 0xFFFFF;
-    players[playersCount].global_x = 0;
-    players[playersCount].global_y = 0;
+  player_reset(i);
+  players[i].dev_addr = dev_addr;
+  players[i].instance = instance;
+  players[i].player_number = i + 1;
+  mouse_reset(i);
+  players[i].global_buttons = 0xFFFFF;
+  players[i].altern_buttons = 0xFFFFF;
+  players[i].output_buttons = 0xFFFFF;
+  players[i].output_analog_1x = 0;
+  players[i].output_analog_1y = 0;
 
-    players[playersCount].output_buttons = 0xFFFFF;
-    players[playersCount].output_analog_1x = 0;
-    players[playersCount].output_analog_1y = 0;
-    players[playersCount].button_mode = 0;
-    players[playersCount].prev_buttons = 0xFFFFF;
+  slot_index[dev_addr][instance] = i;
+  playersCount++;
+  return i; // returns player_index
+}
 
-    playersCount++;
-    return playersCount-1; // returns player_index
+// free one player slot without disturbing the others
+static void remove_player(int i)
+{
+  slot_index[players[i].dev_addr][players[i].instance] = -1;
+  player_reset(i);
+  free_slots |= (1u << i);
+  playersCount--;
+
+  // drop any motion core1 consumed against the old occupant
+  applied_x[i] = consumed_x[i];
+  applied_y[i] = consumed_y[i];
 }
 
-// Function to remove all players with a certain dev_addr and shift the remaining players.
+// Function to remove all players with a certain dev_addr (instance -1)
+// or the single player at (dev_addr, instance).
 void remove_players_by_address(int dev_addr, int instance)
 {
-  int i = 0;
-  while(i < playersCount)
+  if (instance == -1)
   {
-    // -1 instance removes all instances within dev_addr
-    if((players[i].dev_addr == dev_addr && instance == -1) ||
-       (players[i].dev_addr == dev_addr && players[i].instance == instance))
+    for (int i = 0; i < MAX_PLAYERS; i++)
     {
-      // Shift all the players after this one up in the array
-      for(int j = i; j < playersCount - 1; j++)
+      if (!(free_slots & (1u << i)) && players[i].dev_addr == dev_addr)
       {
-        players[j] = players[j+1];
+        remove_player(i);
       }
-      // Decrement playersCount because a player was removed
-      playersCount--;
-    } else {
-      i++;
     }
   }
+  else
+  {
+    int i = find_player_index(dev_addr, instance);
+    if (i < 0) return;
+    remove_player(i);
+  }
+
+  update_pending = true;
+}
+
+//
+// players_publish - (core0) copies player output state into the back frame
+//                   and makes it current. never waits on core1.
+//
+void __not_in_flash_func(players_publish)(void)
+{
+  uint32_t seq = frame_seq + 1;
+  players_frame_t* frame = &frames[seq & 1];
+
+  frame->seq = seq;
+  frame->count = playersCount;
+  frame->root = players_root();
+  for (int i = 0; i < MAX_PLAYERS; ++i)
+  {
+    player_output_t* out = &frame->players[i];
+    out->dev_addr = players[i].dev_addr;
+    out->input_us = players[i].input_us;
+    out->output_buttons = players[i].output_buttons;
+    out->output_analog_1x = players[i].output_analog_1x;
+    out->output_analog_1y = players[i].output_analog_1y;
+    out->output_analog_2x = players[i].output_analog_2x;
+    out->output_analog_2y = players[i].output_analog_2y;
+    out->output_analog_l = players[i].output_analog_l;
+    out->output_analog_r = players[i].output_analog_r;
+    out->global_x = players[i].global_x;
+    out->global_y = players[i].global_y;
+    out->keypress[0] = players[i].keypress[0];
+    out->keypress[1] = players[i].keypress[1];
+    out->keypress[2] = players[i].keypress[2];
+    out->button_mode = players[i].button_mode;
+    out->is_mouse = players[i].is_mouse;
+#ifdef CONFIG_NUON
+    out->output_buttons_alt = players[i].output_buttons_alt;
+    out->output_quad_x = players[i].output_quad_x;
+#endif
+    frame->applied_x[i] = applied_x[i];
+    frame->applied_y[i] = applied_y[i];
+  }
+#ifdef CONFIG_NGC
+  frame->gc_report = gc_report;
+#endif
+#ifdef CONFIG_PCE
+  frame->turbo_threshold = timer_threshold;
+#endif
+
+  // frame contents must land before the sequence that exposes them
+  __dmb();
+  frame_seq = seq;
+
+  // wake core1 if it sleeps between console polls
+  __sev();
+
+  latency_publish(frame);
+
+#ifdef CONFIG_REPORT_TRACE
+  trace_frame(frame);
+#endif
+}
+
+//
+// players_snapshot - (core1) copies the current frame if it is newer than
+//                    the one held. a copy torn by a concurrent publish is
+//                    retried once, after which the held frame is kept.
+//                    returns true when frame was updated.
+//
+bool __not_in_flash_func(players_snapshot)(players_frame_t* frame)
+{
+  players_frame_t copy;
+
+  for (int tries = 0; tries < 2; ++tries)
+  {
+    uint32_t seq = frame_seq;
+    if (seq == frame->seq) return false;
+
+    __dmb();
+    copy = frames[seq & 1];
+    __dmb();
+
+    // publisher started on our half while copying
+    if (frame_seq != seq || copy.seq != seq) continue;
+
+    // fold in motion consumed since core0 last applied it
+    for (int i = 0; i < MAX_PLAYERS; ++i)
+    {
+      copy.players[i].global_x -= (int16_t)(consumed_x[i] - copy.applied_x[i]);
+      copy.players[i].global_y -= (int16_t)(consumed_y[i] - copy.applied_y[i]);
+    }
+
+    *frame = copy;
+    return true;
+  }
+
+  return false;
+}
+
+//
+// players_consume - (core1) records relative motion delivered to the console
+//
+void __not_in_flash_func(players_consume)(players_frame_t* frame, int player_index, int16_t delta_x, int16_t delta_y)
+{
+  consumed_x[player_index] += delta_x;
+  consumed_y[player_index] += delta_y;
+
+  frame->players[player_index].global_x -= delta_x;
+  frame->players[player_index].global_y -= delta_y;
+
+  // wake core0 to fold it back in
+  __sev();
+}
+
+// subtract motion consumed by core1 from the player accumulators
+static bool __not_in_flash_func(players_apply_consumed)(void)
+{
+  bool changed = false;
+
+  for (int i = 0; i < MAX_PLAYERS; ++i)
+  {
+    int32_t cx = consumed_x[i];
+    int32_t cy = consumed_y[i];
+    int16_t dx = (int16_t)(cx - applied_x[i]);
+    int16_t dy = (int16_t)(cy - applied_y[i]);
+
+    if (!dx && !dy) continue;
+
+    players[i].global_x -= dx;
+    players[i].global_y -= dy;
+    applied_x[i] = cx;
+    applied_y[i] = cy;
+
+#ifndef CONFIG_PCE
+    // mouse movement is sent as a one-shot stick deflection
+    if (dx) players[i].output_analog_1x = 128;
+    if (dy) players[i].output_analog_1y = 128;
+#endif
+    changed = true;
+  }
+
+  return changed;
+}
+
+//
+// players_task - (core0) applies consumed motion and publishes a new
+//                frame whenever player output state has changed
+//
+void __not_in_flash_func(players_task)(void)
+{
+  if (players_apply_consumed())
+  {
+#ifdef CONFIG_PCE
+    update_pending = true;
+#else
+    update_output();
+#endif
+  }
 
-  // Update the player numbers
-  for(i = 0; i < playersCount; i++)
+  if (update_pending)
   {
-    players[i].player_number = i + 1;
+    update_pending = false;
+    players_publish();
   }
 }
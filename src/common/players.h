@@ -9,8 +9,11 @@
 #include "lib/joybus-pio/include/gamecube_definitions.h"
 #endif
 
-#ifndef MAX_PLAYERS
-#define MAX_PLAYERS 5
+// player slots, set once per console so every file sizes frames alike
+#ifdef CONFIG_PCE
+#define MAX_PLAYERS 5 // PCE multitap
+#else
+#define MAX_PLAYERS 4
 #endif
 
 // Define constants
@@ -38,6 +41,8 @@ typedef struct TU_ATTR_PACKED
   int32_t prev_buttons;
 
   int button_mode;
+  bool is_mouse;
+  uint32_t input_us; // arrival time of the newest report (latency)
 #ifdef CONFIG_NGC
   gc_report_t gc_report;
 #elif CONFIG_NUON
@@ -46,6 +51,54 @@ typedef struct TU_ATTR_PACKED
 #endif
 } Player_t;
 
+// Per-player output state handed from core0 to core1
+typedef struct
+{
+  uint8_t dev_addr;
+  uint32_t input_us;
+
+  int32_t output_buttons;
+  int16_t output_analog_1x;
+  int16_t output_analog_1y;
+  int16_t output_analog_2x;
+  int16_t output_analog_2y;
+  int16_t output_analog_l;
+  int16_t output_analog_r;
+
+  // relative (mouse) motion not yet delivered to the console
+  int16_t global_x;
+  int16_t global_y;
+
+  uint8_t keypress[3];
+
+  int button_mode;
+  bool is_mouse;
+#ifdef CONFIG_NUON
+  int32_t output_buttons_alt;
+  int16_t output_quad_x;
+#endif
+} player_output_t;
+
+// Versioned frame of every player's output state. core0 publishes frames
+// into one half of a double buffer while core1 copies out of the other.
+typedef struct
+{
+  uint32_t seq;
+  int count; // occupied slots, which may have holes between them
+  int root;  // lowest occupied slot, the player single-port consoles output
+  player_output_t players[MAX_PLAYERS];
+
+  // consumed motion already folded into global_x/global_y by core0
+  int32_t applied_x[MAX_PLAYERS];
+  int32_t applied_y[MAX_PLAYERS];
+#ifdef CONFIG_NGC
+  gc_report_t gc_report;
+#endif
+#ifdef CONFIG_PCE
+  uint32_t turbo_threshold; // frames per turbo toggle
+#endif
+} players_frame_t;
+
 // Declaration of global variables
 Player_t players[MAX_PLAYERS];
 int playersCount;
@@ -54,8 +107,15 @@ int playersCount;
 const uint8_t PLAYER_LEDS[11];
 
 // Function declarations
+void players_init(void);
 int __not_in_flash_func(find_player_index)(int dev_addr, int instance);
 int __not_in_flash_func(add_player)(int dev_addr, int instance);
 void remove_players_by_address(int dev_addr, int instance);
+int __not_in_flash_func(players_root)(void);
+
+void __not_in_flash_func(players_publish)(void);
+bool __not_in_flash_func(players_snapshot)(players_frame_t* frame);
+void __not_in_flash_func(players_consume)(players_frame_t* frame, int player_index, int16_t delta_x, int16_t delta_y);
+void __not_in_flash_func(players_task)(void);
 
 #endif // PLAYERS_H
@@ -0,0 +1,78 @@
+// remap.c
+#include <string.h>
+#include "remap.h"
+
+// console output bits of each canonical button, set once by the console
+static uint32_t remap_targets[REMAP_BUTTONS];
+
+// per player, the canonical button each physical button acts as
+static uint8_t remap_sources[MAX_PLAYERS][REMAP_BUTTONS];
+
+static remap_table_t remap_tables[MAX_PLAYERS];
+
+// output bits of the pressed (low) buttons among count bits of value
+static uint32_t compile_entry(const uint8_t* sources, uint32_t value, int count)
+{
+  uint32_t pressed = 0;
+  for (int bit = 0; bit < count; bit++)
+  {
+    if (!(value & (1 << bit))) pressed |= remap_targets[sources[bit]];
+  }
+  return pressed;
+}
+
+static void compile_table(int player_index)
+{
+  const uint8_t* sources = remap_sources[player_index];
+  remap_table_t* table = &remap_tables[player_index];
+
+  for (uint32_t value = 0; value < 256; value++)
+  {
+    table->lo[value] = compile_entry(&sources[0], value, 8);
+    table->mid[value] = compile_entry(&sources[8], value, 8);
+  }
+  for (uint32_t value = 0; value < 4; value++)
+  {
+    table->hi[value] = compile_entry(&sources[16], value, 2);
+  }
+}
+
+// sets the console mapping and gives every player the default layout
+void remap_init(const uint32_t targets[REMAP_BUTTONS])
+{
+  memcpy(remap_targets, targets, sizeof(remap_targets));
+
+  for (int i = 0; i < MAX_PLAYERS; i++) remap_clear(i);
+}
+
+// makes button act as the canonical button source for a player
+void remap_set(int player_index, uint8_t button, uint8_t source)
+{
+  if (player_index < 0 || player_index >= MAX_PLAYERS) return;
+  if (button >= REMAP_BUTTONS || source >= REMAP_BUTTONS) return;
+
+  remap_sources[player_index][button] = source;
+  compile_table(player_index);
+}
+
+// back to the console's default layout
+void remap_clear(int player_index)
+{
+  if (player_index < 0 || player_index >= MAX_PLAYERS) return;
+
+  for (uint8_t button = 0; button < REMAP_BUTTONS; button++)
+  {
+    remap_sources[player_index][button] = button;
+  }
+  compile_table(player_index);
+}
+
+// console output bits pressed in a canonical (active low) button word
+uint32_t __not_in_flash_func(remap_buttons)(int player_index, uint32_t buttons)
+{
+  const remap_table_t* table = &remap_tables[player_index];
+
+  return table->lo[buttons & 0xff] |
+         table->mid[(buttons >> 8) & 0xff] |
+         table->hi[(buttons >> 16) & 0x03];
+}
@@ -0,0 +1,28 @@
+// remap.h
+
+#ifndef REMAP_H
+#define REMAP_H
+
+#include <stdint.h>
+#include "tusb.h"
+#include "players.h"
+
+// buttons in the canonical (active low) button word
+#define REMAP_BUTTONS 18
+
+// Compiled remap of one player. Each table is indexed by one byte of the
+// canonical button word and holds the console output bits pressed by it,
+// so a whole word maps with three lookups.
+typedef struct
+{
+  uint32_t lo[256];  // buttons 0-7
+  uint32_t mid[256]; // buttons 8-15
+  uint32_t hi[4];    // buttons 16-17
+} remap_table_t;
+
+void remap_init(const uint32_t targets[REMAP_BUTTONS]);
+void remap_set(int player_index, uint8_t button, uint8_t source);
+void remap_clear(int player_index);
+uint32_t __not_in_flash_func(remap_buttons)(int player_index, uint32_t buttons);
+
+#endif // REMAP_H
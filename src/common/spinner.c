@@ -0,0 +1,75 @@
+// spinner.c
+#include "spinner.h"
+
+// atan(2^-i) in 1/SPINNER_TURN turns
+static const uint16_t cordic_atan[] = {
+  8192, 4836, 2555, 1297, 651, 326, 163, 81, 41, 20, 10, 5, 3, 1
+};
+
+// Angle of (x, y) in 1/SPINNER_TURN turns, counter-clockwise from +x. A
+// CORDIC rotates the vector onto the x axis with shifts and adds only,
+// summing the angles it turned through.
+uint16_t __not_in_flash_func(spinner_atan2)(int32_t y, int32_t x)
+{
+  uint16_t angle = 0;
+
+  // rotate into the right half plane, where the iterations converge
+  if (x < 0)
+  {
+    x = -x;
+    y = -y;
+    angle = SPINNER_TURN / 2;
+  }
+
+  // headroom for the fractional shifts (inputs are 16-bit)
+  x *= 256;
+  y *= 256;
+
+  for (uint8_t i = 0; i < sizeof(cordic_atan) / sizeof(cordic_atan[0]); i++)
+  {
+    int32_t dx = x >> i;
+    int32_t dy = y >> i;
+    if (y > 0)
+    {
+      x += dy;
+      y -= dx;
+      angle += cordic_atan[i];
+    }
+    else
+    {
+      x -= dy;
+      y += dx;
+      angle -= cordic_atan[i];
+    }
+  }
+
+  return angle;
+}
+
+// change of an absolute source since its last sample, 0 for the first
+int32_t __not_in_flash_func(spinner_follow)(spinner_t* spinner, int32_t sample)
+{
+  int32_t delta = spinner->tracking ? sample - spinner->last : 0;
+  spinner->last = sample;
+  spinner->tracking = true;
+  return delta;
+}
+
+// source let go, its next sample starts over without a jump
+void spinner_release(spinner_t* spinner)
+{
+  spinner->tracking = false;
+}
+
+// turns by substeps (clamped to +-limit when limit is set), returns quad_x
+uint8_t __not_in_flash_func(spinner_move)(spinner_t* spinner, int32_t substeps, int32_t limit)
+{
+  if (limit)
+  {
+    if (substeps > limit) substeps = limit;
+    if (substeps < -limit) substeps = -limit;
+  }
+
+  spinner->position = (spinner->position + substeps) & ((SPINNER_STEPS << SPINNER_FRAC_BITS) - 1);
+  return spinner->position >> SPINNER_FRAC_BITS;
+}
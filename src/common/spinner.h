@@ -0,0 +1,32 @@
+// spinner.h
+
+#ifndef SPINNER_H
+#define SPINNER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tusb.h"
+
+// Emulated quad spinner (nuon quad_x) driven by other motion: mouse x and
+// wheel, touchpad swipes, stick rotation. Positions keep SPINNER_FRAC_BITS
+// of sub-step so motion finer than one step still adds up.
+#define SPINNER_FRAC_BITS 4
+#define SPINNER_STEP      (1 << SPINNER_FRAC_BITS) // sub-steps per step
+#define SPINNER_STEPS     256 // quad_x values per turn
+
+// full turn of spinner_atan2
+#define SPINNER_TURN 65536
+
+typedef struct
+{
+  int32_t position; // sub-steps, wraps every SPINNER_STEPS steps
+  int32_t last;     // last absolute sample (touch position, stick angle)
+  bool tracking;    // last holds a sample
+} spinner_t;
+
+uint16_t __not_in_flash_func(spinner_atan2)(int32_t y, int32_t x);
+int32_t __not_in_flash_func(spinner_follow)(spinner_t* spinner, int32_t sample);
+void spinner_release(spinner_t* spinner);
+uint8_t __not_in_flash_func(spinner_move)(spinner_t* spinner, int32_t substeps, int32_t limit);
+
+#endif // SPINNER_H
@@ -0,0 +1,196 @@
+// trace.c
+
+#include <string.h>
+#include "trace.h"
+#include "pico/stdlib.h"
+
+#ifdef CONFIG_REPORT_TRACE
+
+// one queued trace line (core0 only: usb callbacks and players_publish)
+typedef struct
+{
+  char kind;
+  char source;
+  uint8_t dev_addr;
+  uint8_t instance;
+  uint32_t time_us;
+  union
+  {
+    struct
+    {
+      int16_t dev_type;
+      uint16_t len;
+      uint32_t elapsed_us;
+      uint8_t bytes[TRACE_BYTES];
+    } report; // R and d
+    struct
+    {
+      uint16_t vid;
+      uint16_t pid;
+      uint8_t protocol;
+      uint16_t desc_len;
+    } mount;
+    players_frame_t frame;
+  };
+} trace_record_t;
+
+static trace_record_t records[TRACE_RECORDS];
+static uint32_t record_head = 0; // next record written
+static uint32_t record_tail = 0; // next record printed
+static uint32_t dropped = 0;
+
+// claims the next free record, NULL when the queue is full
+static trace_record_t* trace_claim(char kind)
+{
+  if (record_head - record_tail >= TRACE_RECORDS)
+  {
+    dropped++;
+    return NULL;
+  }
+
+  trace_record_t* record = &records[record_head++ % TRACE_RECORDS];
+  record->kind = kind;
+  record->time_us = time_us_32();
+  return record;
+}
+
+// queue a raw report (source 'H' = hid, 'X' = xinput)
+void trace_report(char source, int dev_type, uint8_t dev_addr, uint8_t instance,
+  uint8_t const* report, uint16_t len, uint32_t elapsed_us)
+{
+  trace_record_t* record = trace_claim('R');
+  if (!record) return;
+
+  if (len > TRACE_BYTES) len = TRACE_BYTES;
+  record->source = source;
+  record->dev_addr = dev_addr;
+  record->instance = instance;
+  record->report.dev_type = dev_type;
+  record->report.len = len;
+  record->report.elapsed_us = elapsed_us;
+  memcpy(record->report.bytes, report, len);
+}
+
+// queue a mounted interface, its report descriptor follows in chunks
+void trace_mount(char source, uint8_t dev_addr, uint8_t instance, uint16_t vid, uint16_t pid,
+  uint8_t protocol, uint8_t const* desc, uint16_t desc_len)
+{
+  trace_record_t* record = trace_claim('M');
+  if (!record) return;
+
+  record->source = source;
+  record->dev_addr = dev_addr;
+  record->instance = instance;
+  record->mount.vid = vid;
+  record->mount.pid = pid;
+  record->mount.protocol = protocol;
+  record->mount.desc_len = desc_len;
+
+  for (uint16_t i = 0; i < desc_len; i += TRACE_BYTES)
+  {
+    uint16_t len = desc_len - i < TRACE_BYTES ? desc_len - i : TRACE_BYTES;
+    trace_record_t* chunk = trace_claim('d');
+    if (!chunk) return;
+
+    chunk->dev_addr = dev_addr;
+    chunk->instance = instance;
+    chunk->report.len = len;
+    memcpy(chunk->report.bytes, desc + i, len);
+  }
+}
+
+// queue a device removal
+void trace_unmount(uint8_t dev_addr)
+{
+  trace_record_t* record = trace_claim('U');
+  if (!record) return;
+
+  record->dev_addr = dev_addr;
+}
+
+// queue the player output state handed to the console
+void trace_frame(players_frame_t const* frame)
+{
+  trace_record_t* record = trace_claim('F');
+  if (!record) return;
+
+  record->frame = *frame;
+}
+
+static void print_bytes(uint8_t const* bytes, uint16_t len)
+{
+  for (uint16_t i = 0; i < len; i++)
+  {
+    printf(" %02x", bytes[i]);
+  }
+  printf("\n");
+}
+
+static void print_frame(uint32_t time_us, players_frame_t const* frame)
+{
+  printf("F %lu %lu %d", (unsigned long)time_us, (unsigned long)frame->seq, frame->count);
+  for (int i = 0; i < MAX_PLAYERS; i++)
+  {
+    player_output_t const* out = &frame->players[i];
+    if (!out->dev_addr)
+    {
+      printf(" [-]");
+      continue;
+    }
+    printf(" [%05lx %d %d %d %d %d %d %02x%02x%02x]",
+      (unsigned long)(out->output_buttons & 0xfffff),
+      out->output_analog_1x, out->output_analog_1y,
+      out->output_analog_2x, out->output_analog_2y,
+      out->output_analog_l, out->output_analog_r,
+      out->keypress[0], out->keypress[1], out->keypress[2]);
+  }
+#ifdef CONFIG_NGC
+  printf(" gc");
+  print_bytes((uint8_t const*)&frame->gc_report, sizeof(frame->gc_report));
+#else
+  printf("\n");
+#endif
+}
+
+// prints queued records, called from the main loop
+void trace_task(void)
+{
+  while (record_tail != record_head)
+  {
+    trace_record_t const* record = &records[record_tail % TRACE_RECORDS];
+    unsigned long time_us = record->time_us;
+
+    switch (record->kind)
+    {
+    case 'R':
+      printf("R %lu %c %d %d %d %lu", time_us, record->source, record->report.dev_type,
+        record->dev_addr, record->instance, (unsigned long)record->report.elapsed_us);
+      print_bytes(record->report.bytes, record->report.len);
+      break;
+    case 'M':
+      printf("M %lu %c %d %d %04x %04x %d %d\n", time_us, record->source, record->dev_addr,
+        record->instance, record->mount.vid, record->mount.pid, record->mount.protocol,
+        record->mount.desc_len);
+      break;
+    case 'd':
+      printf("d %lu %d %d", time_us, record->dev_addr, record->instance);
+      print_bytes(record->report.bytes, record->report.len);
+      break;
+    case 'U':
+      printf("U %lu %d\n", time_us, record->dev_addr);
+      break;
+    case 'F':
+      print_frame(record->time_us, &record->frame);
+      break;
+    }
+    record_tail++;
+  }
+
+  if (dropped)
+  {
+    printf("D %lu\n", (unsigned long)dropped);
+    dropped = 0;
+  }
+}
+
+#endif
@@ -0,0 +1,38 @@
+// trace.h
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "tusb.h"
+#include "players.h"
+
+// Report tracing (-DREPORT_TRACE=ON) logs every raw usb report with its
+// processing time, every mount and unmount, and every published player
+// frame, over UART. Captured logs replay through the host build
+// (src/host) to check changes for bit-exact output.
+//
+// M <time_us> <source> <dev_addr> <instance> <vid> <pid> <protocol> <desc_len>
+// d <time_us> <dev_addr> <instance> <desc bytes..>   (descriptor, in chunks)
+// U <time_us> <dev_addr>
+// R <time_us> <source> <dev_type> <dev_addr> <instance> <elapsed_us> <bytes..>
+// F <time_us> <seq> <count> [<buttons> <1x> <1y> <2x> <2y> <l> <r> <keys..>]..
+// D <records dropped>
+//
+// Records are queued by the usb callbacks and printed from the main loop
+// by trace_task, so a slow UART never stalls report processing.
+//
+#define TRACE_RECORDS 32
+#define TRACE_BYTES   CFG_TUH_HID_EPIN_BUFSIZE // largest report, descriptor chunk
+
+#ifdef CONFIG_REPORT_TRACE
+void trace_report(char source, int dev_type, uint8_t dev_addr, uint8_t instance,
+  uint8_t const* report, uint16_t len, uint32_t elapsed_us);
+void trace_mount(char source, uint8_t dev_addr, uint8_t instance, uint16_t vid, uint16_t pid,
+  uint8_t protocol, uint8_t const* desc, uint16_t desc_len);
+void trace_unmount(uint8_t dev_addr);
+void trace_frame(players_frame_t const* frame);
+void trace_task(void);
+#endif
+
+#endif // TRACE_H
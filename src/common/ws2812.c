@@ -26,10 +26,6 @@ extern bool is_fun;
 PIO pio;
 uint sm;
 
-static absolute_time_t init_time;
-static absolute_time_t current_time;
-static absolute_time_t loop_time;
-static const int64_t reset_period = 10000;
 int dir = 1; // direction
 int tic = 0; // ticker
 
@@ -257,18 +253,13 @@ void neopixel_init()
     put_pixel(urgb_u32(0x40, 0x20, 0x00)); // init color value (holds color on auto sel boot)
 }
 
+// advances the pattern one tic (scheduled every NEOPIXEL_INTERVAL_US)
 void neopixel_task(int pat)
 {
     if (pat > 5) pat = 5;
     if (pat && is_fun) pat = 6;
 
-    current_time = get_absolute_time();
+    pattern_table[pat].pat(NUM_PIXELS, tic);
 
-    if (absolute_time_diff_us(init_time, current_time) > reset_period) {
-        pattern_table[pat].pat(NUM_PIXELS, tic);
-
-        tic += dir;
-
-        init_time = get_absolute_time();
-    }
+    tic += dir;
 }
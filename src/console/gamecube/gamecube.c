@@ -1,9 +1,14 @@
 // gamecube.c
 
 #include "gamecube.h"
+#include "latency.h"
+#include "config.h"
+#include "flash_store.h"
+#include "remap.h"
 #include "joybus.pio.h"
 #include "GamecubeConsole.h"
 #include "pico/bootrom.h"
+#include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "tusb.h"
 
@@ -22,6 +27,42 @@ uint8_t gc_kb_led = 0;
 uint8_t gc_last_rumble = 0;
 uint8_t gc_kb_counter = 0;
 
+// report bits of the remapped button word
+#define GC_BIT_DPAD_UP    0
+#define GC_BIT_DPAD_RIGHT 1
+#define GC_BIT_DPAD_DOWN  2
+#define GC_BIT_DPAD_LEFT  3
+#define GC_BIT_A          4
+#define GC_BIT_B          5
+#define GC_BIT_Z          6
+#define GC_BIT_START      7
+#define GC_BIT_X          8
+#define GC_BIT_Y          9
+#define GC_BIT_L          10
+#define GC_BIT_R          11
+
+// gamecube button of each usbretro button
+static const uint32_t gc_button_targets[REMAP_BUTTONS] = {
+  1 << GC_BIT_DPAD_UP,    // up
+  1 << GC_BIT_DPAD_RIGHT, // right
+  1 << GC_BIT_DPAD_DOWN,  // down
+  1 << GC_BIT_DPAD_LEFT,  // left
+  1 << GC_BIT_A,          // b
+  1 << GC_BIT_B,          // a
+  1 << GC_BIT_Z,          // select
+  1 << GC_BIT_START,      // start
+  0,                      // l2, analog only
+  0,                      // r2, analog only
+  0,                      // home
+  0,                      // 6-button flag
+  1 << GC_BIT_X,          // y
+  1 << GC_BIT_Y,          // x
+  1 << GC_BIT_L,          // l
+  1 << GC_BIT_R,          // r
+  0,                      // l3
+  0,                      // r3
+};
+
 // init hid key to gc key lookup table
 void gc_kb_key_lookup_init()
 {
@@ -152,8 +193,18 @@ void ngc_init()
   int sm = -1;
   int offset = -1;
   gc_kb_key_lookup_init();
+  remap_init(gc_button_targets);
   GamecubeConsole_init(&gc, GC_DATA_PIN, pio, sm, offset);
   gc_report = default_gc_report;
+
+  // come back up in keyboard mode if it was saved
+  if (config_get(CONFIG_KEY_BUTTON_MODE) == BUTTON_MODE_KB)
+  {
+    GamecubeConsole_SetMode(&gc, GamecubeMode_KB);
+    gc_report = default_gc_kb_report;
+    gc_kb_led = 0x4;
+  }
+  players_publish();
 }
 
 uint8_t gc_kb_key_lookup(uint8_t hid_key)
@@ -176,38 +227,52 @@ uint8_t furthest_from_center(uint8_t a, uint8_t b, uint8_t center)
 // core1_entry - inner-loop for the second core
 void __not_in_flash_func(core1_entry)(void)
 {
+  static players_frame_t frame;
+
+  // park in ram while core0 writes flash
+  multicore_lockout_victim_init();
+
   while (1)
   {
     // Wait for GameCube console to poll controller
     gc_rumble = GamecubeConsole_WaitForPoll(&gc) ? 255 : 0;
 
+    // Pick up the newest report published by core0
+    bool fresh = players_snapshot(&frame);
+
+    if (frame.players[0].button_mode == BUTTON_MODE_KB)
+    {
+      frame.gc_report.keyboard.counter = gc_kb_counter;
+      frame.gc_report.keyboard.checksum = frame.gc_report.keyboard.keypress[0] ^
+                                          frame.gc_report.keyboard.keypress[1] ^
+                                          frame.gc_report.keyboard.keypress[2] ^ gc_kb_counter;
+    }
+
     // Send GameCube controller button report
-    GamecubeConsole_SendReport(&gc, &gc_report);
-    update_pending = false;
+    GamecubeConsole_SendReport(&gc, &frame.gc_report);
+    latency_wire(&frame);
+
+    // reply sent, flash writes may use the time until the next poll
+    flash_store_poll();
 
     gc_kb_counter++;
     gc_kb_counter &= 15;
 
+    // mouse movement in a report is delivered once
+    if (!fresh) continue;
+
     unsigned short int i;
     for (i = 0; i < MAX_PLAYERS; ++i)
     {
+      int16_t delta_x = 0;
+      int16_t delta_y = 0;
+
+      if (frame.players[i].global_x != 0) delta_x = frame.players[i].output_analog_1x - 128;
+      if (frame.players[i].global_y != 0) delta_y = frame.players[i].output_analog_1y - 128;
+
       // decrement outputs from globals
-      if (players[i].global_x != 0)
-      {
-        players[i].global_x = (players[i].global_x - (players[i].output_analog_1x - 128));
-        // if (players[i].global_x > 128) players[i].global_x = 128;
-        // if (players[i].global_x < -128) players[i].global_x = -128;
-        players[i].output_analog_1x = 128;
-      }
-      if (players[i].global_y != 0)
-      {
-        players[i].global_y = (players[i].global_y - (players[i].output_analog_1y - 128));
-        // if (players[i].global_y > 128) players[i].global_y = 128;
-        // if (players[i].global_y < -128) players[i].global_y = -128;
-        players[i].output_analog_1y = 128;
-      }
+      if (delta_x || delta_y) players_consume(&frame, i, delta_x, delta_y);
     }
-    update_output();
 
     // printf("MODE: %d\n", gc._reading_mode);
   }
@@ -215,6 +280,7 @@ void __not_in_flash_func(core1_entry)(void)
 
 //
 // update_output - updates gc_report output data for output to GameCube
+//                 (core0, published to core1 by players_task)
 void __not_in_flash_func(update_output)(void)
 {
   static bool kbModeButtonHeld = false;
@@ -229,10 +295,10 @@ void __not_in_flash_func(update_output)(void)
   }
 
   unsigned short int i;
-  for (i = 0; i < playersCount; ++i)
+  for (i = 0; i < MAX_PLAYERS; ++i)
   {
-    // base controller buttons
-    int16_t byte = (players[i].output_buttons & 0xffff);
+    if (!players[i].dev_addr) continue;
+
     bool kbModeButtonPress = players[i].keypress[0] == HID_KEY_SCROLL_LOCK || players[i].keypress[0] == HID_KEY_F14;
     if (kbModeButtonPress)
     {
@@ -256,6 +322,8 @@ void __not_in_flash_func(update_output)(void)
           // players[i].gc_report = default_gc_report;
           gc_kb_led = 0;
         }
+        config_set(CONFIG_KEY_BUTTON_MODE, players[0].button_mode);
+        config_set(CONFIG_KEY_BUTTON_MODE + i, players[i].button_mode);
       }
       kbModeButtonHeld = true;
     }
@@ -267,18 +335,19 @@ void __not_in_flash_func(update_output)(void)
     if (players[0].button_mode != BUTTON_MODE_KB)
     {
       // global buttons
-      gc_report.dpad_up    |= ((byte & 0x0001) == 0) ? 1 : 0; // up
-      gc_report.dpad_right |= ((byte & 0x0002) == 0) ? 1 : 0; // right
-      gc_report.dpad_down  |= ((byte & 0x0004) == 0) ? 1 : 0; // down
-      gc_report.dpad_left  |= ((byte & 0x0008) == 0) ? 1 : 0; // left
-      gc_report.a          |= ((byte & 0x0010) == 0) ? 1 : 0; // b
-      gc_report.b          |= ((byte & 0x0020) == 0) ? 1 : 0; // a
-      gc_report.z          |= ((byte & 0x0040) == 0) ? 1 : 0; // select
-      gc_report.start      |= ((byte & 0x0080) == 0) ? 1 : 0; // start
-      gc_report.x          |= ((byte & 0x01000) == 0) ? 1 : 0; // y
-      gc_report.y          |= ((byte & 0x02000) == 0) ? 1 : 0; // x
-      gc_report.l          |= ((byte & 0x04000) == 0) ? 1 : 0; // l
-      gc_report.r          |= ((byte & 0x08000) == 0) ? 1 : 0; // r
+      uint32_t pressed = remap_buttons(i, players[i].output_buttons);
+      gc_report.dpad_up    |= (pressed >> GC_BIT_DPAD_UP) & 1;
+      gc_report.dpad_right |= (pressed >> GC_BIT_DPAD_RIGHT) & 1;
+      gc_report.dpad_down  |= (pressed >> GC_BIT_DPAD_DOWN) & 1;
+      gc_report.dpad_left  |= (pressed >> GC_BIT_DPAD_LEFT) & 1;
+      gc_report.a          |= (pressed >> GC_BIT_A) & 1;
+      gc_report.b          |= (pressed >> GC_BIT_B) & 1;
+      gc_report.z          |= (pressed >> GC_BIT_Z) & 1;
+      gc_report.start      |= (pressed >> GC_BIT_START) & 1;
+      gc_report.x          |= (pressed >> GC_BIT_X) & 1;
+      gc_report.y          |= (pressed >> GC_BIT_Y) & 1;
+      gc_report.l          |= (pressed >> GC_BIT_L) & 1;
+      gc_report.r          |= (pressed >> GC_BIT_R) & 1;
 
       // global dominate axis
       gc_report.stick_x    = furthest_from_center(gc_report.stick_x, players[i].output_analog_1x, 128);
@@ -293,10 +362,7 @@ void __not_in_flash_func(update_output)(void)
       gc_report.keyboard.keypress[0] = gc_kb_key_lookup(players[i].keypress[2]);
       gc_report.keyboard.keypress[1] = gc_kb_key_lookup(players[i].keypress[1]);
       gc_report.keyboard.keypress[2] = gc_kb_key_lookup(players[i].keypress[0]);
-      gc_report.keyboard.checksum = gc_report.keyboard.keypress[0] ^
-                                    gc_report.keyboard.keypress[1] ^
-                                    gc_report.keyboard.keypress[2] ^ gc_kb_counter;
-      gc_report.keyboard.counter = gc_kb_counter;
+      // counter and checksum are stamped by core1 per poll
     }
   }
 
@@ -306,171 +372,52 @@ void __not_in_flash_func(update_output)(void)
 }
 
 //
-// post_globals - accumulate button and analog values
+// encode_input - maps routed input onto the GameCube player
 //
-void __not_in_flash_func(post_globals)(
-  uint8_t dev_addr,
-  int8_t instance,
-  uint32_t buttons,
-  uint8_t analog_1x,
-  uint8_t analog_1y,
-  uint8_t analog_2x,
-  uint8_t analog_2y,
-  uint8_t analog_l,
-  uint8_t analog_r,
-  uint32_t keys,
-  uint8_t quad_x)
+void __not_in_flash_func(encode_input)(int player_index, const input_state_t* input)
 {
-  // for merging extra device instances into the root instance (ex: joycon charging grip)
-  bool is_extra = (instance == -1);
-  if (is_extra) instance = 0;
-
-  int player_index = find_player_index(dev_addr, instance);
-  uint16_t buttons_pressed = (~(buttons | 0x0800)) || keys;
-  if (player_index < 0 && buttons_pressed)
-  {
-    printf("[add player] [%d, %d]\n", dev_addr, instance);
-    player_index = add_player(dev_addr, instance);
-  }
-
-  // printf("[player_index] [%d] [%d, %d]\n", player_index, dev_addr, instance);
+  Player_t* player = &players[player_index];
 
-  if (player_index >= 0)
+  if (input->is_mouse)
   {
-    // extra instance buttons to merge with root player
-    if (is_extra)
-    {
-      players[0].altern_buttons = buttons;
-    }
-    else
-    {
-      players[player_index].global_buttons = buttons;
-    }
+    // relative movement is sent as stick deflection (1-255)
+    if (player->global_x > 127) player->output_analog_1x = 0xff;
+    else if (player->global_x < -127) player->output_analog_1x = 1;
+    else player->output_analog_1x = 128 + player->global_x;
 
-    // cache analog and button values to player object
-    if (analog_1x) players[player_index].output_analog_1x = analog_1x;
-    if (analog_1y) players[player_index].output_analog_1y = analog_1y;
-    if (analog_2x) players[player_index].output_analog_2x = analog_2x;
-    if (analog_2y) players[player_index].output_analog_2y = analog_2y;
-    players[player_index].output_analog_l = analog_l;
-    players[player_index].output_analog_r = analog_r;
-    players[player_index].output_buttons = players[player_index].global_buttons & players[player_index].altern_buttons;
+    if (player->global_y > 127) player->output_analog_1y = 0xff;
+    else if (player->global_y < -127) player->output_analog_1y = 1;
+    else player->output_analog_1y = 128 + player->global_y;
 
-    players[player_index].keypress[0] = (keys) & 0xff;
-    players[player_index].keypress[1] = (keys >> 8) & 0xff;
-    players[player_index].keypress[2] = (keys >> 16) & 0xff;
+    // printf("X: %d, Y: %d   ", player->global_x, player->global_y);
 
-    // full analog and digital L/R press always happen together
-    if (!((players[player_index].output_buttons) & 0x8000))
-    {
-      players[player_index].output_analog_r = 255;
-    }
-    else if (analog_r > 250)
-    {
-      players[player_index].output_buttons &= ~0x8000;
-    }
-
-    if (!((players[player_index].output_buttons) & 0x4000))
-    {
-      players[player_index].output_analog_l = 255;
-    }
-    else if (analog_l > 250)
-    {
-      players[player_index].output_buttons &= ~0x4000;
-    }
-
-    // printf("X1: %d, Y1: %d   ", analog_1x, analog_1y);
-
-    update_output();
+    player->output_buttons = input->buttons;
   }
-}
-
-//
-// post_mouse_globals - accumulate the many intermediate mouse scans (~1ms)
-//
-void __not_in_flash_func(post_mouse_globals)(
-  uint8_t dev_addr,
-  int8_t instance,
-  uint16_t buttons,
-  uint8_t delta_x,
-  uint8_t delta_y,
-  uint8_t quad_x)
-{
-  // for merging extra device instances into the root instance (ex: joycon charging grip)
-  bool is_extra = (instance == -1);
-  if (is_extra) instance = 0;
-
-  int player_index = find_player_index(dev_addr, instance);
-  uint16_t buttons_pressed = (~(buttons | 0x0f00));
-  if (player_index < 0 && buttons_pressed)
-  {
-    printf("[add player] [%d, %d]\n", dev_addr, instance);
-    player_index = add_player(dev_addr, instance);
-  }
-
-  // printf("[player_index] [%d] [%d, %d]\n", player_index, dev_addr, instance);
-
-  if (player_index >= 0)
+  else
   {
-    // fixes out of range analog values (1-255)
-    if (delta_x == 0) delta_x = 1;
-    if (delta_y == 0) delta_y = 1;
+    player->output_buttons = player->global_buttons & player->altern_buttons;
 
-    if (delta_x >= 128)
-    {
-      players[player_index].global_x = players[player_index].global_x - (256-delta_x);
-    }
-    else
-    {
-      players[player_index].global_x = players[player_index].global_x + delta_x;
-    }
-
-    if (players[player_index].global_x > 127)
-    {
-      delta_x = 0xff;
-    }
-    else if (players[player_index].global_x < -127)
-    {
-      delta_x = 1;
-    }
-    else
-    {
-      delta_x = 128 + players[player_index].global_x;
-    }
-
-    if (delta_y >= 128)
+    // full analog and digital L/R press always happen together
+    if (!((player->output_buttons) & 0x8000))
     {
-
-      players[player_index].global_y = players[player_index].global_y - (256-delta_y);
+      player->output_analog_r = 255;
     }
-    else
+    else if (input->analog_r > 250)
     {
-      players[player_index].global_y = players[player_index].global_y + delta_y;
+      player->output_buttons &= ~0x8000;
     }
 
-    if (players[player_index].global_y > 127)
+    if (!((player->output_buttons) & 0x4000))
     {
-      delta_y = 0xff;
+      player->output_analog_l = 255;
     }
-    else if (players[player_index].global_y < -127)
+    else if (input->analog_l > 250)
     {
-      delta_y = 1;
+      player->output_buttons &= ~0x4000;
     }
-    else
-    {
-      delta_y = 128 + players[player_index].global_y;
-    }
-
-    // printf("X: %d, Y: %d   ", players[player_index].global_x, players[player_index].global_y);
-    // printf("X1: %d, Y1: %d   ", delta_x, delta_y);
 
-    // cache analog and button values to player object
-    players[player_index].output_analog_1x = delta_x;
-    players[player_index].output_analog_1y = delta_y;
-    // players[player_index].output_analog_2x = delta_x;
-    // players[player_index].output_analog_2y = delta_y;
-    players[player_index].output_buttons = buttons;
-
-    update_output();
+    // printf("X1: %d, Y1: %d   ", input->analog_1x, input->analog_1y);
   }
+
+  update_output();
 }
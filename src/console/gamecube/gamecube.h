@@ -13,8 +13,6 @@
 #include "globals.h"
 
 // Define constants
-#undef MAX_PLAYERS
-#define MAX_PLAYERS 4
 #define GC_KEY_NOT_FOUND 0x00 // Define lookup table (all initialized to NOT_FOUND to start)
 
 #define SHIELD_PIN_L 4  // Connector shielding mounted to GPIOs [4, 5,26,27]
@@ -40,11 +38,6 @@ void ngc_init(void);
 
 void __not_in_flash_func(core1_entry)(void);
 void __not_in_flash_func(update_output)(void);
-void __not_in_flash_func(post_globals)(uint8_t dev_addr, int8_t instance,
-  uint32_t buttons, uint8_t analog_1x, uint8_t analog_1y,
-  uint8_t analog_2x, uint8_t analog_2y, uint8_t analog_l,
-  uint8_t analog_r, uint32_t keys, uint8_t quad_x);
-void __not_in_flash_func(post_mouse_globals)(uint8_t dev_addr, int8_t instance,
-  uint16_t buttons, uint8_t delta_x, uint8_t delta_y, uint8_t quad_x);
+void __not_in_flash_func(encode_input)(int player_index, const input_state_t* input);
 
 #endif // GAMECUBE_H
\ No newline at end of file
@@ -1,29 +1,88 @@
 // nuon.c
 
 #include "nuon.h"
-
-// Definition of global variables
-uint32_t output_buttons_0 = 0;
-uint32_t output_analog_1x = 0;
-uint32_t output_analog_1y = 0;
-uint32_t output_analog_2x = 0;
-uint32_t output_analog_2y = 0;
-uint32_t output_quad_x = 0;
-
-uint32_t device_mode   = 0b10111001100000111001010100000000;
-uint32_t device_config = 0b10000000100000110000001100000000;
-uint32_t device_switch = 0b10000000100000110000001100000000;
+#include "latency.h"
+#include "flash_store.h"
+#include "remap.h"
+#include "pico/multicore.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/structs/scb.h"
+
+// one emulated controller on the polyface bus. replies are stored
+// bit-reversed (and parity-applied) so a handler only has to hand them to
+// the send state machine.
+typedef struct
+{
+  bool present;       // backed by a player slot (device 0 always is)
+  uint16_t state;
+  uint8_t channel;
+  uint8_t id;
+  bool alive;
+  bool tagged;
+  bool branded;
+  int requestsB;
+
+  uint32_t reply_buttons;
+  uint32_t reply_quad_x;
+  uint32_t reply_analog[128]; // ANALOG reply of each atod channel
+  uint32_t reply_alive;       // depends on id and alive
+  uint32_t reply_probe;       // depends on id, tagged and branded
+} polyface_device_t;
+
+static polyface_device_t devices[NUON_DEVICES];
+
+// branded device of each bus id, and the device enumeration talks to
+static polyface_device_t* device_by_id[PACKET_ID_MASK + 1];
+static polyface_device_t* pending = NULL;
+
+// replies shared by every device
+static uint32_t reply_address[2];   // REQUEST (ADDRESS) reply, [channel == mode]
+static uint32_t reply_config;
+static uint32_t reply_switch;
+static uint32_t reply_magic;
+static uint32_t reply_request_b;
+static uint32_t reply_state[2];     // STATE read reply, [state == 0x4151]
+
+// player frame encoded into the replies
+static players_frame_t frame;
+
+// end of the last sleep, for core1 busy time
+static uint32_t wake_us;
+
+// reply word and stop word, sent to the send state machine by dma
+static uint32_t reply_words[2] = { 0, 1 };
+static uint reply_dma;
+
+static void polyface_init(void);
+static void reset_device(polyface_device_t* device);
+static void update_enumeration(void);
+
+// nuon button bits of each usbretro button (canonical bit order)
+static const uint32_t nuon_button_targets[REMAP_BUTTONS] = {
+  0x0200, // Dpad Up -> D-UP
+  0x0100, // Dpad Right -> D-RIGHT
+  0x0800, // Dpad Down -> D-DOWN
+  0x0400, // Dpad Left -> D-LEFT
+  0x8000, // Circle -> C-DOWN
+  0x4000, // Cross -> A
+  0x1000, // Share -> SELECT
+  0x2000, // Option -> START
+  0x0002, // L2 -> C-UP
+  0x0001, // R2 -> C-RIGHT
+  0,      // Home
+  0,      // 6-button flag
+  0x0004, // Triangle -> C-LEFT
+  0x0008, // Square -> B
+  0x0020, // L1 -> L
+  0x0010, // R1 -> R
+  0,      // L3
+  0,      // R3
+};
 
 // init for nuon communication
 void nuon_init(void)
 {
-  output_buttons_0 = 0b00000000100000001000001100000011; // no buttons pressed
-  output_analog_1x = 0b10000000100000110000001100000000; // x1 = 0
-  output_analog_1y = 0b10000000100000110000001100000000; // y1 = 0
-  output_analog_2x = 0b10000000100000110000001100000000; // x2 = 0
-  output_analog_2y = 0b10000000100000110000001100000000; // y2 = 0
-  output_quad_x = 0b10000000000000000000000000000000; // quadx = 0
-
   // PROPERTIES DEV____MOD DEV___CONF DEV____EXT // CTRL_VALUES from SDK joystick.h
   // 0x0000001f 0b10111001 0b10000000 0b10000000 // ANALOG1, STDBUTTONS, DPAD, SHOULDER, EXTBUTTONS
   // 0x0000003f 0b10000000 0b01000000 0b01000000 // ANALOG1, ANALOG2, STDBUTTONS, DPAD, SHOULDER, EXTBUTTONS
@@ -52,10 +111,40 @@ void nuon_init(void)
   // 0x0000c51b 0b10000000 0b11000000 0b11000000 // THUMBWHEEL1, THUMBWHEEL2, RUDDER|TWIST, THROTTLE, ANALOG1, STDBUTTONS, DPAD, EXTBUTTONS
   // 0x0001001d 0b11000000 0b11000000 0b10000000 // FISHINGREEL, ANALOG1, STDBUTTONS, SHOULDER, EXTBUTTONS
 
+  remap_init(nuon_button_targets);
+
   // Sets packets that define device properties
-  device_mode   = crc_data_packet(0b10011101, 1);
-  device_config = crc_data_packet(0b11000000, 1);
-  device_switch = crc_data_packet(0b11000000, 1);
+  uint32_t device_mode = __rev(crc_data_packet(0b10011101, 1)); // device mode packet?
+  reply_config = __rev(crc_data_packet(0b11000000, 1)); // device config packet?
+  reply_switch = __rev(crc_data_packet(0b11000000, 1)); // extra device config?
+
+  // fixed replies
+  reply_address[0] = __rev(crc_data_packet(0b11110110, 1)); // 70, send & recv?
+  reply_address[1] = __rev(crc_data_packet(0b11110100, 1)); // 68, send & recv?
+  reply_magic = __rev(MAGIC);
+  reply_request_b = __rev(0b10);
+  reply_state[0] = __rev(0b11000000000000101000000000000000);
+  reply_state[1] = __rev(0b11010001000000101110011000000000);
+
+  for (int i = 0; i < NUON_DEVICES; i++)
+  {
+    polyface_device_t* device = &devices[i];
+    device->present = (i == 0);
+    device->reply_buttons = __rev(0b00000000100000001000001100000011); // no buttons pressed
+    device->reply_quad_x = __rev(0b10000000000000000000000000000000); // quadx = 0
+
+    // unlisted channels answer with a zero value packet
+    for (int j = 0; j < 128; j++)
+    {
+      device->reply_analog[j] = __rev(0b10000000100000110000001100000000);
+    }
+    device->reply_analog[ATOD_CHANNEL_NONE] = device_mode;
+
+    reset_device(device);
+  }
+  update_enumeration();
+
+  polyface_init();
 
   pio = pio0; // Both state machines can run on the same PIO processor
 
@@ -68,32 +157,23 @@ void nuon_init(void)
   sm1 = pio_claim_unused_sm(pio1, true);
   polyface_send_program_init(pio1, sm1, offset1, DATAIO_PIN);
 
+  // replies are paced into the send fifo by dma
+  reply_dma = dma_claim_unused_channel(true);
+  dma_channel_config c = dma_channel_get_default_config(reply_dma);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, pio_get_dreq(pio1, sm1, true));
+  dma_channel_configure(reply_dma, &c, &pio1->txf[sm1], reply_words, 2, false);
+
   // queue_init(&packet_queue, sizeof(int64_t), 1000);
 }
 
 // maps default usbretro button bit order to nuon's button packet data structure
-uint32_t map_nuon_buttons(uint32_t buttons)
-{
-  uint32_t nuon_buttons = 0x0080;
-
-  // Mapping the buttons from the old format to the new format, inverting the logic
-  nuon_buttons |= (!(buttons & 0x00010)) ? 0x8000 : 0;  // Circle -> C-DOWN
-  nuon_buttons |= (!(buttons & 0x00020)) ? 0x4000 : 0;  // Cross -> A
-  nuon_buttons |= (!(buttons & 0x00080)) ? 0x2000 : 0;  // Option -> START
-  nuon_buttons |= (!(buttons & 0x00040)) ? 0x1000 : 0;  // Share -> SELECT
-  nuon_buttons |= (!(buttons & 0x00004)) ? 0x0800 : 0;  // Dpad Down -> D-DOWN
-  nuon_buttons |= (!(buttons & 0x00008)) ? 0x0400 : 0;  // Dpad Left -> D-LEFT
-  nuon_buttons |= (!(buttons & 0x00001)) ? 0x0200 : 0;  // Dpad Up -> D-UP
-  nuon_buttons |= (!(buttons & 0x00002)) ? 0x0100 : 0;  // Dpad Right -> D-RIGHT
-  // Skipping the two buttons represented by 0x0080 and 0x0040 in the new format
-  nuon_buttons |= (!(buttons & 0x04000)) ? 0x0020 : 0;  // L1 -> L
-  nuon_buttons |= (!(buttons & 0x08000)) ? 0x0010 : 0;  // R1 -> R
-  nuon_buttons |= (!(buttons & 0x02000)) ? 0x0008 : 0;  // Square -> B
-  nuon_buttons |= (!(buttons & 0x01000)) ? 0x0004 : 0;  // Triangle -> C-LEFT
-  nuon_buttons |= (!(buttons & 0x00100)) ? 0x0002 : 0;  // L2 -> C-UP
-  nuon_buttons |= (!(buttons & 0x00200)) ? 0x0001 : 0;  // R2 -> C-RIGHT
-
-  return nuon_buttons;
+uint32_t __not_in_flash_func(map_nuon_buttons)(int player_index, uint32_t buttons)
+{
+  // 0x0080 is always set, 0x0040 is unused
+  return 0x0080 | remap_buttons(player_index, buttons);
 }
 
 uint8_t eparity(uint32_t data)
@@ -107,9 +187,34 @@ uint8_t eparity(uint32_t data)
   return ((eparity)&0x1);
 }
 
+// CRC16 of one byte, expanded by the preprocessor so the tables below are
+// built at compile time
+#define CRC_BIT(v)  ((((v) << 1) ^ ((((v) >> 15) & 1) * CRC16)) & 0xffff)
+#define CRC_BYTE(i) CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT(CRC_BIT((i) << 8))))))))
+
+// finished 1-byte data packet: value, crc, zero padding
+#define BYTE_PACKET(i) (((uint32_t)(i) << 24) | ((uint32_t)CRC_BYTE(i) << 8))
+
+#define REPEAT_16(M, i) \
+  M(i + 0),  M(i + 1),  M(i + 2),  M(i + 3),  M(i + 4),  M(i + 5),  M(i + 6),  M(i + 7), \
+  M(i + 8),  M(i + 9),  M(i + 10), M(i + 11), M(i + 12), M(i + 13), M(i + 14), M(i + 15)
+#define REPEAT_256(M) \
+  REPEAT_16(M, 0),   REPEAT_16(M, 16),  REPEAT_16(M, 32),  REPEAT_16(M, 48), \
+  REPEAT_16(M, 64),  REPEAT_16(M, 80),  REPEAT_16(M, 96),  REPEAT_16(M, 112), \
+  REPEAT_16(M, 128), REPEAT_16(M, 144), REPEAT_16(M, 160), REPEAT_16(M, 176), \
+  REPEAT_16(M, 192), REPEAT_16(M, 208), REPEAT_16(M, 224), REPEAT_16(M, 240)
+
+// crc look up table, in ram as core1 reads it between polyface packets
+static const uint16_t __not_in_flash("nuon_crc") crc_lut[256] = { REPEAT_256(CRC_BYTE) };
+
+// every 1-byte response packet (analog channels, quad spinner, config)
+static const uint32_t __not_in_flash("nuon_packets") byte_packets[256] = { REPEAT_256(BYTE_PACKET) };
+
 // generates data response packet with crc check bytes
-uint32_t crc_data_packet(int32_t value, int8_t size)
+uint32_t __not_in_flash_func(crc_data_packet)(int32_t value, int8_t size)
 {
+  if (size == 1) return byte_packets[value & 0xff];
+
   uint32_t packet = 0;
   uint16_t crc = 0;
 
@@ -127,265 +232,333 @@ uint32_t crc_data_packet(int32_t value, int8_t size)
   return (packet);
 }
 
-int crc_build_lut()
+int __not_in_flash_func(crc_calc)(unsigned char data, int crc)
 {
-	int i,j,k;
-	for (i=0; i<256; i++)
-  {
-		for(j=i<<8,k=0; k<8; k++)
-    {
-			j=(j&0x8000) ? (j<<1)^CRC16 : (j<<1); crc_lut[i]=j;
-		}
-	}
-	return(0);
+	return(((crc_lut[((crc>>8)^data)&0xff])^(crc<<8))&0xffff);
 }
 
-int crc_calc(unsigned char data, int crc)
+//
+// encode_output - updates a device's reply words with button/analog polyface packet
+//
+static void __not_in_flash_func(encode_output)(polyface_device_t* device, player_output_t* player)
 {
-	if (crc_lut[1]==0) crc_build_lut();
-	return(((crc_lut[((crc>>8)^data)&0xff])^(crc<<8))&0xffff);
+  // Calculate and set Nuon output packet values here.
+  int32_t buttons = (player->output_buttons & 0xffff) |
+                    (player->output_buttons_alt & 0xffff);
+
+  device->reply_buttons = __rev(crc_data_packet(buttons, 2));
+  device->reply_analog[ATOD_CHANNEL_X1] = __rev(byte_packets[player->output_analog_1x & 0xff]);
+  device->reply_analog[ATOD_CHANNEL_Y1] = __rev(byte_packets[player->output_analog_1y & 0xff]);
+  device->reply_analog[ATOD_CHANNEL_X2] = __rev(byte_packets[player->output_analog_2x & 0xff]);
+  device->reply_analog[ATOD_CHANNEL_Y2] = __rev(byte_packets[player->output_analog_2y & 0xff]);
+  device->reply_quad_x = __rev(byte_packets[player->output_quad_x & 0xff]);
 }
 
 //
-// core1_entry - inner-loop for the second core
-void __not_in_flash_func(core1_entry)(void)
+// encode_identity - updates a device's reply words that carry the bus id
+//
+static void __not_in_flash_func(encode_identity)(polyface_device_t* device)
+{
+  uint8_t id = device->id;
+
+  device->reply_alive = device->alive ? __rev(((id & 0b01111111) << 1)) : __rev(0b01);
+
+  //DEFCFG VERSION     TYPE      MFG TAGGED BRANDED    ID P
+  //   0b1 0001011 00000011 00000000      0       0 00000 0
+  uint32_t word1 = ((DEFCFG  & 1)<<31) |
+                   ((VERSION & 0b01111111)<<24) |
+                   ((TYPE    & 0b11111111)<<16) |
+                   ((MFG     & 0b11111111)<<8) |
+                   (((device->tagged ? 1:0) & 1)<<7) |
+                   (((device->branded? 1:0) & 1)<<6) |
+                   ((id      & 0b00011111)<<1);
+  device->reply_probe = __rev(word1 | eparity(word1));
+}
+
+//
+// encode_players - updates every device from a new player frame. device 0
+//                  is the root player, the others follow their own slot.
+//
+static void __not_in_flash_func(encode_players)(void)
 {
-  uint64_t packet = 0;
-  uint16_t state = 0;
-  uint8_t channel = 0;
-  uint8_t id = 0;
-  bool alive = false;
-  bool tagged = false;
-  bool branded = false;
-  int requestsB = 0;
+  bool changed = false;
 
-  while (1)
+  for (int i = 0; i < NUON_DEVICES; i++)
   {
-    packet = 0;
-    for (int i = 0; i < 2; ++i)
+    polyface_device_t* device = &devices[i];
+    bool present = !i || (i > frame.root && frame.players[i].dev_addr);
+
+    // a device joining or leaving the bus has to be enumerated again
+    if (present != device->present)
     {
-      uint32_t rxdata = pio_sm_get_blocking(pio, sm2);
-      packet = ((packet) << 32) | (rxdata & 0xFFFFFFFF);
+      device->present = present;
+      reset_device(device);
+      changed = true;
     }
 
-    // queue_try_add(&packet_queue, &packet);
+    if (present) encode_output(device, &frame.players[i ? i : frame.root]);
+  }
 
-    uint8_t dataA = ((packet>>17) & 0b11111111);
-    uint8_t dataS = ((packet>>9) & 0b01111111);
-    uint8_t dataC = ((packet>>1) & 0b01111111);
-    uint8_t type0 = ((packet>>25) & 0b00000001);
-    uint32_t word0 = 1;
-    uint32_t word1 = 0;
+  if (changed) update_enumeration();
+}
 
-    if (dataA == 0xb1 && dataS == 0x00 && dataC == 0x00) // RESET
-    {
-      id = 0;
-      alive = false;
-      tagged = false;
-      branded = false;
-      state = 0;
-      channel = 0;
-    }
-    if (dataA == 0x80) // ALIVE
-    {
-      word0 = 1;
-      word1 = __rev(0b01);
-      if (alive) word1 = __rev(((id & 0b01111111) << 1));
-      else alive = true;
+// puts a device back into its unbranded state
+static void __not_in_flash_func(reset_device)(polyface_device_t* device)
+{
+  device->id = 0;
+  device->alive = false;
+  device->tagged = false;
+  device->branded = false;
+  device->state = 0;
+  device->channel = 0;
+  encode_identity(device);
+}
 
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x88 && dataS == 0x04 && dataC == 0x40) // ERROR
-    {
-      word0 = 1;
-      word1 = 0;
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x90 && !branded) // MAGIC
-    {
-      word0 = 1;
-      word1 = __rev(MAGIC);
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x94) // PROBE
-    {
-      word0 = 1; // default res from HPI controller
-      word1 = __rev(0b10001011000000110000000000000000);
-
-      //DEFCFG VERSION     TYPE      MFG TAGGED BRANDED    ID P
-      //   0b1 0001011 00000011 00000000      0       0 00000 0
-      word1 = ((DEFCFG  & 1)<<31) |
-              ((VERSION & 0b01111111)<<24) |
-              ((TYPE    & 0b11111111)<<16) |
-              ((MFG     & 0b11111111)<<8) |
-              (((tagged ? 1:0) & 1)<<7) |
-              (((branded? 1:0) & 1)<<6) |
-              ((id      & 0b00011111)<<1);
-      word1 = __rev(word1 | eparity(word1));
-
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x27 && dataS == 0x01 && dataC == 0x00) // REQUEST (ADDRESS)
-    {
-      word0 = 1;
-      word1 = 0;
-
-      if (channel == ATOD_CHANNEL_MODE)
-      {
-        // word1 = __rev(0b11000100100000101001101100000000); // 68
-        word1 = __rev(crc_data_packet(0b11110100, 1)); // send & recv?
-      } else {
-        // word1 = __rev(0b11000110000000101001010000000000); // 70
-        word1 = __rev(crc_data_packet(0b11110110, 1)); // send & recv?
-      }
-
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x84 && dataS == 0x04 && dataC == 0x40) // REQUEST (B)
-    {
-      word0 = 1;
-      word1 = 0;
+// rebuilds the id lookup and picks the first unbranded device
+static void __not_in_flash_func(update_enumeration)(void)
+{
+  pending = NULL;
+  for (int i = 0; i <= PACKET_ID_MASK; i++) device_by_id[i] = NULL;
 
-      // 
-      if ((0b101001001100 >> requestsB) & 0b01)
-      {
-        word1 = __rev(0b10);
-      }
+  for (int i = NUON_DEVICES - 1; i >= 0; i--)
+  {
+    polyface_device_t* device = &devices[i];
+    if (!device->present) continue;
 
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
+    if (device->branded) device_by_id[device->id & PACKET_ID_MASK] = device;
+    else pending = device;
+  }
+}
 
-      requestsB++;
-      if (requestsB == 12) requestsB = 7;
-    }
-    else if (dataA == 0x34 && dataS == 0x01) // CHANNEL
-    {
-      channel = dataC;
-    }
-    else if (dataA == 0x32 && dataS == 0x02 && dataC == 0x00) // QUADX
-    {
-      word0 = 1;
-      word1 = __rev(0b10000000100000110000001100000000); //0
+// queues a reply word, followed by the stop word
+static inline void __not_in_flash_func(send_reply)(uint32_t word1)
+{
+  // the previous reply left long before the console sent another packet
+  dma_channel_wait_for_finish_blocking(reply_dma);
+  reply_words[0] = word1;
+  dma_channel_transfer_from_buffer_now(reply_dma, reply_words, 2);
+}
 
-      word1 = __rev(output_quad_x);
-      // TODO: solve how to set unique values to first two bytes plus checksum
+// sleeps until the read state machine has a packet
+static inline void __not_in_flash_func(wait_for_packet)(void)
+{
+  // the fifo interrupt is left disabled, but going pending still raises
+  // the event that ends __wfe (SEVONPEND)
+  irq_clear(PIO0_IRQ_0);
+  while (pio_sm_is_rx_fifo_empty(pio, sm2)) __wfe();
+}
 
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x35 && dataS == 0x01 && dataC == 0x00) // ANALOG
-    {
-      word0 = 1;
-      word1 = __rev(0b10000000100000110000001100000000); //0
-
-      // ALL_BUTTONS: CTRLR_STDBUTTONS & CTRLR_DPAD & CTRLR_SHOULDER & CTRLR_EXTBUTTONS
-      // <= 23 - 0x51f CTRLR_TWIST & CTRLR_THROTTLE & CTRLR_ANALOG1 & ALL_BUTTONS
-      // 29-47 - 0x83f CTRLR_MOUSE & CTRLR_ANALOG1 & CTRLR_ANALOG2 & ALL_BUTTONS
-      // 48-69 - 0x01f CTRLR_ANALOG1 & ALL_BUTTONS
-      // 70-92 - 0x808 CTRLR_MOUSE & CTRLR_EXTBUTTONS
-      // >= 93 - ERROR?
-
-      switch (channel)
-      {
-      case ATOD_CHANNEL_NONE:
-        word1 = __rev(device_mode); // device mode packet?
-        break;
-      // case ATOD_CHANNEL_MODE:
-      //   word1 = __rev(0b10000000100000110000001100000000);
-      //   break;
-      case ATOD_CHANNEL_X1:
-        word1 = __rev(output_analog_1x);
-        break;
-      case ATOD_CHANNEL_Y1:
-        word1 = __rev(output_analog_1y);
-        break;
-      case ATOD_CHANNEL_X2:
-        word1 = __rev(output_analog_2x);
-        break;
-      case ATOD_CHANNEL_Y2:
-        word1 = __rev(output_analog_2y);
-        break;
-      default:
-        break;
-      }
-
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x25 && dataS == 0x01 && dataC == 0x00) // CONFIG
-    {
-      word0 = 1;
-      word1 = __rev(device_config); // device config packet?
+//
+// polyface command handlers, indexed by dataA
+//
+typedef void (*polyface_handler_t)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0);
 
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x31 && dataS == 0x01 && dataC == 0x00) // {SWITCH[16:9]}
-    {
-      word0 = 1;
-      word1 = __rev(device_switch); // extra device config?
+static void __not_in_flash_func(handle_none)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+}
 
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x30 && dataS == 0x02 && dataC == 0x00) // {SWITCH[8:1]}
-    {
-      word0 = 1;
-      word1 = __rev(output_buttons_0);
+static void __not_in_flash_func(handle_reset)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS || dataC) return;
 
-      pio_sm_put_blocking(pio1, sm1, word1);
-      pio_sm_put_blocking(pio1, sm1, word0);
-    }
-    else if (dataA == 0x99 && dataS == 0x01) // STATE
-    {
-      switch (type0)
-      {
-      case PACKET_TYPE_READ:
-        word0 = 1;
-        word1 = __rev(0b11000000000000101000000000000000);
-
-        if (((state >> 8) & 0xff) == 0x41 && (state & 0xff) == 0x51)
-        {
-          word1 = __rev(0b11010001000000101110011000000000);
-        }
-        pio_sm_put_blocking(pio1, sm1, word1);
-        pio_sm_put_blocking(pio1, sm1, word0);
-        break;
-      // case PACKET_TYPE_WRITE:
-      default:
-        state = ((state) << 8) | (dataC & 0xff);
-        break;
-      }
-    }
-    else if (dataA == 0xb4 && dataS == 0x00) // BRAND
-    {
-      id = dataC;
-      branded = true;
-    }
+  // every device on the bus resets
+  for (int i = 0; i < NUON_DEVICES; i++) reset_device(&devices[i]);
+  update_enumeration();
+}
+
+static void __not_in_flash_func(handle_alive)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  send_reply(device->reply_alive);
+
+  if (!device->alive)
+  {
+    device->alive = true;
+    encode_identity(device);
+  }
+}
+
+static void __not_in_flash_func(handle_error)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS == 0x04 && dataC == 0x40) send_reply(0);
+}
+
+static void __not_in_flash_func(handle_magic)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  // answered while any device is still unbranded
+  if (pending) send_reply(reply_magic);
+}
+
+static void __not_in_flash_func(handle_probe)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  send_reply(device->reply_probe);
+}
+
+static void __not_in_flash_func(handle_address)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS == 0x01 && dataC == 0x00) send_reply(reply_address[device->channel == ATOD_CHANNEL_MODE]);
+}
+
+static void __not_in_flash_func(handle_request_b)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS != 0x04 || dataC != 0x40) return;
+
+  send_reply(((0b101001001100 >> device->requestsB) & 0b01) ? reply_request_b : 0);
+
+  device->requestsB++;
+  if (device->requestsB == 12) device->requestsB = 7;
+}
+
+static void __not_in_flash_func(handle_channel)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS == 0x01) device->channel = dataC;
+}
+
+static void __not_in_flash_func(handle_quad_x)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  // TODO: solve how to set unique values to first two bytes plus checksum
+  if (dataS == 0x02 && dataC == 0x00) send_reply(device->reply_quad_x);
+}
+
+static void __not_in_flash_func(handle_analog)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  // ALL_BUTTONS: CTRLR_STDBUTTONS & CTRLR_DPAD & CTRLR_SHOULDER & CTRLR_EXTBUTTONS
+  // <= 23 - 0x51f CTRLR_TWIST & CTRLR_THROTTLE & CTRLR_ANALOG1 & ALL_BUTTONS
+  // 29-47 - 0x83f CTRLR_MOUSE & CTRLR_ANALOG1 & CTRLR_ANALOG2 & ALL_BUTTONS
+  // 48-69 - 0x01f CTRLR_ANALOG1 & ALL_BUTTONS
+  // 70-92 - 0x808 CTRLR_MOUSE & CTRLR_EXTBUTTONS
+  // >= 93 - ERROR?
+  if (dataS == 0x01 && dataC == 0x00) send_reply(device->reply_analog[device->channel]);
+}
+
+static void __not_in_flash_func(handle_config)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS == 0x01 && dataC == 0x00) send_reply(reply_config);
+}
+
+static void __not_in_flash_func(handle_switch_hi)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS == 0x01 && dataC == 0x00) send_reply(reply_switch);
+}
+
+static void __not_in_flash_func(handle_switch_lo)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS != 0x02 || dataC != 0x00) return;
+
+  send_reply(device->reply_buttons);
+
+  // buttons are read once per frame, use the root device's read as the poll mark
+  if (device == &devices[0]) latency_wire(&frame);
+}
+
+static void __not_in_flash_func(handle_state)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS != 0x01) return;
+
+  switch (type0)
+  {
+  case PACKET_TYPE_READ:
+    send_reply(reply_state[device->state == 0x4151]);
+    break;
+  // case PACKET_TYPE_WRITE:
+  default:
+    device->state = ((device->state) << 8) | (dataC & 0xff);
+    break;
   }
 }
 
+static void __not_in_flash_func(handle_brand)(polyface_device_t* device, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  if (dataS) return;
+
+  // brands go to the device being enumerated
+  if (pending) device = pending;
+
+  device->id = dataC;
+  device->branded = true;
+  encode_identity(device);
+  update_enumeration();
+}
+
+static polyface_handler_t __not_in_flash("nuon_handlers") handlers[256];
+
+// fills the handler table
+static void polyface_init(void)
+{
+  for (int i = 0; i < 256; i++) handlers[i] = handle_none;
+
+  handlers[0xb1] = handle_reset;     // RESET
+  handlers[0x80] = handle_alive;     // ALIVE
+  handlers[0x88] = handle_error;     // ERROR
+  handlers[0x90] = handle_magic;     // MAGIC
+  handlers[0x94] = handle_probe;     // PROBE
+  handlers[0x27] = handle_address;   // REQUEST (ADDRESS)
+  handlers[0x84] = handle_request_b; // REQUEST (B)
+  handlers[0x34] = handle_channel;   // CHANNEL
+  handlers[0x32] = handle_quad_x;    // QUADX
+  handlers[0x35] = handle_analog;    // ANALOG
+  handlers[0x25] = handle_config;    // CONFIG
+  handlers[0x31] = handle_switch_hi; // {SWITCH[16:9]}
+  handlers[0x30] = handle_switch_lo; // {SWITCH[8:1]}
+  handlers[0x99] = handle_state;     // STATE
+  handlers[0xb4] = handle_brand;     // BRAND
+}
+
 //
-// update_output - updates output words with button/analog polyface packet
+// polyface_task - answers the next packet, with output words refreshed from
+//                 the newest player frame first
 //
-void __not_in_flash_func(update_output)(void)
+void __not_in_flash_func(polyface_task)(void)
 {
-  // Calculate and set Nuon output packet values here.
-  int32_t buttons = (players[0].output_buttons & 0xffff) |
-                    (players[0].output_buttons_alt & 0xffff);
+  // output words only change between packets
+  if (players_snapshot(&frame)) encode_players();
+
+  uint32_t sleep_us = time_us_32();
+  wait_for_packet();
+  uint32_t now_us = time_us_32();
+  latency_core1(sleep_us - wake_us, now_us - sleep_us);
+  wake_us = now_us;
+
+  // the read state machine pushes only the data word of a packet
+  uint32_t packet = pio_sm_get(pio, sm2);
+
+  // queue_try_add(&packet_queue, &packet);
+
+  // branded devices answer to their id. of the rest, enumeration (PROBE,
+  // BRAND) talks to the device being enumerated, anything else to the root
+  // device, which keeps answering its polls while another one joins
+  uint8_t dataA = (packet>>17) & 0b11111111;
+  polyface_device_t* device = device_by_id[(packet>>PACKET_ID_SHIFT) & PACKET_ID_MASK];
+  if (!device) device = (pending && (dataA == 0x94 || dataA == 0xb4)) ? pending : &devices[0];
+
+  handlers[dataA](device,
+                                      (packet>>9) & 0b01111111,  // dataS
+                                      (packet>>1) & 0b01111111,  // dataC
+                                      (packet>>25) & 0b00000001); // type0
+
+  // every packet counts: flash stays idle until the frame's polling is over
+  flash_store_poll();
+}
 
-  output_buttons_0 = crc_data_packet(buttons, 2);
-  output_analog_1x = crc_data_packet(players[0].output_analog_1x, 1);
-  output_analog_1y = crc_data_packet(players[0].output_analog_1y, 1);
-  output_analog_2x = crc_data_packet(players[0].output_analog_2x, 1);
-  output_analog_2y = crc_data_packet(players[0].output_analog_2y, 1);
-  output_quad_x    = crc_data_packet(players[0].output_quad_x, 1);
+//
+// core1_entry - inner-loop for the second core
+void __not_in_flash_func(core1_entry)(void)
+{
+  // park in ram while core0 writes flash
+  multicore_lockout_victim_init();
 
+  // wake on packets instead of spinning on the fifo
+  pio_set_irq0_source_enabled(pio, pis_sm0_rx_fifo_not_empty + sm2, true);
+  scb_hw->scr |= M0PLUS_SCR_SEVONPEND_BITS;
+
+  wake_us = time_us_32();
+  while (1) polyface_task();
+}
+
+//
+// update_output - flags changed player state for core1 to encode
+//
+void __not_in_flash_func(update_output)(void)
+{
   codes_task();
 
   update_pending = true;
@@ -393,105 +566,37 @@ void __not_in_flash_func(update_output)(void)
 
 
 //
-// post_globals - accumulate button and analog values
+// encode_input - maps routed input onto the Nuon player
 //
-void __not_in_flash_func(post_globals)(
-  uint8_t dev_addr,
-  int8_t instance,
-  uint32_t buttons,
-  uint8_t analog_1x,
-  uint8_t analog_1y,
-  uint8_t analog_2x,
-  uint8_t analog_2y,
-  uint8_t analog_l,
-  uint8_t analog_r,
-  uint32_t keys,
-  uint8_t quad_x)
-{
-  bool has6Btn = !(buttons & 0x0800);
-
-  // for merging extra device instances into the root instance (ex: joycon charging grip)
-  bool is_extra = (instance == -1);
-  if (is_extra) instance = 0;
-
-  int player_index = find_player_index(dev_addr, instance);
-  uint16_t buttons_pressed = (~(buttons | 0x0800)) || keys;
-  if (player_index < 0 && buttons_pressed)
+void __not_in_flash_func(encode_input)(int player_index, const input_state_t* input)
+{
+  Player_t* player = &players[player_index];
+
+  if (input->is_mouse)
   {
-    printf("[add player] [%d, %d]\n", dev_addr, instance);
-    player_index = add_player(dev_addr, instance);
+    player->output_buttons = map_nuon_buttons(player_index, player->global_buttons & player->altern_buttons);
+    player->output_analog_1x = 128;
+    player->output_analog_1y = 128;
+    player->output_analog_2x = 128;
+    player->output_analog_2y = 128;
+    player->output_analog_l = 0;
+    player->output_analog_r = 0;
   }
-
-  // printf("[player_index] [%d] [%d, %d]\n", player_index, dev_addr, instance);
-
-  if (player_index >= 0)
+  else
   {
-    // extra instance buttons to merge with root player
-    if (is_extra)
+    // second instance buttons are sent alongside the root instance
+    uint32_t nuon_buttons = map_nuon_buttons(player_index, input->buttons);
+    if (input->instance <= 0)
     {
-      players[0].altern_buttons = buttons;
+      player->output_buttons = nuon_buttons;
     }
     else
     {
-      players[player_index].global_buttons = buttons;
+      player->output_buttons_alt = nuon_buttons;
     }
-
-    uint32_t nuon_buttons = map_nuon_buttons(buttons);
-    if (!instance)
-    {
-      players[player_index].output_buttons = nuon_buttons;
-    }
-    else
-    {
-      players[player_index].output_buttons_alt = nuon_buttons;
-    }
-
-    if (analog_1x) players[player_index].output_analog_1x = analog_1x;
-    if (analog_1y) players[player_index].output_analog_1y = analog_1y;
-    if (analog_2x) players[player_index].output_analog_2x = analog_2x;
-    if (analog_2y) players[player_index].output_analog_2y = analog_2y;
-    if (quad_x) players[player_index].output_quad_x = quad_x;
-    update_output();
-  }
-}
-
-//
-// post_mouse_globals - accumulate the many intermediate mouse scans (~1ms)
-//
-void __not_in_flash_func(post_mouse_globals)(
-  uint8_t dev_addr,
-  int8_t instance,
-  uint16_t buttons,
-  uint8_t delta_x,
-  uint8_t delta_y,
-  uint8_t quad_x)
-{
-  // for merging extra device instances into the root instance (ex: joycon charging grip)
-  bool is_extra = (instance == -1);
-  if (is_extra) instance = 0;
-
-  int player_index = find_player_index(dev_addr, instance);
-  uint16_t buttons_pressed = (~(buttons | 0x0f00));
-  if (player_index < 0 && buttons_pressed)
-  {
-    printf("[add player] [%d, %d]\n", dev_addr, instance);
-    player_index = add_player(dev_addr, instance);
   }
 
-  // printf("[player_index] [%d] [%d, %d]\n", player_index, dev_addr, instance);
+  if (input->quad_x) player->output_quad_x = input->quad_x;
 
-  if (player_index >= 0)
-  {
-    players[player_index].global_buttons = buttons;
-    players[player_index].output_buttons = map_nuon_buttons(players[player_index].global_buttons & players[player_index].altern_buttons);
-    players[player_index].output_analog_1x = 128;
-    players[player_index].output_analog_1y = 128;
-    players[player_index].output_analog_2x = 128;
-    players[player_index].output_analog_2y = 128;
-    players[player_index].output_analog_l = 0;
-    players[player_index].output_analog_r = 0;
-    if (quad_x) players[player_index].output_quad_x = quad_x;
-
-    update_output();
-  }
+  update_output();
 }
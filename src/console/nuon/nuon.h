@@ -5,14 +5,13 @@
 
 #include <stdint.h>
 #include "hardware/pio.h"
+#include "hardware/dma.h"
 #include "polyface_read.pio.h"
 #include "polyface_send.pio.h"
 #include "globals.h"
 // #include "pico/util/queue.h"
 
 // Define constants
-#undef MAX_PLAYERS
-#define MAX_PLAYERS       4
 
 // Nuon GPIO pins
 #define DATAIO_PIN        2
@@ -22,6 +21,24 @@
 #define PACKET_TYPE_READ  1
 #define PACKET_TYPE_WRITE 0
 
+// Nuon packet target id. not from a protocol document: inferred from the
+// data word, where bits 26-31 are the only ones no command decodes, and the
+// 5-bit id a BRAND assigns (dataC) and PROBE echoes back. with one device
+// every packet reaches device 0 whatever those bits hold, so only routing
+// between several devices rests on it (host/nuon_routing.c covers that).
+// data word: [30:26] id, [25] type0, [24:17] dataA, [15:9] dataS, [7:1] dataC
+#define PACKET_ID_SHIFT   26
+#define PACKET_ID_MASK    0b00011111
+
+// emulated controllers on the polyface bus. one per player slot rests on
+// the id layout above, which no console has confirmed, so by default a
+// single device answers every packet (CONFIG_NUON_MULTI for one per slot)
+#ifdef CONFIG_NUON_MULTI
+#define NUON_DEVICES      MAX_PLAYERS
+#else
+#define NUON_DEVICES      1
+#endif
+
 // Nuon analog modes
 #define ATOD_CHANNEL_NONE 0x00
 #define ATOD_CHANNEL_MODE 0x01
@@ -46,23 +63,19 @@
 PIO pio;
 uint sm1, sm2; // sm1 = send; sm2 = read
 
-static int crc_lut[256]; // crc look up table
 // queue_t packet_queue;
 
 // Function declarations
 void nuon_init(void);
 uint32_t __rev(uint32_t);
 uint8_t eparity(uint32_t);
-int crc_calc(unsigned char data,int crc);
-uint32_t crc_data_packet(int32_t value, int8_t size);
+int __not_in_flash_func(crc_calc)(unsigned char data, int crc);
+uint32_t __not_in_flash_func(crc_data_packet)(int32_t value, int8_t size);
+uint32_t __not_in_flash_func(map_nuon_buttons)(int player_index, uint32_t buttons);
 
+void __not_in_flash_func(polyface_task)(void);
 void __not_in_flash_func(core1_entry)(void);
 void __not_in_flash_func(update_output)(void);
-void __not_in_flash_func(post_globals)(uint8_t dev_addr, int8_t instance,
-  uint32_t buttons, uint8_t analog_1x, uint8_t analog_1y,
-  uint8_t analog_2x, uint8_t analog_2y, uint8_t analog_l,
-  uint8_t analog_r, uint32_t keys, uint8_t quad_x);
-void __not_in_flash_func(post_mouse_globals)(uint8_t dev_addr, int8_t instance,
-  uint16_t buttons, uint8_t delta_x, uint8_t delta_y, uint8_t quad_x);
+void __not_in_flash_func(encode_input)(int player_index, const input_state_t* input);
 
 #endif // NUON_H
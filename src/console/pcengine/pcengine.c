@@ -1,7 +1,15 @@
 // pcengine.c
 
 #include "pcengine.h"
+#include "latency.h"
+#include "config.h"
+#include "flash_store.h"
+#include "remap.h"
 #include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/structs/scb.h"
+#include "pico/multicore.h"
 
 // Definition of global variables
 uint32_t output_analog_1x = 0;
@@ -9,13 +17,9 @@ uint32_t output_analog_1y = 0;
 uint32_t output_analog_2x = 0;
 uint32_t output_analog_2y = 0;
 
-// When PCE reads, set interlock to ensure atomic update
+// frame_table -> word pairs the plex state machine pulls, one per scan
 //
-volatile bool  output_exclude = false;
-
-// output_word -> is the word sent to the state machine for output
-//
-// Structure of the word sent to the FIFO from the ARM:
+// Structure of the words sent to the FIFO by dma:
 // |  word_1|                             word_0
 // |PLAYER_5|PLAYER_4|PLAYER_3|PLAYER_2|PLAYER_1
 //
@@ -35,19 +39,43 @@ volatile bool  output_exclude = false;
 //  - Xx = mouse 'x' movement; left is {1 - 0x7F} ; right is {0xFF - 0x80 }
 //  - Yy = mouse 'y' movement;  up  is {1 - 0x7F} ; down  is {0xFF - 0x80 }
 //
-uint32_t output_word_0 = 0;
-uint32_t output_word_1 = 0;
+// pairs are in scan order, nybble state 3 down to 0, then state 0 again up
+// to SCAN_MAX scans. the table is built into the back half while dma
+// streams the front half to the plex fifo.
+static uint32_t frame_table[2][SCAN_MAX * 2];
+static int frame_front = 0;
+static uint frame_dma;
+static uint plex_offset;
+
+static int scan = 0; // scans seen since the last frame end (core1)
+
+static uint32_t turbo_timer = 0;
+static bool turbo_state = false;
+
+static void encode_scan(int state, uint32_t words[2]);
+static void turbo_tick(void);
+
+// player state being scanned out (core1 only)
+static players_frame_t frame;
+
+static const uint32_t reset_period = 600; // at 600us, a scan is no longer in process
 
-int state = 0; // countdown sequence for shift-register position
+// clock program events
+#define CLOCK_FRAME_END 0 // no scan for reset_period
+#define CLOCK_SCAN      1 // CLR rising edge
 
-static absolute_time_t init_time;
-static absolute_time_t current_time;
-static absolute_time_t loop_time;
-static const int64_t reset_period = 600; // at 600us, reset the scan exclude flag
+// pce output keeps the usbretro button order, only remaps move buttons
+static const uint32_t pce_button_targets[REMAP_BUTTONS] = {
+  1 << 0,  1 << 1,  1 << 2,  1 << 3,  1 << 4,  1 << 5,
+  1 << 6,  1 << 7,  1 << 8,  1 << 9,  1 << 10, 1 << 11,
+  1 << 12, 1 << 13, 1 << 14, 1 << 15, 1 << 16, 1 << 17,
+};
 
 // init for pcengine communication
 void pce_init()
 {
+  remap_init(pce_button_targets);
+
   // use turbo button feature with PCE
   turbo_init();
 
@@ -56,169 +84,203 @@ void pce_init()
   // Load the plex (multiplex output) program, and configure a free state machine
   // to run the program.
 
-  uint offset1 = pio_add_program(pio, &plex_program);
+  plex_offset = pio_add_program(pio, &plex_program);
   sm1 = pio_claim_unused_sm(pio, true);
-  plex_program_init(pio, sm1, offset1, DATAIN_PIN, CLKIN_PIN, OUTD0_PIN);
+  plex_program_init(pio, sm1, plex_offset, DATAIN_PIN, CLKIN_PIN, OUTD0_PIN);
 
   // Load the clock/select (synchronizing input) programs, and configure a free state machines
   // to run the programs.
 
   uint offset2 = pio_add_program(pio, &clock_program);
   sm2 = pio_claim_unused_sm(pio, true);
-  clock_program_init(pio, sm2, offset2, CLKIN_PIN, OUTD0_PIN);
+  uint32_t gap_loops = clock_get_hz(clk_sys) / 1000000 * reset_period / 2;
+  clock_program_init(pio, sm2, offset2, CLKIN_PIN, OUTD0_PIN, gap_loops);
 
   uint offset3 = pio_add_program(pio, &select_program);
   sm3 = pio_claim_unused_sm(pio, true);
   select_program_init(pio, sm3, offset3, DATAIN_PIN);
 
-  state = 3;
+  // frame tables are paced into the plex fifo by dma
+  frame_dma = dma_claim_unused_channel(true);
+  dma_channel_config c = dma_channel_get_default_config(frame_dma);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, pio_get_dreq(pio, sm1, true));
 
-  output_word_0 = 0x00FFFFFFFF;  // no buttons pushed
-  output_word_1 = 0x00000000FF;  // no buttons pushed
+  for (int i = 0; i < SCAN_MAX * 2; i += 2)
+  {
+    frame_table[0][i]     = 0x00000000FF; // no buttons pushed (player 5)
+    frame_table[0][i + 1] = 0x00FFFFFFFF; // no buttons pushed (players 1-4)
+  }
 
-  init_time = get_absolute_time();
+  // the first frame reads no buttons, its end arms the first player frame
+  dma_channel_configure(frame_dma, &c, &pio->txf[sm1], frame_table[0], SCAN_MAX * 2, true);
 }
 
-// init turbo button timings
+// init turbo button timings. these used to count update_output calls:
+// clk_sys / 2 MHz = 62 and clk_sys / 20 MHz = 6 of them, at about 31 calls
+// a frame while idle (one per 600us without a scan, one per scan). that
+// is a toggle every 2 frames, and several within a frame, which the
+// console can only see as one per frame.
 void turbo_init()
 {
-    cpu_frequency = clock_get_hz(clk_sys);
-    turbo_frequency = 1000000; // Default turbo frequency
-    timer_threshold_a = cpu_frequency / (turbo_frequency * 2);
-    timer_threshold_b = cpu_frequency / (turbo_frequency * 20);
-    timer_threshold = timer_threshold_a;
+    timer_threshold_a = TURBO_FRAMES_SLOW;
+    timer_threshold_b = TURBO_FRAMES_FAST;
+    timer_threshold = config_get(CONFIG_KEY_TURBO) ? timer_threshold_b : timer_threshold_a;
 }
 
-// task process for checking pcengine polling cycles
-void pce_task()
+//
+// latch_frame - takes the newest player frame and latches mouse movement
+//               for the next frame (core1, only between frames). motion
+//               past one frame's range stays accumulated for later reads.
+//
+static inline int16_t mouse_frame_delta(int16_t global)
 {
-  //
-  // check time offset in order to detect when a PCE scan is no longer
-  // in process (so that fresh values can be sent to the state machine)
-  //
-  current_time = get_absolute_time();
-
-  if (absolute_time_diff_us(init_time, current_time) > reset_period) {
-    state = 3;
-    update_output();
-    output_exclude = false;
-    init_time = get_absolute_time();
-  }
+  return global < -127 ? -127 : global > 127 ? 127 : global;
 }
 
-//
+static void __not_in_flash_func(latch_frame)(void)
+{
+  // the previous frame is kept if core0 published nothing new, its movement
+  // is rebuilt below and the turbo state may have changed
+  players_snapshot(&frame);
+
+  unsigned short int i;
+  for (i = 0; i < MAX_PLAYERS; ++i)
+  {
+    frame.players[i].output_analog_1x = mouse_frame_delta(frame.players[i].global_x);
+    frame.players[i].output_analog_1y = mouse_frame_delta(frame.players[i].global_y);
+  }
+
+  update_output();
+}
 
 //
-// core1_entry - inner-loop for the second core
-//             - when the "CLR" line is de-asserted, set lock flag
-//               protecting the output state machine from inconsistent data
+// scan_task - handles the next clock program event (core1). plex and its
+//             dma are only rearmed at a frame end: by then the console has
+//             read every scan, and the next one is at least a frame away.
+//             the words of every scan are already queued by dma when the
+//             scan starts.
 //
-void __not_in_flash_func(core1_entry)(void)
+void __not_in_flash_func(scan_task)(void)
 {
-  static bool rx_bit = 0;
+  // sleep until a clock event. the fifo interrupt is left disabled, but
+  // going pending still raises the event that ends __wfe (SEVONPEND)
+  irq_clear(PIO0_IRQ_0);
+  while (pio_sm_is_rx_fifo_empty(pio, sm2)) __wfe();
 
-  while (1)
+  if (pio_sm_get(pio, sm2) == CLOCK_FRAME_END)
   {
-    // wait for (and sync with) negedge of CLR signal; rx_data is throwaway
-    rx_bit = pio_sm_get_blocking(pio, sm2);
+    scan = 0;
+    turbo_tick();
+    latch_frame();
+    return;
+  }
 
-    // Now we are in an update-sequence; set a lock
-    // to prevent update during output transaction
-    output_exclude = true;
+  scan++;
+  latency_wire(&frame);
 
-    // assume data is already formatted in output_word and push it to the state machine
-    pio_sm_put(pio, sm1, output_word_1);
-    pio_sm_put(pio, sm1, output_word_0);
+  if (scan == SCAN_STATES)
+  {
+    // scan done, the next one is a frame away
+    flash_store_poll();
 
-    // Sequence from state 3 down through state 0 (show different nybbles to PCE)
-    //
-    // Note that when state = zero, it doesn't transition to a next state; the reset to
-    // state 3 will happen as part of a timed process on the second CPU & state machine
-    //
+    unsigned short int i;
+    for (i = 0; i < MAX_PLAYERS; ++i) {
+      // hand delivered movement back to core0
+      players_consume(&frame, i, frame.players[i].output_analog_1x, frame.players[i].output_analog_1y);
 
-    // Also note that staying in 'scan' (CLK = low, SEL = high), is not expected
-    // last more than about a half of a millisecond
-    //
-    loop_time = get_absolute_time();
-    while ((gpio_get(CLKIN_PIN) == 0) && (gpio_get(DATAIN_PIN) == 1))
-    {
-      if (absolute_time_diff_us(loop_time, get_absolute_time()) > 550)
-      {
-        state = 0;
-        break;
-      }
+      // keep the output values zeroed until the next frame is latched
+      frame.players[i].output_analog_1x = 0;
+      frame.players[i].output_analog_1y = 0;
     }
+  }
+}
 
-    if (state != 0)
-    {
-      state--;
-      update_output();
-
-      // renew countdown timeframe
-      init_time = get_absolute_time();
-    }
-    else
-    {
-      update_output();
+//
+// core1_entry - inner-loop for the second core
+//             - owns the scan count and frame table. fresh player frames
+//               are only taken between frames so the PCE always reads a
+//               consistent set of values.
+//             - the clock program reports every scan and the end of each
+//               frame, so core1 sleeps between them.
+//
+void __not_in_flash_func(core1_entry)(void)
+{
+  // park in ram while core0 writes flash
+  multicore_lockout_victim_init();
 
-      unsigned short int i;
-      for (i = 0; i < MAX_PLAYERS; ++i) {
-        // decrement outputs from globals
-        players[i].global_x = (players[i].global_x - players[i].output_analog_1x);
-        players[i].global_y = (players[i].global_y - players[i].output_analog_1y);
+  // wake on clock events instead of spinning on the fifo
+  pio_set_irq0_source_enabled(pio, pis_sm0_rx_fifo_not_empty + sm2, true);
+  scb_hw->scr |= M0PLUS_SCR_SEVONPEND_BITS;
 
-        players[i].output_analog_1x = 0;
-        players[i].output_analog_1y = 0;
-        players[i].output_buttons = players[i].global_buttons & players[i].altern_buttons;
-      }
+  while (1) scan_task();
+}
 
-      output_exclude = true;            // continue to lock the output values (which are now zero)
-    }
+//
+// turbo_tick - advances the turbo timer by one frame
+//
+static void __not_in_flash_func(turbo_tick)(void)
+{
+  turbo_timer++;
+  if (turbo_timer >= frame.turbo_threshold)
+  {
+    turbo_timer = 0;
+    turbo_state = !turbo_state;
   }
 }
 
 //
-// update_output - updates output_word with multi-tap plex data that
-//                 is sent to PCE based on state and device types
+// update_output - builds the multi-tap frame table for the next frame and
+//                 hands it to dma (core1, between frames)
 //
 void __not_in_flash_func(update_output)(void)
 {
+  int back = frame_front ^ 1;
 
-  static uint32_t turbo_timer = 0;
-  static bool turbo_state = false;
-  int8_t bytes[5] = { 0 };
-  int16_t hotkey = 0;
-
-  // Increment the timer and check if it reaches the threshold
-  turbo_timer++;
-  if (turbo_timer >= timer_threshold)
+  for (int i = 0; i < SCAN_STATES; ++i)
   {
-    turbo_timer = 0;
-    turbo_state = !turbo_state;
+    encode_scan(SCAN_STATES - 1 - i, &frame_table[back][i * 2]);
+  }
+  for (int i = SCAN_STATES; i < SCAN_MAX; ++i)
+  {
+    frame_table[back][i * 2]     = frame_table[back][(SCAN_STATES - 1) * 2];
+    frame_table[back][i * 2 + 1] = frame_table[back][(SCAN_STATES - 1) * 2 + 1];
   }
+  frame_front = back;
+
+  // drop what is left of the previous table and stream the new one. plex
+  // restarts at sel so the next CLR high takes pair 0, whatever it pulled
+  // or was blocked on before
+  dma_channel_abort(frame_dma);
+  pio_sm_clear_fifos(pio, sm1);
+  pio_sm_restart(pio, sm1);
+  pio_sm_exec(pio, sm1, pio_encode_jmp(plex_offset + plex_offset_sel));
+  dma_channel_transfer_from_buffer_now(frame_dma, frame_table[frame_front], SCAN_MAX * 2);
+}
+
+//
+// encode_scan - encodes the plex word pair of one nybble state, based on
+//               device types (core1, from the latched player frame)
+//
+static void __not_in_flash_func(encode_scan)(int state, uint32_t words[2])
+{
+  int8_t bytes[5] = { 0 };
+  int16_t hotkey = 0;
 
   unsigned short int i;
   for (i = 0; i < MAX_PLAYERS; ++i)
   {
     // base controller/mouse buttons
-    int8_t byte = (players[i].output_buttons & 0xff);
+    int8_t byte = (frame.players[i].output_buttons & 0xff);
 
-    if (i >= playersCount && !hotkey)
+    if (!frame.players[i].dev_addr && !hotkey)
     {
       bytes[i] = 0xff;
       continue;
     }
 
-    // check for 6-button enable/disable hotkeys
-    if (!(players[i].output_buttons & 0b0000000010000001))
-      players[i].button_mode = BUTTON_MODE_6;
-    else if (!(players[i].output_buttons & 0b0000000010000100))
-      players[i].button_mode = BUTTON_MODE_2;
-    else if (!(players[i].output_buttons & 0b0000000010000010))
-      players[i].button_mode = BUTTON_MODE_3_SEL;
-    else if (!(players[i].output_buttons & 0b0000000010001000))
-      players[i].button_mode = BUTTON_MODE_3_RUN;
-
     // Turbo EverDrive Pro hot-key fix
     if (hotkey)
     {
@@ -226,31 +288,31 @@ void __not_in_flash_func(update_output)(void)
     }
     else if (i == 0)
     {
-      int16_t btns= (~players[i].output_buttons & 0xff);
+      int16_t btns= (~frame.players[i].output_buttons & 0xff);
       if     (btns == 0x82) hotkey = ~0x82; // RUN + RIGHT
       else if(btns == 0x88) hotkey = ~0x88; // RUN + LEFT
       else if(btns == 0x84) hotkey = ~0x84; // RUN + DOWN
     }
 
-    bool has6Btn = !(players[i].output_buttons & 0x0800);
-    bool isMouse = !(players[i].output_buttons & 0x000f);
-    bool is6btn = has6Btn && players[i].button_mode == BUTTON_MODE_6;
-    bool is3btnSel = has6Btn && players[i].button_mode == BUTTON_MODE_3_SEL;
-    bool is3btnRun = has6Btn && players[i].button_mode == BUTTON_MODE_3_RUN;
+    bool has6Btn = !(frame.players[i].output_buttons & 0x0800);
+    bool isMouse = frame.players[i].is_mouse;
+    bool is6btn = has6Btn && frame.players[i].button_mode == BUTTON_MODE_6;
+    bool is3btnSel = has6Btn && frame.players[i].button_mode == BUTTON_MODE_3_SEL;
+    bool is3btnRun = has6Btn && frame.players[i].button_mode == BUTTON_MODE_3_RUN;
 
     // 6 button extra four buttons (III/IV/V/VI)
     if (is6btn)
     {
       if (state == 2)
       {
-        byte = ((players[i].output_buttons>>8) & 0xf0);
+        byte = ((frame.players[i].output_buttons>>8) & 0xf0);
       }
     }
 
     //
     else if (is3btnSel)
     {
-      if ((~(players[i].output_buttons>>8)) & 0x30)
+      if ((~(frame.players[i].output_buttons>>8)) & 0x30)
       {
         byte &= 0b01111111;
       }
@@ -259,7 +321,7 @@ void __not_in_flash_func(update_output)(void)
     //
     else if (is3btnRun)
     {
-      if ((~(players[i].output_buttons>>8)) & 0x30)
+      if ((~(frame.players[i].output_buttons>>8)) & 0x30)
       {
         byte &= 0b10111111;
       }
@@ -271,34 +333,34 @@ void __not_in_flash_func(update_output)(void)
       if (turbo_state)
       {
         // Set the button state as pressed
-        if ((~(players[i].output_buttons>>8)) & 0x20) byte &= 0b11011111;
-        if ((~(players[i].output_buttons>>8)) & 0x10) byte &= 0b11101111;
+        if ((~(frame.players[i].output_buttons>>8)) & 0x20) byte &= 0b11011111;
+        if ((~(frame.players[i].output_buttons>>8)) & 0x10) byte &= 0b11101111;
       }
       else
       {
         // Set the button state as released
       }
-
-      if ((~(players[i].output_buttons>>8)) & 0x40) timer_threshold = timer_threshold_a;
-      if ((~(players[i].output_buttons>>8)) & 0x80) timer_threshold = timer_threshold_b;
     }
 
     // mouse x/y states
     if (isMouse)
     {
+      // movement nybbles take the place of the dpad
+      byte &= 0xf0;
+
       switch (state)
       {
         case 3: // state 3: x most significant nybble
-          byte |= (((players[i].output_analog_1x>>1) & 0xf0) >> 4);
+          byte |= ((frame.players[i].output_analog_1x & 0xf0) >> 4);
         break;
         case 2: // state 2: x least significant nybble
-          byte |= (((players[i].output_analog_1x>>1) & 0x0f));
+          byte |= ((frame.players[i].output_analog_1x & 0x0f));
         break;
         case 1: // state 1: y most significant nybble
-          byte |= (((players[i].output_analog_1y>>1) & 0xf0) >> 4);
+          byte |= ((frame.players[i].output_analog_1y & 0xf0) >> 4);
         break;
         case 0: // state 0: y least significant nybble
-          byte |= (((players[i].output_analog_1y>>1) & 0x0f));
+          byte |= ((frame.players[i].output_analog_1y & 0x0f));
         break;
       }
     }
@@ -306,135 +368,90 @@ void __not_in_flash_func(update_output)(void)
     bytes[i] = byte;
   }
 
-  output_word_0 = ((bytes[0] & 0xff))      | // player 1
-                  ((bytes[1] & 0xff) << 8) | // player 2
-                  ((bytes[2] & 0xff) << 16)| // player 3
-                  ((bytes[3] & 0xff) << 24); // player 4
-  output_word_1 = ((bytes[4] & 0xff));       // player 5
-
-  codes_task();
-
-  update_pending = true;
+  words[0] = ((bytes[4] & 0xff));       // player 5
+  words[1] = ((bytes[0] & 0xff))      | // player 1
+             ((bytes[1] & 0xff) << 8) | // player 2
+             ((bytes[2] & 0xff) << 16)| // player 3
+             ((bytes[3] & 0xff) << 24); // player 4
 }
 
 
 //
-// post_globals - accumulate the many intermediate mouse scans (~1ms)
-//                into an accumulator which will be reported back to PCE
+// encode_input - maps routed input onto the PCE player and flags a new
+//                frame for core1. mouse movement stays accumulated in
+//                global_x/y until core1 latches it between scans.
 //
-void __not_in_flash_func(post_globals)(
-  uint8_t dev_addr, int8_t instance, uint32_t buttons,
-  uint8_t analog_1x, uint8_t analog_1y, uint8_t analog_2x,
-  uint8_t analog_2y, uint8_t analog_l, uint8_t analog_r,
-  uint32_t keys, uint8_t quad_x)
+void __not_in_flash_func(encode_input)(int player_index, const input_state_t* input)
 {
-  bool has6Btn = !(buttons & 0x0800);
+  Player_t* player = &players[player_index];
 
-  // for merging extra device instances into the root instance (ex: joycon charging grip)
-  bool is_extra = (instance == -1);
-  if (is_extra) instance = 0;
-
-  int player_index = find_player_index(dev_addr, instance);
-  uint16_t buttons_pressed = (~(buttons | 0x0800)) || keys;
-  if (player_index < 0 && buttons_pressed)
-  {
-    printf("[add player] [%d, %d]\n", dev_addr, instance);
-    player_index = add_player(dev_addr, instance);
-  }
-
-  // printf("[player_index] [%d] [%d, %d]\n", player_index, dev_addr, instance);
-
-  if (player_index >= 0)
+  if (!input->is_mouse)
   {
     // map analog to dpad movement here
+    uint32_t dpad = 0;
     uint8_t dpad_offset = 32;
-    if (analog_1x)
+    if (input->analog_1x)
     {
-      if (analog_1x > 128 + dpad_offset) buttons &= ~(0x02); // right
-      else if (analog_1x < 128 - dpad_offset) buttons &= ~(0x08); // left
+      if (input->analog_1x > 128 + dpad_offset) dpad |= 0x02; // right
+      else if (input->analog_1x < 128 - dpad_offset) dpad |= 0x08; // left
     }
-    if (analog_1y)
+    if (input->analog_1y)
     {
-      if (analog_1y > 128 + dpad_offset) buttons &= ~(0x01); // up
-      else if (analog_1y < 128 - dpad_offset) buttons &= ~(0x04); // down
+      if (input->analog_1y > 128 + dpad_offset) dpad |= 0x01; // up
+      else if (input->analog_1y < 128 - dpad_offset) dpad |= 0x04; // down
     }
 
-    // extra instance buttons to merge with root player
-    if (is_extra)
-    {
-      players[0].altern_buttons = buttons;
-    }
-    else
-    {
-      players[player_index].global_buttons = buttons;
-    }
-
-    // TODO: 
-    //  - Map home button to S1 + S2
-
-    // TODO:
-    //  - May need to output_exclude on 6-button?
-
-    // if (!output_exclude || !isMouse)
-    // {
-      players[player_index].output_buttons = players[player_index].global_buttons & players[player_index].altern_buttons;
-
-      // basic socd (up priority, left+right neutral)
-      if (((~players[player_index].output_buttons) & 0x01) && ((~players[player_index].output_buttons) & 0x04)) {
-        players[player_index].output_buttons ^= 0x04;
-      }
-      if (((~players[player_index].output_buttons) & 0x02) && ((~players[player_index].output_buttons) & 0x08)) {
-        players[player_index].output_buttons ^= 0x0a;
-      }
-
-      update_output();
-    // }
+    // extra instance buttons are merged into the root player
+    if (input->instance == -1) player->altern_buttons &= ~dpad;
+    else player->global_buttons &= ~dpad;
   }
-}
 
-//
-// post_mouse_globals - accumulate the many intermediate mouse scans (~1ms)
-//                into an accumulator which will be reported back to PCE
-//
-void __not_in_flash_func(post_mouse_globals)(
-  uint8_t dev_addr, int8_t instance, uint16_t buttons,
-  uint8_t delta_x, uint8_t delta_y, uint8_t quad_x)
-{
-  // for merging extra device instances into the root instance (ex: joycon charging grip)
-  bool is_extra = (instance == -1);
-  if (is_extra) instance = 0;
+  // TODO:
+  //  - Map home button to S1 + S2
+
+  player->output_buttons = ~remap_buttons(player_index, player->global_buttons & player->altern_buttons);
 
-  int player_index = find_player_index(dev_addr, instance);
-  uint16_t buttons_pressed = (~(buttons | 0x0f00));
-  if (player_index < 0 && buttons_pressed)
+  if (!input->is_mouse)
   {
-    printf("[add player] [%d, %d]\n", dev_addr, instance);
-    player_index = add_player(dev_addr, instance);
+    // basic socd (up priority, left+right neutral)
+    if (((~player->output_buttons) & 0x01) && ((~player->output_buttons) & 0x04)) {
+      player->output_buttons ^= 0x04;
+    }
+    if (((~player->output_buttons) & 0x02) && ((~player->output_buttons) & 0x08)) {
+      player->output_buttons ^= 0x0a;
+    }
   }
 
-  // printf("[player_index] [%d] [%d, %d]\n", player_index, dev_addr, instance);
-
-  if (player_index >= 0)
+  // check for 6-button enable/disable hotkeys
+  if (!(player->output_buttons & 0b0000000010000001))
+    player->button_mode = BUTTON_MODE_6;
+  else if (!(player->output_buttons & 0b0000000010000100))
+    player->button_mode = BUTTON_MODE_2;
+  else if (!(player->output_buttons & 0b0000000010000010))
+    player->button_mode = BUTTON_MODE_3_SEL;
+  else if (!(player->output_buttons & 0b0000000010001000))
+    player->button_mode = BUTTON_MODE_3_RUN;
+
+  config_set(CONFIG_KEY_BUTTON_MODE + player_index, player->button_mode);
+
+  // turbo speed hotkeys (L/R), only where X/Y are turbo II/I. core1 sees
+  // the new speed through the next published frame.
+  bool has6Btn = !(player->output_buttons & 0x0800);
+  if (!has6Btn || player->button_mode == BUTTON_MODE_2)
   {
-    players[player_index].global_buttons = buttons;
-
-    if (delta_x >= 128)
-      players[player_index].global_x = players[player_index].global_x - (256-delta_x);
-    else
-      players[player_index].global_x = players[player_index].global_x + delta_x;
-
-    if (delta_y >= 128)
-      players[player_index].global_y = players[player_index].global_y - (256-delta_y);
-    else
-      players[player_index].global_y = players[player_index].global_y + delta_y;
-
-    if (!output_exclude)
+    if ((~(player->output_buttons>>8)) & 0x40)
     {
-      players[player_index].output_analog_1x = players[player_index].global_x;
-      players[player_index].output_analog_1y = players[player_index].global_y;
-      players[player_index].output_buttons = players[player_index].global_buttons & players[player_index].altern_buttons;
-
-      update_output();
+      timer_threshold = timer_threshold_a;
+      config_set(CONFIG_KEY_TURBO, 0);
+    }
+    if ((~(player->output_buttons>>8)) & 0x80)
+    {
+      timer_threshold = timer_threshold_b;
+      config_set(CONFIG_KEY_TURBO, 1);
     }
   }
+
+  codes_task();
+
+  update_pending = true;
 }
@@ -7,14 +7,15 @@
 
 #include "tusb.h"
 #include "hardware/pio.h"
+#include "hardware/dma.h"
 #include "plex.pio.h"
 #include "clock.pio.h"
 #include "select.pio.h"
 #include "globals.h"
 
 // Define constants
-#undef MAX_PLAYERS
-#define MAX_PLAYERS 5               // PCE supports up to 5 players
+#undef MOUSE_BASE_GAIN
+#define MOUSE_BASE_GAIN 128         // pce mice move at half the usb count
 
 // ADAFRUIT_KB2040                  // build for Adafruit KB2040 board
 #define DATAIN_PIN  18
@@ -24,6 +25,18 @@
 #define OUTD2_PIN   28
 #define OUTD3_PIN   29
 
+// nybble states (scans) of one multitap frame
+#define SCAN_STATES 4
+// scans of one frame the table covers. past SCAN_STATES the nybble state
+// stays at 0 until the frame ends. more scans than this stall plex on its
+// last pair until the frame end rearms it
+#define SCAN_MAX    16
+
+// turbo toggle periods in frames, picked with L (slow) and R (fast). the
+// console reads the buttons once a frame, so one frame is the fastest
+#define TURBO_FRAMES_SLOW 2
+#define TURBO_FRAMES_FAST 1
+
 // PCE button modes
 #define BUTTON_MODE_2 0x00
 #define BUTTON_MODE_6 0x01
@@ -31,26 +44,19 @@
 #define BUTTON_MODE_3_RUN 0x03
 
 // Declaration of global variables
-uint64_t cpu_frequency;
-uint64_t timer_threshold;
-uint64_t timer_threshold_a;
-uint64_t timer_threshold_b;
-uint64_t turbo_frequency;
+uint32_t timer_threshold; // frames per turbo toggle, set by core0 hotkeys
+uint32_t timer_threshold_a;
+uint32_t timer_threshold_b;
 
 PIO pio;
 uint sm1, sm2, sm3; // sm1 = plex; sm2 = clock, sm3 = select
 
 // Function declarations
 void pce_init(void);
-void pce_task(void);
 void turbo_init(void);
+void __not_in_flash_func(scan_task)(void);
 void __not_in_flash_func(core1_entry)(void);
 void __not_in_flash_func(update_output)(void);
-void __not_in_flash_func(post_globals)(uint8_t dev_addr, int8_t instance,
-  uint32_t buttons, uint8_t analog_1x, uint8_t analog_1y,
-  uint8_t analog_2x, uint8_t analog_2y, uint8_t analog_l,
-  uint8_t analog_r, uint32_t keys, uint8_t quad_x);
-void __not_in_flash_func(post_mouse_globals)(uint8_t dev_addr, int8_t instance,
-  uint16_t buttons, uint8_t delta_x, uint8_t delta_y, uint8_t quad_x);
+void __not_in_flash_func(encode_input)(int player_index, const input_state_t* input);
 
 #endif // PCENGINE_H
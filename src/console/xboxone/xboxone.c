@@ -1,14 +1,48 @@
 // xboxone.c
 
 #include "xboxone.h"
+#include "latency.h"
+#include "flash_store.h"
+#include "remap.h"
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
 #include "tusb.h"
 
+// buttons wired straight to the controller board, above the expander bits
+#define XB1_GPIO_B     0x10000
+#define XB1_GPIO_GUIDE 0x20000
+#define XB1_GPIO_R3    0x40000
+#define XB1_GPIO_L3    0x80000
+
+// expander (i2c buffer [1]:[0]) and gpio bits of each usbretro button
+static const uint32_t xb1_button_targets[REMAP_BUTTONS] = {
+  0x0200,         // up
+  0x0400,         // right
+  0x1000,         // down
+  0x0800,         // left
+  XB1_GPIO_B,     // b
+  0x8000,         // a
+  0x2000,         // view
+  0x0080,         // menu
+  0,              // l2, analog only
+  0,              // r2, analog only
+  XB1_GPIO_GUIDE, // guide
+  0,              // 6-button flag
+  0x0008,         // y
+  0x0002,         // x
+  0x0020,         // l
+  0x0010,         // r
+  XB1_GPIO_L3,    // l3
+  XB1_GPIO_R3,    // r3
+};
+
 // init for xboxone communication
 void xb1_init()
 {
   sleep_ms(1000);
 
+  remap_init(xb1_button_targets);
+
   // corrects UART serial output after overclock
   stdio_init_all();
 
@@ -94,6 +128,9 @@ void i2c_slave_handler(i2c_inst_t *i2c, i2c_slave_event_t event)
       // printf("[REQUEST]:: 0x%x 0x%x", i2c_slave_read_buffer[0], i2c_slave_read_buffer[1]);
 
       i2c_write_raw_blocking(i2c, i2c_slave_read_buffer, sizeof(i2c_slave_read_buffer));
+
+      // the console's reads pace flash writes, as polls do on other consoles
+      flash_store_poll();
     break;
 
     default:
@@ -150,18 +187,27 @@ void mcp4728_power_down(i2c_inst_t *i2c, uint8_t address, uint8_t channel, uint8
 // core1_entry - inner-loop for the second core
 void __not_in_flash_func(core1_entry)(void)
 {
+  static players_frame_t frame;
+
+  // park in ram while core0 writes flash
+  multicore_lockout_victim_init();
+
   while (1)
   {
+    // Pick up the newest player state published by core0
+    bool fresh = players_snapshot(&frame);
+    player_output_t const* player = &frame.players[frame.root];
+
     // Analog outputs
-    uint16_t x1Val = ((players[0].output_analog_1x * 2047)/255);
-    uint16_t y1Val = ((players[0].output_analog_1y * 2047)/255);
+    uint16_t x1Val = ((player->output_analog_1x * 2047)/255);
+    uint16_t y1Val = ((player->output_analog_1y * 2047)/255);
              y1Val = (y1Val - 2047) * -1;
-    uint16_t x2Val = ((players[0].output_analog_2x * 2047)/255);
-    uint16_t y2Val = ((players[0].output_analog_2y * 2047)/255);
+    uint16_t x2Val = ((player->output_analog_2x * 2047)/255);
+    uint16_t y2Val = ((player->output_analog_2y * 2047)/255);
              y2Val = (y2Val - 2047) * -1;
-    uint16_t lVal = ((players[0].output_analog_l * 2047)/255);
+    uint16_t lVal = ((player->output_analog_l * 2047)/255);
              lVal = (lVal - 2047) * -1;
-    uint16_t rVal = ((players[0].output_analog_r * 2047)/255);
+    uint16_t rVal = ((player->output_analog_r * 2047)/255);
              rVal = (rVal - 2047) * -1;
 
     mcp4728_write_dac(I2C_DAC_PORT, MCP4728_I2C_ADDR0, 0, x1Val);
@@ -172,59 +218,48 @@ void __not_in_flash_func(core1_entry)(void)
     mcp4728_write_dac(I2C_DAC_PORT, MCP4728_I2C_ADDR1, 1, rVal);
 
     // Individual buttons
-    gpio_put(XBOX_B_BTN_PIN, ((players[0].output_buttons & 0x0010) == 0) ? 0 : 1);
-    gpio_put(XBOX_GUIDE_PIN, ((players[0].output_buttons & 0x0400) == 0) ? 0 : 1);
-    gpio_put(XBOX_R3_BTN_PIN, ((players[0].output_buttons & 0x20000) == 0) ? 0 : 1);
-    gpio_put(XBOX_L3_BTN_PIN, ((players[0].output_buttons & 0x10000) == 0) ? 0 : 1);
+    uint32_t pressed = remap_buttons(frame.root, player->output_buttons);
+    gpio_put(XBOX_B_BTN_PIN, (pressed & XB1_GPIO_B) ? 0 : 1);
+    gpio_put(XBOX_GUIDE_PIN, (pressed & XB1_GPIO_GUIDE) ? 0 : 1);
+    gpio_put(XBOX_R3_BTN_PIN, (pressed & XB1_GPIO_R3) ? 0 : 1);
+    gpio_put(XBOX_L3_BTN_PIN, (pressed & XB1_GPIO_L3) ? 0 : 1);
+    latency_wire(&frame);
 
-    update_pending = false;
+    // mouse movement in a frame is delivered once
+    if (!fresh) continue;
 
     unsigned short int i;
     for (i = 0; i < MAX_PLAYERS; ++i)
     {
       // decrement outputs from globals
-      if (players[i].global_x != 0)
+      if (frame.players[i].global_x != 0)
       {
-        players[i].global_x = (players[i].global_x - (players[i].output_analog_1x - 128));
-        // if (players[i].global_x > 128) players[i].global_x = 128;
-        // if (players[i].global_x < -128) players[i].global_x = -128;
-        players[i].output_analog_1x = 128;
+        players_consume(&frame, i, frame.players[i].output_analog_1x - 128, 0);
+        frame.players[i].output_analog_1x = 128;
       }
-      if (players[i].global_y != 0)
+      if (frame.players[i].global_y != 0)
       {
-        players[i].global_y = (players[i].global_y - (players[i].output_analog_1y - 128));
-        // if (players[i].global_y > 128) players[i].global_y = 128;
-        // if (players[i].global_y < -128) players[i].global_y = -128;
-        players[i].output_analog_1y = 128;
+        players_consume(&frame, i, 0, frame.players[i].output_analog_1y - 128);
+        frame.players[i].output_analog_1y = 128;
       }
     }
-    update_output();
   }
 }
 
 //
 // update_output - updates i2c slave buffer with GPIO expander button bits
+//                 (core0, also where the i2c slave irq is serviced)
 void __not_in_flash_func(update_output)(void)
 {
   unsigned short int i;
-  for (i = 0; i < playersCount; ++i)
+  for (i = 0; i < MAX_PLAYERS; ++i)
   {
-    // base controller buttons
-    int16_t byte = (players[i].output_buttons & 0xffff);
-    i2c_slave_read_buffer[0] = 0xFA;
-    i2c_slave_read_buffer[0] ^= ((byte & 0x02000) == 0) ? 0x02 : 0; // X
-    i2c_slave_read_buffer[0] ^= ((byte & 0x01000) == 0) ? 0x08 : 0; // Y
-    i2c_slave_read_buffer[0] ^= ((byte & 0x08000) == 0) ? 0x10 : 0; // R
-    i2c_slave_read_buffer[0] ^= ((byte & 0x04000) == 0) ? 0x20 : 0; // L
-    i2c_slave_read_buffer[0] ^= ((byte & 0x0080) == 0) ? 0x80 : 0; // MENU
-
-    i2c_slave_read_buffer[1] = 0xFF;
-    i2c_slave_read_buffer[1] ^= ((byte & 0x0001) == 0) ? 0x02 : 0; // UP
-    i2c_slave_read_buffer[1] ^= ((byte & 0x0002) == 0) ? 0x04 : 0; // RIGHT
-    i2c_slave_read_buffer[1] ^= ((byte & 0x0004) == 0) ? 0x10 : 0; // DOWN
-    i2c_slave_read_buffer[1] ^= ((byte & 0x0008) == 0) ? 0x08 : 0; // LEFT
-    i2c_slave_read_buffer[1] ^= ((byte & 0x0040) == 0) ? 0x20 : 0; // VIEW
-    i2c_slave_read_buffer[1] ^= ((byte & 0x0020) == 0) ? 0x80 : 0; // A
+    if (!players[i].dev_addr) continue;
+
+    // base controller buttons, pressed expander bits are pulled low
+    uint32_t pressed = remap_buttons(i, players[i].output_buttons);
+    i2c_slave_read_buffer[0] = 0xFA ^ (pressed & 0xff);
+    i2c_slave_read_buffer[1] = 0xFF ^ ((pressed >> 8) & 0xff);
   }
 
   codes_task();
@@ -233,161 +268,44 @@ void __not_in_flash_func(update_output)(void)
 }
 
 //
-// post_globals - accumulate button and analog values
+// encode_input - maps routed input onto the Xbox One player
 //
-void __not_in_flash_func(post_globals)(
-  uint8_t dev_addr,
-  int8_t instance,
-  uint32_t buttons,
-  uint8_t analog_1x,
-  uint8_t analog_1y,
-  uint8_t analog_2x,
-  uint8_t analog_2y,
-  uint8_t analog_l,
-  uint8_t analog_r,
-  uint32_t keys,
-  uint8_t quad_x)
+void __not_in_flash_func(encode_input)(int player_index, const input_state_t* input)
 {
-  bool has6Btn = !(buttons & 0x0800);
+  Player_t* player = &players[player_index];
 
-  // for merging extra device instances into the root instance (ex: joycon charging grip)
-  bool is_extra = (instance == -1);
-  if (is_extra) instance = 0;
-
-  int player_index = find_player_index(dev_addr, instance);
-  uint16_t buttons_pressed = (~(buttons | 0x0800)) || keys;
-  if (player_index < 0 && buttons_pressed)
+  if (input->is_mouse)
   {
-    printf("[add player] [%d, %d]\n", dev_addr, instance);
-    player_index = add_player(dev_addr, instance);
-  }
+    // relative movement is sent as stick deflection (1-255)
+    if (player->global_x > 127) player->output_analog_1x = 0xff;
+    else if (player->global_x < -127) player->output_analog_1x = 1;
+    else player->output_analog_1x = 128 + player->global_x;
 
-  // printf("[player_index] [%d] [%d, %d]\n", player_index, dev_addr, instance);
+    if (player->global_y > 127) player->output_analog_1y = 0xff;
+    else if (player->global_y < -127) player->output_analog_1y = 1;
+    else player->output_analog_1y = 128 + player->global_y;
 
-  if (player_index >= 0)
+    player->output_buttons = input->buttons;
+  }
+  else
   {
-    // extra instance buttons to merge with root player
-    if (is_extra)
-    {
-      players[0].altern_buttons = buttons;
-    }
-    else
-    {
-      players[player_index].global_buttons = buttons;
-    }
-
     // maps View + Menu + Up button combo to Guide button
-    if (!((players[player_index].global_buttons) & 0xC1)) {
-      players[player_index].global_buttons ^= 0x400;
-      players[player_index].global_buttons |= 0xC1;
+    if (!((player->global_buttons) & 0xC1)) {
+      player->global_buttons ^= 0x400;
+      player->global_buttons |= 0xC1;
     }
 
-    // cache analog and button values to player object
-    if (analog_1x) players[player_index].output_analog_1x = analog_1x;
-    if (analog_1y) players[player_index].output_analog_1y = analog_1y;
-    if (analog_2x) players[player_index].output_analog_2x = analog_2x;
-    if (analog_2y) players[player_index].output_analog_2y = analog_2y;
-    players[player_index].output_analog_l = analog_l;
-    players[player_index].output_analog_r = analog_r;
-    players[player_index].output_buttons = players[player_index].global_buttons & players[player_index].altern_buttons;
+    player->output_buttons = player->global_buttons & player->altern_buttons;
 
-    if (!((players[player_index].output_buttons) & 0x00200))
+    if (!((player->output_buttons) & 0x00200))
     {
-      players[player_index].output_analog_r = 255;
+      player->output_analog_r = 255;
     }
-    if (!((players[player_index].output_buttons) & 0x00100))
+    if (!((player->output_buttons) & 0x00100))
     {
-      players[player_index].output_analog_l = 255;
+      player->output_analog_l = 255;
     }
-    update_output();
   }
-}
-
-//
-// post_mouse_globals - accumulate the many intermediate mouse scans (~1ms)
-//
-void __not_in_flash_func(post_mouse_globals)(
-  uint8_t dev_addr,
-  int8_t instance,
-  uint16_t buttons,
-  uint8_t delta_x,
-  uint8_t delta_y,
-  uint8_t quad_x)
-{
-  // for merging extra device instances into the root instance (ex: joycon charging grip)
-  bool is_extra = (instance == -1);
-  if (is_extra) instance = 0;
-
-  int player_index = find_player_index(dev_addr, instance);
-  uint16_t buttons_pressed = (~(buttons | 0x0f00));
-  if (player_index < 0 && buttons_pressed)
-  {
-    printf("[add player] [%d, %d]\n", dev_addr, instance);
-    player_index = add_player(dev_addr, instance);
-  }
-
-  // printf("[player_index] [%d] [%d, %d]\n", player_index, dev_addr, instance);
-
-  if (player_index >= 0)
-  {
-    if (delta_x == 0) delta_x = 1;
-    if (delta_y == 0) delta_y = 1;
-
-    if (delta_x >= 128)
-    {
-      players[player_index].global_x = players[player_index].global_x - (256-delta_x);
-    }
-    else
-    {
-      players[player_index].global_x = players[player_index].global_x + delta_x;
-    }
-
-    if (players[player_index].global_x > 127)
-    {
-      delta_x = 0xff;
-    }
-    else if (players[player_index].global_x < -127)
-    {
-      delta_x = 1;
-    }
-    else
-    {
-      delta_x = 128 + players[player_index].global_x;
-    }
 
-    if (delta_y >= 128)
-    {
-
-      players[player_index].global_y = players[player_index].global_y - (256-delta_y);
-    }
-    else
-    {
-      players[player_index].global_y = players[player_index].global_y + delta_y;
-    }
-
-    if (players[player_index].global_y > 127)
-    {
-      delta_y = 0xff;
-    }
-    else if (players[player_index].global_y < -127)
-    {
-      delta_y = 1;
-    }
-    else
-    {
-      delta_y = 128 + players[player_index].global_y;
-    }
-
-    // printf("X: %d, Y: %d   ", players[player_index].global_x, players[player_index].global_y);
-    // printf("X1: %d, Y1: %d   ", delta_x, delta_y);
-
-    // cache analog and button values to player object
-    players[player_index].output_analog_1x = delta_x;
-    players[player_index].output_analog_1y = delta_y;
-    // players[player_index].output_analog_2x = delta_x;
-    // players[player_index].output_analog_2y = delta_y;
-    players[player_index].output_buttons = buttons;
-
-    update_output();
-  }
+  update_output();
 }
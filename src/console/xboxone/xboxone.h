@@ -10,9 +10,6 @@
 #include "globals.h"
 
 // Define constants
-#undef MAX_PLAYERS
-#define MAX_PLAYERS 4
-
 // i2c addresses
 #define I2C_SLAVE_ADDRESS 0x21
 #define MCP4728_I2C_ADDR0 0x60
@@ -70,11 +67,6 @@ void i2c_slave_handler(i2c_inst_t *i2c, i2c_slave_event_t event);
 
 void __not_in_flash_func(core1_entry)(void);
 void __not_in_flash_func(update_output)(void);
-void __not_in_flash_func(post_globals)(uint8_t dev_addr, int8_t instance,
-  uint32_t buttons, uint8_t analog_1x, uint8_t analog_1y,
-  uint8_t analog_2x, uint8_t analog_2y, uint8_t analog_l,
-  uint8_t analog_r, uint32_t keys, uint8_t quad_x);
-void __not_in_flash_func(post_mouse_globals)(uint8_t dev_addr, int8_t instance,
-  uint16_t buttons, uint8_t delta_x, uint8_t delta_y, uint8_t quad_x);
+void __not_in_flash_func(encode_input)(int player_index, const input_state_t* input);
 
 #endif // XBOXONE_H
@@ -2,15 +2,13 @@
 #include "8bitdo_bta.h"
 #include "globals.h"
 
-// check if device is 8BitDo Wireless Adapter (D-input)
-bool is_8bitdo_bta(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x2dc8 && (
-    pid == 0x3100 || // 8BitDo Wireless Adapter (Red)
-    pid == 0x3105 || // 8BitDo Wireless Adapter (Black) [05:HID_MODE]
-    pid == 0x3106 || // 8BitDo Wireless Adapter (Black) [06:RECV_MODE]
-    pid == 0x3107    // 8BitDo Wireless Adapter (Black) [07:IDLE_MODE]
-  )));
-}
+// vid/pid of 8BitDo Wireless Adapter (D-input)
+static const device_id_t bitdo_bta_ids[] = {
+  { 0x2dc8, 0x3100 }, // 8BitDo Wireless Adapter (Red)
+  { 0x2dc8, 0x3105 }, // 8BitDo Wireless Adapter (Black) [05:HID_MODE]
+  { 0x2dc8, 0x3106 }, // 8BitDo Wireless Adapter (Black) [06:RECV_MODE]
+  { 0x2dc8, 0x3107 }, // 8BitDo Wireless Adapter (Black) [07:IDLE_MODE]
+};
 
 // check if 2 reports are different enough
 bool diff_report_bta(bitdo_bta_report_t const* rpt1, bitdo_bta_report_t const* rpt2) {
@@ -31,12 +29,12 @@ bool diff_report_bta(bitdo_bta_report_t const* rpt1, bitdo_bta_report_t const* r
 // process usb hid input reports
 void process_8bitdo_bta(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static bitdo_bta_report_t prev_report[5] = { 0 };
+  static bitdo_bta_report_t prev_report[MAX_DEVICES] = { 0 };
 
   bitdo_bta_report_t input_report;
   memcpy(&input_report, report, sizeof(input_report));
 
-  if ( diff_report_bta(&prev_report[dev_addr-1], &input_report) )
+  if ( diff_report_bta(&prev_report[dev_addr], &input_report) )
   {
     TU_LOG1("(x1, y1, x2, y2, l2, r2) = (%u, %u, %u, %u, %u, %u)\r\n",
       input_report.x1, input_report.y1,
@@ -98,15 +96,27 @@ void process_8bitdo_bta(uint8_t dev_addr, uint8_t instance, uint8_t const* repor
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, analog_1x, analog_1y, analog_2x, analog_2y, l2_trigger, r2_trigger, 0, 0);
-
-    prev_report[dev_addr-1] = input_report;
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = analog_1x,
+      .analog_1y = analog_1y,
+      .analog_2x = analog_2x,
+      .analog_2y = analog_2y,
+      .analog_l = l2_trigger,
+      .analog_r = r2_trigger,
+    };
+    post_input(&input);
+
+    prev_report[dev_addr] = input_report;
   }
 }
 
 DeviceInterface bitdo_bta_interface = {
   .name = "8BitDo Wireless Adapter",
-  .is_device = is_8bitdo_bta,
+  .ids = bitdo_bta_ids,
+  .id_count = TU_ARRAY_SIZE(bitdo_bta_ids),
   .process = process_8bitdo_bta,
   .task = NULL,
   .init = NULL
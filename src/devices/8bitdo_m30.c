@@ -2,13 +2,11 @@
 #include "8bitdo_m30.h"
 #include "globals.h"
 
-// check if device is 8BitDo Bluetooth gamepad (D-input)
-bool is_8bitdo_m30(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x2dc8 && (
-    pid == 0x5006 || // 8BitDo M30 Bluetooth
-    pid == 0x3104    // 8BitDo Bluetooth Adapter (Gray)
-  )));
-}
+// vid/pid of 8BitDo Bluetooth gamepad (D-input)
+static const device_id_t bitdo_m30_ids[] = {
+  { 0x2dc8, 0x5006 }, // 8BitDo M30 Bluetooth
+  { 0x2dc8, 0x3104 }, // 8BitDo Bluetooth Adapter (Gray)
+};
 
 // check if 2 reports are different enough
 bool diff_report_m30(bitdo_m30_report_t const* rpt1, bitdo_m30_report_t const* rpt2) {
@@ -18,12 +16,12 @@ bool diff_report_m30(bitdo_m30_report_t const* rpt1, bitdo_m30_report_t const* r
 // process usb hid input reports
 void process_8bitdo_m30(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static bitdo_m30_report_t prev_report[5] = { 0 };
+  static bitdo_m30_report_t prev_report[MAX_DEVICES] = { 0 };
 
   bitdo_m30_report_t input_report;
   memcpy(&input_report, report, sizeof(input_report));
 
-  if (diff_report_m30(&prev_report[dev_addr-1], &input_report)) {
+  if (diff_report_m30(&prev_report[dev_addr], &input_report)) {
     TU_LOG1("(x1, y1, x2, y2) = (%u, %u, %u, %u)\r\n", input_report.x1, input_report.y1, input_report.x2, input_report.y2);
     TU_LOG1("DPad = %d ", input_report.dpad);
 
@@ -78,15 +76,25 @@ void process_8bitdo_m30(uint8_t dev_addr, uint8_t instance, uint8_t const* repor
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, analog_1x, analog_1y, analog_2x, analog_2y, 0, 0, 0, 0);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = analog_1x,
+      .analog_1y = analog_1y,
+      .analog_2x = analog_2x,
+      .analog_2y = analog_2y,
+    };
+    post_input(&input);
 
-    prev_report[dev_addr-1] = input_report;
+    prev_report[dev_addr] = input_report;
   }
 }
 
 DeviceInterface bitdo_m30_interface = {
   .name = "8BitDo M30 Bluetooth",
-  .is_device = is_8bitdo_m30,
+  .ids = bitdo_m30_ids,
+  .id_count = TU_ARRAY_SIZE(bitdo_m30_ids),
   .process = process_8bitdo_m30,
   .task = NULL,
   .init = NULL
@@ -2,10 +2,10 @@
 #include "8bitdo_pce.h"
 #include "globals.h"
 
-// check if device is 8BitDo PCE 2.4g controllers
-bool is_8bitdo_pce(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x0f0d && pid == 0x0138)); // 8BitDo PCE 2.4g
-}
+// vid/pid of 8BitDo PCE 2.4g controllers
+static const device_id_t bitdo_pce_ids[] = {
+  { 0x0f0d, 0x0138 }, // 8BitDo PCE 2.4g
+};
 
 // check if 2 reports are different enough
 bool diff_report_pce(bitdo_pce_report_t const* rpt1, bitdo_pce_report_t const* rpt2) {
@@ -24,12 +24,12 @@ bool diff_report_pce(bitdo_pce_report_t const* rpt1, bitdo_pce_report_t const* r
 // process usb hid input reports
 void process_8bitdo_pce(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static bitdo_pce_report_t prev_report[5] = { 0 };
+  static bitdo_pce_report_t prev_report[MAX_DEVICES] = { 0 };
 
   bitdo_pce_report_t pce_report;
   memcpy(&pce_report, report, sizeof(pce_report));
 
-  if (diff_report_pce(&prev_report[dev_addr-1], &pce_report)) {
+  if (diff_report_pce(&prev_report[dev_addr], &pce_report)) {
     TU_LOG1("(x1, y1, x2, y2) = (%u, %u, %u, %u)\r\n", pce_report.x1, pce_report.y1, pce_report.x2, pce_report.y2);
     TU_LOG1("DPad = %d ", pce_report.dpad);
 
@@ -67,15 +67,25 @@ void process_8bitdo_pce(uint8_t dev_addr, uint8_t instance, uint8_t const* repor
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, 128, 128, 128, 128, 0, 0, 0, 0);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = 128,
+      .analog_1y = 128,
+      .analog_2x = 128,
+      .analog_2y = 128,
+    };
+    post_input(&input);
 
-    prev_report[dev_addr-1] = pce_report;
+    prev_report[dev_addr] = pce_report;
   }
 }
 
 DeviceInterface bitdo_pce_interface = {
   .name = "8BitDo PCE 2.4g",
-  .is_device = is_8bitdo_pce,
+  .ids = bitdo_pce_ids,
+  .id_count = TU_ARRAY_SIZE(bitdo_pce_ids),
   .process = process_8bitdo_pce,
   .task = NULL,
   .init = NULL
@@ -4,9 +4,16 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// usb vendor/product id pair claimed by a driver
+typedef struct {
+    uint16_t vid;
+    uint16_t pid;
+} device_id_t;
+
 typedef struct {
     const char* name; // Add this line
-    bool (*is_device)(uint16_t vid, uint16_t pid);
+    const device_id_t* ids; // vid/pid pairs matched at mount
+    uint8_t id_count;
     bool (*check_descriptor)(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len);
     void (*process)(uint8_t dev_addr, uint8_t instance, const uint8_t *report, uint16_t len);
     void (*task)(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds);
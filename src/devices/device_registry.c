@@ -18,8 +18,65 @@
 #include "hid_mouse.h"
 // Include other devices here
 
+#include <stdio.h>
+
+#define MAX_DEVICE_IDS 64
+
 DeviceInterface* device_interfaces[CONTROLLER_TYPE_COUNT] = {0};
 
+// every registered vid/pid, sorted by (vid << 16 | pid)
+typedef struct {
+    uint32_t key;
+    dev_type_t type;
+} device_id_entry_t;
+
+static device_id_entry_t device_ids[MAX_DEVICE_IDS];
+static int device_id_count = 0;
+
+// insert the driver id tables into the sorted lookup table
+static void build_device_ids() {
+    device_id_count = 0;
+    for (int type = 0; type < CONTROLLER_TYPE_COUNT; type++) {
+        DeviceInterface* dev = device_interfaces[type];
+        if (!dev || !dev->ids) continue;
+
+        for (int j = 0; j < dev->id_count; j++) {
+            uint32_t key = ((uint32_t)dev->ids[j].vid << 16) | dev->ids[j].pid;
+            if (device_id_count == MAX_DEVICE_IDS) {
+                printf("device ids full, dropped %08lx\n", (unsigned long)key);
+                continue;
+            }
+
+            int i = device_id_count++;
+            while (i > 0 && device_ids[i-1].key > key) {
+                device_ids[i] = device_ids[i-1];
+                i--;
+            }
+            if (i > 0 && device_ids[i-1].key == key) {
+                printf("duplicate device id %08lx [%s]\n", (unsigned long)key, dev->name);
+            }
+            device_ids[i].key = key;
+            device_ids[i].type = (dev_type_t)type;
+        }
+    }
+}
+
+// binary search the registered vid/pid table
+dev_type_t find_device_type(uint16_t vid, uint16_t pid) {
+    uint32_t key = ((uint32_t)vid << 16) | pid;
+    int lo = 0;
+    int hi = device_id_count - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (device_ids[mid].key == key) return device_ids[mid].type;
+        if (device_ids[mid].key < key) lo = mid + 1;
+        else hi = mid - 1;
+    }
+
+    return CONTROLLER_UNKNOWN;
+}
+
 void register_devices() {
     device_interfaces[CONTROLLER_DUALSHOCK3] = &sony_ds3_interface;
     device_interfaces[CONTROLLER_DUALSHOCK4] = &sony_ds4_interface;
@@ -43,4 +100,6 @@ void register_devices() {
     // disabled devices
     // device_interfaces[CONTROLLER_DRAGONRISE] = &dragonrise_interface; // deprecated
     // device_interfaces[CONTROLLER_8BITDO_NEO] = &bitdo_neo_interface; // incomplete
+
+    build_device_ids();
 }
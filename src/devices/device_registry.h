@@ -27,3 +27,4 @@ typedef enum {
 extern DeviceInterface* device_interfaces[CONTROLLER_TYPE_COUNT];
 
 void register_devices();
+dev_type_t find_device_type(uint16_t vid, uint16_t pid);
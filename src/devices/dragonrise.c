@@ -2,10 +2,10 @@
 #include "dragonrise.h"
 #include "globals.h"
 
-// check if device is generic NES USB Controller
-static inline bool is_dragonrise(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x0079 && pid == 0x0011)); // Generic NES USB
-}
+// vid/pid of generic NES USB Controller
+static const device_id_t dragonrise_ids[] = {
+  { 0x0079, 0x0011 }, // Generic NES USB
+};
 
 // check if 2 reports are different enough
 bool diff_report_pokken(dragonrise_report_t const* rpt1, dragonrise_report_t const* rpt2)
@@ -25,12 +25,12 @@ bool diff_report_pokken(dragonrise_report_t const* rpt1, dragonrise_report_t con
 // process usb hid input reports
 void process_dragonrise(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static dragonrise_report_t prev_report[5][5];
+  static dragonrise_report_t prev_report[MAX_DEVICES][5];
 
   dragonrise_report_t update_report;
   memcpy(&update_report, report, sizeof(update_report));
 
-  if ( dragonrise_diff_report(&prev_report[dev_addr-1][instance], &update_report) )
+  if ( dragonrise_diff_report(&prev_report[dev_addr][instance], &update_report) )
   {
     TU_LOG1("(x1, y1, x2, y2) = (%u, %u, %u, %u)\r\n", update_report.axis0_x, update_report.axis0_y, update_report.axis1_x, update_report.axis1_y);
     // Y,X,L,R extra button data may or may not be used by similiar generic controller variants
@@ -82,15 +82,25 @@ void process_dragonrise(uint8_t dev_addr, uint8_t instance, uint8_t const* repor
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, axis_1x, axis_1y, axis_2x, axis_2y, 0, 0, 0, 0);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = axis_1x,
+      .analog_1y = axis_1y,
+      .analog_2x = axis_2x,
+      .analog_2y = axis_2y,
+    };
+    post_input(&input);
 
-    prev_report[dev_addr-1][instance] = update_report;
+    prev_report[dev_addr][instance] = update_report;
   }
 }
 
 DeviceInterface dragonrise_interface = {
   .name = "DragonRise Generic",
-  .is_device = is_dragonrise,
+  .ids = dragonrise_ids,
+  .id_count = TU_ARRAY_SIZE(dragonrise_ids),
   .process = process_dragonrise,
   .task = NULL,
   .init = NULL
@@ -1,12 +1,12 @@
 // gamecube_adapter.c
 #include "gamecube_adapter.h"
 #include "globals.h"
-#include "bsp/board_api.h"
+#include "hid_output.h"
 
-// check if device is GameCube Adapter for WiiU/Switch
-static inline bool is_gamecube_adapter(uint16_t vid, uint16_t pid) {
-  return (vid == 0x057e && pid == 0x0337); // GameCube Adapter
-}
+// vid/pid of GameCube Adapter for WiiU/Switch
+static const device_id_t gamecube_adapter_ids[] = {
+  { 0x057e, 0x0337 }, // GameCube Adapter
+};
 
 // check if 2 reports are different enough
 bool diff_report_gamecube_adapter(gamecube_adapter_report_t const* rpt1, gamecube_adapter_report_t const* rpt2, uint8_t player) {
@@ -26,7 +26,7 @@ bool diff_report_gamecube_adapter(gamecube_adapter_report_t const* rpt1, gamecub
 // process usb hid input reports
 void input_gamecube_adapter(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static gamecube_adapter_report_t prev_report[5][4];
+  static gamecube_adapter_report_t prev_report[MAX_DEVICES][4];
 
   gamecube_adapter_report_t gamecube_report;
   memcpy(&gamecube_report, report, sizeof(gamecube_report));
@@ -34,7 +34,7 @@ void input_gamecube_adapter(uint8_t dev_addr, uint8_t instance, uint8_t const* r
   if (gamecube_report.report_id == 0x21) { // GameCube Controller Report
     for(int i = 0; i < 4; i++) {
       if (gamecube_report.port[i].connected) {
-        if (diff_report_gamecube_adapter(&prev_report[dev_addr-1][instance + i], &gamecube_report, i)) {
+        if (diff_report_gamecube_adapter(&prev_report[dev_addr][instance + i], &gamecube_report, i)) {
           TU_LOG1("GAMECUBE[%d|%d]: Report ID = 0x%x\r\n", dev_addr, (instance + i), gamecube_report.report_id);
           TU_LOG1("(x, y, cx, cy, zl, zr) = (%u, %u, %u, %u, %u, %u)\r\n",
             gamecube_report.port[i].x1,
@@ -91,60 +91,51 @@ void input_gamecube_adapter(uint8_t dev_addr, uint8_t instance, uint8_t const* r
           uint8_t zr_axis = gamecube_report.port[i].zr;
           zr_axis = zr_axis > 38 ? zr_axis - 38 : 0;
 
-          post_globals(dev_addr, i, buttons,
-            gamecube_report.port[i].x1,
-            gamecube_report.port[i].y1,
-            gamecube_report.port[i].x2,
-            gamecube_report.port[i].y2,
-            zl_axis,
-            zr_axis,
-            0,
-            0
-          );
-
-          prev_report[dev_addr-1][instance + i] = gamecube_report;
+          input_state_t input = {
+            .dev_addr = dev_addr,
+            .instance = i,
+            .buttons = buttons,
+            .analog_1x = gamecube_report.port[i].x1,
+            .analog_1y = gamecube_report.port[i].y1,
+            .analog_2x = gamecube_report.port[i].x2,
+            .analog_2y = gamecube_report.port[i].y2,
+            .analog_l = zl_axis,
+            .analog_r = zr_axis,
+          };
+          post_input(&input);
+
+          prev_report[dev_addr][instance + i] = gamecube_report;
         }
-      } else if (prev_report[dev_addr-1][instance + i].port[i].connected) { // disconnected
+      } else if (prev_report[dev_addr][instance + i].port[i].connected) { // disconnected
         remove_players_by_address(dev_addr, instance + i);
-        prev_report[dev_addr-1][instance + i] = gamecube_report;
+        prev_report[dev_addr][instance + i] = gamecube_report;
       }
     }
   }
 }
 
 // process usb hid output reports
-void output_gamecube_adapter(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble)
+void output_gamecube_adapter(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds)
 {
-  static uint8_t last_rumble = 0;
-  if (rumble != last_rumble)
+  static uint8_t last_rumble[MAX_DEVICES] = { 0 };
+  if (rumble != last_rumble[dev_addr])
   {
-    last_rumble = rumble;
+    last_rumble[dev_addr] = rumble;
 
     uint8_t buf4[5] = { 0x11, /* GC_CMD_RUMBLE */ };
     for(int i = 0; i < 4; i++)
     {
       buf4[i+1] = rumble ? 1 : 0;
     }
-    tuh_hid_send_report(dev_addr, instance, buf4[0], &(buf4[0])+1, sizeof(buf4) - 1);
-  }
-}
-
-// process usb hid output reports
-void task_gamecube_adapter(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds) {
-  const uint32_t interval_ms = 20;
-  static uint32_t start_ms = 0;
-
-  uint32_t current_time_ms = board_millis();
-  if (current_time_ms - start_ms >= interval_ms) {
-    start_ms = current_time_ms;
-    output_gamecube_adapter(dev_addr, instance, player_index, rumble);
+    hid_output_send(dev_addr, instance, HID_OUTPUT_FEEDBACK, buf4[0], &(buf4[0])+1, sizeof(buf4) - 1);
   }
 }
 
 DeviceInterface gamecube_adapter_interface = {
   .name = "GameCube Adapter for WiiU/Switch",
-  .is_device = is_gamecube_adapter,
+  .ids = gamecube_adapter_ids,
+  .id_count = TU_ARRAY_SIZE(gamecube_adapter_ids),
   .process = input_gamecube_adapter,
-  .task = task_gamecube_adapter,
+  .task = output_gamecube_adapter,
   .init = NULL
 };
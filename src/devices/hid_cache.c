@@ -0,0 +1,208 @@
+// hid_cache.c
+#include <string.h>
+#include "hid_cache.h"
+#include "flash_store.h"
+#include "bsp/board_api.h"
+
+// The cache takes two sectors, like the config log: the newest valid copy
+// (higher sequence) is loaded, and the other sector is erased at boot. A
+// flush programs the new copy into that erased sector one page per gap
+// between console polls, header page last, so a console that keeps polling
+// never sees flash busy for longer than a page program. At about a dozen
+// pages, a flush is done within a dozen polls (0.2s on the PCE). A second
+// flush in one session needs the old copy erased first, which waits for an
+// idle console.
+
+#define HID_CACHE_MAGIC   0x48434348 // "HCCH"
+#define HID_CACHE_VERSION 3          // bump when the meaning of hid_field_op_t changes
+
+#define HID_CACHE_SECTORS 2
+#define HID_CACHE_PAGES   ((sizeof(hid_cache_t) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE)
+
+// a burst of mounts (one device, several instances) is written out once
+#define HID_CACHE_FLUSH_DELAY_MS 2000
+
+typedef struct
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;     // sizeof(hid_cache_t), catches layout changes
+  uint32_t checksum; // of everything below, catches torn writes
+  uint32_t sequence; // newer copies count up
+  uint32_t clock;    // last use stamp handed out
+  hid_cache_entry_t entries[HID_CACHE_ENTRIES];
+} hid_cache_t;
+
+typedef union
+{
+  hid_cache_t cache;
+  uint8_t pages[HID_CACHE_PAGES][FLASH_PAGE_SIZE];
+} hid_cache_image_t;
+
+_Static_assert(sizeof(hid_cache_image_t) <= FLASH_SECTOR_SIZE, "hid cache must fit one flash sector");
+
+// ram copy of the cache. hits only move the use stamps here, flash is
+// rewritten when an entry is stored, which carries the newer stamps along.
+static hid_cache_image_t image __attribute__((aligned(4)));
+
+// the copy being programmed, fixed while stores keep changing image
+static hid_cache_image_t flush __attribute__((aligned(4)));
+static uint8_t flush_count = HID_CACHE_PAGES; // pages programmed, all when idle
+
+static uint8_t active = 0;        // sector holding the newest copy
+static bool spare_erased = false; // other sector ready to take a flush
+
+static bool dirty = false;
+static uint32_t dirty_ms = 0;
+
+// FNV-1a
+static uint32_t fnv1a(uint8_t const* data, uint32_t len, uint32_t hash)
+{
+  for (uint32_t i = 0; i < len; i++)
+  {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static uint32_t cache_checksum(const hid_cache_t* cache)
+{
+  uint8_t const* start = (uint8_t const*)&cache->sequence;
+  return fnv1a(start, sizeof(hid_cache_t) - (start - (uint8_t const*)cache), 2166136261u);
+}
+
+static uint32_t sector_offset(uint8_t sector)
+{
+  return FLASH_STORE_HID_CACHE_OFFSET + sector * FLASH_SECTOR_SIZE;
+}
+
+static bool cache_valid(const hid_cache_t* cache)
+{
+  return cache->magic == HID_CACHE_MAGIC &&
+         cache->version == HID_CACHE_VERSION &&
+         cache->size == sizeof(hid_cache_t) &&
+         cache->checksum == cache_checksum(cache);
+}
+
+// loads the newest valid copy, starting empty without one. runs on core0
+// before core1 starts, so the erase cannot disturb a console.
+void hid_cache_init(void)
+{
+  const hid_cache_t* newest = NULL;
+  for (uint8_t sector = 0; sector < HID_CACHE_SECTORS; sector++)
+  {
+    const hid_cache_t* cache = (const hid_cache_t*)flash_store_sector(sector_offset(sector));
+    if (!cache_valid(cache)) continue;
+    if (!newest || cache->sequence > newest->sequence)
+    {
+      newest = cache;
+      active = sector;
+    }
+  }
+
+  memset(&image, 0, sizeof(image));
+  if (newest) image.cache = *newest;
+
+  uint8_t spare = active ^ 1;
+  if (!flash_store_erased(sector_offset(spare), FLASH_SECTOR_SIZE)) flash_store_erase(sector_offset(spare));
+  spare_erased = true;
+}
+
+uint32_t hid_cache_hash(uint8_t const* desc_report, uint16_t desc_len)
+{
+  return fnv1a(desc_report, desc_len, 2166136261u);
+}
+
+// finds the entry of a descriptor and marks it most recently used
+const hid_cache_entry_t* hid_cache_lookup(uint16_t vid, uint16_t pid, uint16_t desc_len, uint32_t desc_hash)
+{
+  if (!desc_len) return NULL;
+
+  for (int i = 0; i < HID_CACHE_ENTRIES; i++)
+  {
+    hid_cache_entry_t* entry = &image.cache.entries[i];
+    if (entry->desc_len == desc_len && entry->desc_hash == desc_hash &&
+        entry->vid == vid && entry->pid == pid)
+    {
+      entry->last_used = ++image.cache.clock;
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+// stores a classification over an unused or the least recently used entry
+void hid_cache_store(uint16_t vid, uint16_t pid, uint16_t desc_len, uint32_t desc_hash, int8_t dev_type,
+                     const hid_field_op_t* ops, uint8_t op_count, uint8_t button_count)
+{
+  if (!desc_len || op_count > HID_CACHE_MAX_OPS) return;
+
+  hid_cache_entry_t* victim = &image.cache.entries[0];
+  for (int i = 0; i < HID_CACHE_ENTRIES; i++)
+  {
+    hid_cache_entry_t* entry = &image.cache.entries[i];
+    if (!entry->desc_len)
+    {
+      victim = entry;
+      break;
+    }
+    if (entry->last_used < victim->last_used) victim = entry;
+  }
+
+  memset(victim, 0, sizeof(hid_cache_entry_t));
+  victim->vid = vid;
+  victim->pid = pid;
+  victim->desc_len = desc_len;
+  victim->desc_hash = desc_hash;
+  victim->dev_type = dev_type;
+  victim->op_count = op_count;
+  victim->button_count = button_count;
+  victim->last_used = ++image.cache.clock;
+  memcpy(victim->ops, ops, op_count * sizeof(hid_field_op_t));
+
+  dirty = true;
+  dirty_ms = board_millis();
+}
+
+// writes stored entries to flash once mounting has settled, at most one
+// page program (or, once a session, an erase at an idle console) per call
+void hid_cache_task(void)
+{
+  if (flush_count == HID_CACHE_PAGES)
+  {
+    if (!dirty || board_millis() - dirty_ms < HID_CACHE_FLUSH_DELAY_MS) return;
+
+    // the spare still holds the copy flushed earlier this session
+    if (!spare_erased)
+    {
+      if (!flash_store_window(FLASH_STORE_ERASE_US)) return;
+
+      flash_store_erase(sector_offset(active ^ 1));
+      spare_erased = true;
+      return;
+    }
+
+    dirty = false;
+    image.cache.magic = HID_CACHE_MAGIC;
+    image.cache.version = HID_CACHE_VERSION;
+    image.cache.size = sizeof(hid_cache_t);
+    image.cache.sequence++;
+    image.cache.checksum = cache_checksum(&image.cache);
+    flush = image;
+    flush_count = 0;
+  }
+
+  if (!flash_store_window(FLASH_STORE_PROGRAM_US)) return;
+
+  // header page last, a torn flush leaves the old copy in charge
+  uint8_t page = (flush_count + 1) % HID_CACHE_PAGES;
+  flash_store_program(sector_offset(active ^ 1) + page * FLASH_PAGE_SIZE, flush.pages[page]);
+
+  if (++flush_count == HID_CACHE_PAGES)
+  {
+    active ^= 1;
+    spare_erased = false;
+  }
+}
@@ -0,0 +1,32 @@
+// hid_cache.h
+#ifndef HID_CACHE_H
+#define HID_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hid_gamepad.h"
+
+#define HID_CACHE_ENTRIES 8  // descriptors remembered, least recently used is evicted
+#define HID_CACHE_MAX_OPS 24 // larger field maps are parsed on every mount
+
+// classification of one report descriptor
+typedef struct
+{
+  uint16_t vid, pid;
+  uint16_t desc_len;  // 0 when the entry is unused
+  int8_t dev_type;    // dev_type_t
+  uint8_t op_count;
+  uint32_t desc_hash;
+  uint32_t last_used; // cache clock at the last hit
+  uint8_t button_count;
+  hid_field_op_t ops[HID_CACHE_MAX_OPS];
+} hid_cache_entry_t;
+
+void hid_cache_init(void);
+uint32_t hid_cache_hash(uint8_t const* desc_report, uint16_t desc_len);
+const hid_cache_entry_t* hid_cache_lookup(uint16_t vid, uint16_t pid, uint16_t desc_len, uint32_t desc_hash);
+void hid_cache_store(uint16_t vid, uint16_t pid, uint16_t desc_len, uint32_t desc_hash, int8_t dev_type,
+                     const hid_field_op_t* ops, uint8_t op_count, uint8_t button_count);
+void hid_cache_task(void);
+
+#endif // HID_CACHE_H
@@ -2,36 +2,47 @@
 #include "bsp/board_api.h"
 #include "hid_gamepad.h"
 #include "hid_parser.h"
+#include "hid_stream.h"
+#include "hid_cache.h"
+#include "device_registry.h"
 #include "globals.h"
 
+// one input report id: its run of ops and the pad it updates
 typedef struct
 {
-  uint8_t byteIndex;
-  uint16_t bitMask;
-  uint32_t max;
-} dinput_usage_t;
-
-// Generic HID instance state
-typedef struct TU_ATTR_PACKED
+  uint8_t report_id;
+  uint8_t op_start;
+  uint8_t op_count;
+  uint8_t button_count;
+  uint8_t pad;
+} dinput_report_t;
+
+// one player's worth of state. reports only store the fields they carry,
+// so pads fed by several report ids keep the rest between reports.
+typedef struct
 {
-  dinput_usage_t xLoc;
-  dinput_usage_t yLoc;
-  dinput_usage_t zLoc;
-  dinput_usage_t rzLoc;
-  dinput_usage_t rxLoc;
-  dinput_usage_t ryLoc;
-  dinput_usage_t hatLoc;
-  dinput_usage_t buttonLoc[MAX_BUTTONS]; // assuming a maximum of 12 buttons
-  uint8_t buttonCnt;
-} dinput_instance_t;
+  uint8_t button_count;
+  dinput_gamepad_t current;
+  dinput_gamepad_t previous; // last posted
+} dinput_pad_t;
 
-// Cached device report properties on mount
-typedef struct TU_ATTR_PACKED
+// Generic HID instance state: the descriptor compiled into extraction ops
+typedef struct
 {
-  dinput_instance_t instances[CFG_TUH_HID];
-} dinput_device_t;
+  uint8_t dev_addr; // 0 when unused
+  uint8_t instance;
+  uint8_t op_count;
+  uint8_t button_count; // all pads
+  uint8_t report_count;
+  uint8_t pad_count;
+  uint8_t report_index[256]; // report id -> reports[] + 1, 0 when not decoded
+  dinput_report_t reports[HID_GAMEPAD_MAX_REPORTS];
+  dinput_pad_t pads[HID_GAMEPAD_MAX_REPORTS];
+  hid_field_op_t ops[HID_GAMEPAD_MAX_OPS];
+  uint32_t axis_scale[HID_GAMEPAD_MAX_OPS][2]; // Q16 127/half-range, low and high half
+} dinput_instance_t;
 
-static dinput_device_t hid_devices[MAX_DEVICES] = { 0 };
+static dinput_instance_t hid_instances[HID_GAMEPAD_INSTANCES] = { 0 };
 
 // hid_parser info
 HID_ReportInfo_t *info;
@@ -39,196 +50,331 @@ HID_ReportInfo_t *info;
 //(hat format, 8 is released, 0=N, 1=NE, 2=E, 3=SE, 4=S, 5=SW, 6=W, 7=NW)
 static const uint8_t HAT_SWITCH_TO_DIRECTION_BUTTONS[] = {0b0001, 0b0011, 0b0010, 0b0110, 0b0100, 0b1100, 0b1000, 0b1001, 0b0000};
 
-// Gets HID descriptor report item for specific ReportID
-static inline bool USB_GetHIDReportItemInfoWithReportId(const uint8_t *ReportData, HID_ReportItem_t *const ReportItem)
+// finds (or claims) the compiled state of an instance
+static dinput_instance_t* get_instance(uint8_t dev_addr, uint8_t instance, bool claim)
 {
-  if (HID_DEBUG) TU_LOG1("ReportID: %d ", ReportItem->ReportID);
-  if (ReportItem->ReportID)
+  dinput_instance_t* unused = NULL;
+
+  for (int i = 0; i < HID_GAMEPAD_INSTANCES; i++)
   {
-    // if (ReportItem->ReportID != ReportData[0])
-    //   return false;
+    if (hid_instances[i].dev_addr == dev_addr && hid_instances[i].instance == instance) return &hid_instances[i];
+    if (!hid_instances[i].dev_addr && !unused) unused = &hid_instances[i];
+  }
+
+  if (!claim || !unused) return NULL;
 
-    ReportData++;
+  *unused = (dinput_instance_t){ .dev_addr = dev_addr, .instance = instance };
+  return unused;
+}
+
+// usages the gamepad ops decode
+static bool is_gamepad_usage(uint16_t page, uint16_t usage)
+{
+  switch (page)
+  {
+    case HID_USAGE_PAGE_DESKTOP:
+      switch (usage)
+      {
+        case HID_USAGE_DESKTOP_X:
+        case HID_USAGE_DESKTOP_Y:
+        case HID_USAGE_DESKTOP_Z:
+        case HID_USAGE_DESKTOP_RZ:
+        case HID_USAGE_DESKTOP_RX:
+        case HID_USAGE_DESKTOP_RY:
+        case HID_USAGE_DESKTOP_HAT_SWITCH:
+        case HID_USAGE_DESKTOP_DPAD_UP:
+        case HID_USAGE_DESKTOP_DPAD_DOWN:
+        case HID_USAGE_DESKTOP_DPAD_LEFT:
+        case HID_USAGE_DESKTOP_DPAD_RIGHT:
+          return true;
+      }
+      return false;
+    case HID_USAGE_PAGE_BUTTON:
+      return true;
   }
-  return USB_GetHIDReportItemInfo(ReportItem->ReportID, ReportData, ReportItem);
+  return false;
 }
 
-// Parses HID descriptor into byteIndex/buttonMasks
-void parse_descriptor(uint8_t dev_addr, uint8_t instance)
+// appends an op, returns NULL when the program is full
+static hid_field_op_t* add_op(dinput_instance_t* gamepad, uint8_t report_id, uint8_t dest, uint16_t bit_offset, uint8_t width)
 {
-  HID_ReportItem_t *item = info->FirstReportItem;
-  //iterate filtered reports info to match report from data
-  uint8_t btns_count = 0;
-  uint8_t idOffset = 0;
+  if (gamepad->op_count == HID_GAMEPAD_MAX_OPS) return NULL;
 
-  // check if reportID exists within input report
-  if (item->ReportID)
+  hid_field_op_t* op = &gamepad->ops[gamepad->op_count++];
+  *op = (hid_field_op_t){ .bit_offset = bit_offset, .width = width, .dest = dest, .report_id = report_id };
+  return op;
+}
+
+// stable sort of the ops by report id, so each report's ops are contiguous
+static void group_ops(dinput_instance_t* gamepad)
+{
+  for (uint8_t i = 1; i < gamepad->op_count; i++)
   {
-    TU_LOG1("ReportID in report = %04x\r\n", item->ReportID);
-    idOffset = 8;
+    hid_field_op_t op = gamepad->ops[i];
+    uint8_t j = i;
+    while (j > 0 && gamepad->ops[j - 1].report_id > op.report_id)
+    {
+      gamepad->ops[j] = gamepad->ops[j - 1];
+      j--;
+    }
+    gamepad->ops[j] = op;
   }
+}
 
-  while (item)
+// Groups the ops into reports and gives each report its pad. Runs after
+// compiling and after loading cached ops.
+static void link_reports(dinput_instance_t* gamepad)
+{
+  group_ops(gamepad);
+  memset(gamepad->report_index, 0, sizeof(gamepad->report_index));
+  gamepad->report_count = 0;
+  gamepad->pad_count = 0;
+  gamepad->button_count = 0;
+
+  for (uint8_t i = 0; i < gamepad->op_count; i++)
   {
-    uint8_t midValue = (item->Attributes.Logical.Maximum - item->Attributes.Logical.Minimum) / 2;
-    uint8_t bitSize = item->Attributes.BitSize ? item->Attributes.BitSize : 0; // bits per usage
-    uint8_t bitOffset = (item->BitOffset ? item->BitOffset : 0) + idOffset; // bits offset from start
-    uint16_t bitMask = ((0xFFFF >> (16 - bitSize)) << bitOffset % 8); // usage bits byte mask
-    uint8_t byteIndex = (int)(bitOffset / 8); // usage start byte
+    hid_field_op_t const* op = &gamepad->ops[i];
+    dinput_report_t* report = gamepad->report_count ? &gamepad->reports[gamepad->report_count - 1] : NULL;
 
-    if (HID_DEBUG) {
-      TU_LOG1("minimum: %d ", item->Attributes.Logical.Minimum);
-      TU_LOG1("mid: %d ", midValue);
-      TU_LOG1("maximum: %d ", item->Attributes.Logical.Maximum);
-      TU_LOG1("bitSize: %d ", bitSize);
-      TU_LOG1("bitOffset: %d ", bitOffset);
-      TU_LOG1("bitMask: 0x%x ", bitMask);
-      TU_LOG1("byteIndex: %d ", byteIndex);
+    if (!report || report->report_id != op->report_id)
+    {
+      if (gamepad->report_count == HID_GAMEPAD_MAX_REPORTS)
+      {
+        gamepad->op_count = i;
+        break;
+      }
+      report = &gamepad->reports[gamepad->report_count++];
+      *report = (dinput_report_t){ .report_id = op->report_id, .op_start = i };
+      gamepad->report_index[op->report_id] = gamepad->report_count;
     }
-    // TODO: this is limiting to repordId 0..
-    // Need to parse reportId and match later with received reports.
-    // Also helpful if multiple reportId maps can be saved per instance and report as individual
-    // players for single instance HID reports that contain multiple reportIds.
-    //
-    uint8_t report[1] = {0}; // reportId = 0; original ex maps report to descriptor data structure
-    if (USB_GetHIDReportItemInfoWithReportId(report, item))
+    report->op_count++;
+
+    // highest button the report carries
+    uint8_t last_button = 0;
+    if (op->dest == HID_OP_BUTTONS) last_button = op->shift + op->width;
+    else if (op->dest == HID_OP_BUTTON) last_button = op->shift + 1;
+    if (last_button > report->button_count) report->button_count = last_button;
+  }
+
+  for (uint8_t i = 0; i < gamepad->report_count; i++)
+  {
+    dinput_report_t* report = &gamepad->reports[i];
+
+    // reports without buttons (extra axes) feed the first pad
+    report->pad = 0;
+    if (!gamepad->pad_count ||
+        (HID_GAMEPAD_REPORT_PLAYERS && report->button_count && gamepad->pads[0].button_count))
     {
-      if (HID_DEBUG) TU_LOG1("PAGE: %d ", item->Attributes.Usage.Page);
-      switch (item->Attributes.Usage.Page)
+      report->pad = gamepad->pad_count++;
+      gamepad->pads[report->pad] = (dinput_pad_t){
+        .current = { .x = 128, .y = 128, .z = 128, .rz = 128 }, // sticks centered when missing
+      };
+    }
+
+    dinput_pad_t* pad = &gamepad->pads[report->pad];
+    if (report->button_count > pad->button_count) pad->button_count = report->button_count;
+    if (report->button_count > gamepad->button_count) gamepad->button_count = report->button_count;
+  }
+
+  // reciprocals that turn the axis scaling divisions into multiplies
+  for (uint8_t i = 0; i < gamepad->op_count; i++)
+  {
+    uint32_t range = gamepad->ops[i].range;
+    if (range < 2) continue;
+
+    gamepad->axis_scale[i][0] = (127u << 16) / (range / 2);
+    gamepad->axis_scale[i][1] = (127u << 16) / (range - range / 2);
+  }
+}
+
+// Compiles one input field into an op
+static void compile_field(dinput_instance_t* gamepad, hid_stream_field_t const* field)
+{
+  // report id, when used, is the first byte of every report
+  uint16_t bitOffset = field->bit_offset + (field->report_id ? 8 : 0);
+  uint8_t bitSize = field->bit_size > 32 ? 32 : field->bit_size;
+  int32_t minimum = field->logical_min;
+  int32_t maximum = field->logical_max;
+  hid_field_op_t* op = NULL;
+
+  if (HID_DEBUG) {
+    TU_LOG1("ReportID: %d ", field->report_id);
+    TU_LOG1("minimum: %ld ", (long)minimum);
+    TU_LOG1("maximum: %ld ", (long)maximum);
+    TU_LOG1("bitSize: %d ", bitSize);
+    TU_LOG1("bitOffset: %d ", bitOffset);
+    TU_LOG1("PAGE: %d ", field->usage_page);
+  }
+
+  if (!bitSize) return;
+
+  switch (field->usage_page)
+  {
+    case HID_USAGE_PAGE_DESKTOP:
+    {
+      uint8_t dest = HID_OP_NONE;
+      switch (field->usage)
+      {
+      case HID_USAGE_DESKTOP_X: dest = HID_OP_X; break;   // Left Analog X
+      case HID_USAGE_DESKTOP_Y: dest = HID_OP_Y; break;   // Left Analog Y
+      case HID_USAGE_DESKTOP_Z: dest = HID_OP_Z; break;   // Right Analog X
+      case HID_USAGE_DESKTOP_RZ: dest = HID_OP_RZ; break; // Right Analog Y
+      case HID_USAGE_DESKTOP_RX: dest = HID_OP_RX; break; // Left Analog Trigger
+      case HID_USAGE_DESKTOP_RY: dest = HID_OP_RY; break; // Right Analog Trigger
+      case HID_USAGE_DESKTOP_HAT_SWITCH: dest = HID_OP_HAT; break;
+      default:
+        if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP_NOT_HANDLED 0x%x", field->usage);
+        break;
+      }
+      if (dest == HID_OP_NONE) break;
+      if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP 0x%x ", field->usage);
+
+      // axes need a usable logical range to scale from
+      uint32_t range = (uint32_t)(maximum - minimum);
+      if (dest != HID_OP_HAT && (maximum <= minimum || range < 2)) break;
+
+      op = add_op(gamepad, field->report_id, dest, bitOffset, bitSize);
+      if (!op) break;
+      op->is_signed = minimum < 0;
+      op->minimum = minimum;
+
+      // pre-shift wide ranges so scaling stays within 32 bits
+      while (range > 0xffff)
+      {
+        range >>= 1;
+        op->shift++;
+      }
+      op->range = range;
+      break;
+    }
+    case HID_USAGE_PAGE_BUTTON:
+    {
+      if (HID_DEBUG) TU_LOG1(" HID_USAGE_PAGE_BUTTON ");
+      uint16_t usage = field->usage;
+
+      if (usage < 1 || usage > MAX_BUTTONS) break;
+
+      // extend the previous run when this button is its next bit
+      hid_field_op_t* last = gamepad->op_count ? &gamepad->ops[gamepad->op_count - 1] : NULL;
+      if (bitSize == 1 && last && last->dest == HID_OP_BUTTONS && last->report_id == field->report_id &&
+          last->bit_offset + last->width == bitOffset &&
+          last->shift + last->width == usage - 1 && last->width < 32)
       {
-        case HID_USAGE_PAGE_DESKTOP:
-        {
-          switch (item->Attributes.Usage.Usage)
-          {
-          case HID_USAGE_DESKTOP_X: // Left Analog X
-          {
-            if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP_X ");
-            hid_devices[dev_addr].instances[instance].xLoc.byteIndex = byteIndex;
-            hid_devices[dev_addr].instances[instance].xLoc.bitMask = bitMask;
-            hid_devices[dev_addr].instances[instance].xLoc.max = item->Attributes.Logical.Maximum;
-            break;
-          }
-          case HID_USAGE_DESKTOP_Y: // Left Analog Y
-          {
-            if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP_Y ");
-            hid_devices[dev_addr].instances[instance].yLoc.byteIndex = byteIndex;
-            hid_devices[dev_addr].instances[instance].yLoc.bitMask = bitMask;
-            hid_devices[dev_addr].instances[instance].yLoc.max = item->Attributes.Logical.Maximum;
-            break;
-          }
-          case HID_USAGE_DESKTOP_Z: // Right Analog X
-          {
-            if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP_Z ");
-            hid_devices[dev_addr].instances[instance].zLoc.byteIndex = byteIndex;
-            hid_devices[dev_addr].instances[instance].zLoc.bitMask = bitMask;
-            hid_devices[dev_addr].instances[instance].zLoc.max = item->Attributes.Logical.Maximum;
-            break;
-          }
-          case HID_USAGE_DESKTOP_RZ: // Right Analog Y
-          {
-            if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP_RZ ");
-            hid_devices[dev_addr].instances[instance].rzLoc.byteIndex = byteIndex;
-            hid_devices[dev_addr].instances[instance].rzLoc.bitMask = bitMask;
-            hid_devices[dev_addr].instances[instance].rzLoc.max = item->Attributes.Logical.Maximum;
-            break;
-          }
-          case HID_USAGE_DESKTOP_RX: // Left Analog Trigger
-          {
-            if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP_RX ");
-            hid_devices[dev_addr].instances[instance].rxLoc.byteIndex = byteIndex;
-            hid_devices[dev_addr].instances[instance].rxLoc.bitMask = bitMask;
-            hid_devices[dev_addr].instances[instance].rxLoc.max = item->Attributes.Logical.Maximum;
-            break;
-          }
-          case HID_USAGE_DESKTOP_RY: // Right Analog Trigger
-          {
-            if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP_RY ");
-            hid_devices[dev_addr].instances[instance].ryLoc.byteIndex = byteIndex;
-            hid_devices[dev_addr].instances[instance].ryLoc.bitMask = bitMask;
-            hid_devices[dev_addr].instances[instance].ryLoc.max = item->Attributes.Logical.Maximum;
-            break;
-          }
-          case HID_USAGE_DESKTOP_HAT_SWITCH:
-          {
-            if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP_HAT_SWITCH ");
-            hid_devices[dev_addr].instances[instance].hatLoc.byteIndex = byteIndex;
-            hid_devices[dev_addr].instances[instance].hatLoc.bitMask = bitMask;
-            break;
-          }
-          default:
-            if (HID_DEBUG) TU_LOG1(" HID_USAGE_DESKTOP_NOT_HANDLED 0x%x", item->Attributes.Usage.Usage);
-            break;
-          // case HID_USAGE_DESKTOP_SLIDER:
-          // case HID_USAGE_DESKTOP_DIAL:
-          //   break;
-          // case HID_USAGE_DESKTOP_DPAD_UP:
-          //   current.up |= 1;
-          //   break;
-          // case HID_USAGE_DESKTOP_DPAD_RIGHT:
-          //   current.right |= 1;
-          //   break;
-          // case HID_USAGE_DESKTOP_DPAD_DOWN:
-          //   current.down |= 1;
-          //   break;
-          // case HID_USAGE_DESKTOP_DPAD_LEFT:
-          //   current.left |= 1;
-          //   break;
-          }
-          break;
-        }
-        case HID_USAGE_PAGE_BUTTON:
-        {
-          if (HID_DEBUG) TU_LOG1(" HID_USAGE_PAGE_BUTTON ");
-          uint8_t usage = item->Attributes.Usage.Usage;
-
-          if (usage >= 1 && usage <= MAX_BUTTONS) {
-            hid_devices[dev_addr].instances[instance].buttonLoc[usage - 1].byteIndex = byteIndex;
-            hid_devices[dev_addr].instances[instance].buttonLoc[usage - 1].bitMask = bitMask;
-          }
-          btns_count++;
-          break;
-        }
-        default:
-          if (HID_DEBUG) TU_LOG1(" HID_USAGE_PAGE_NOT_HANDLED 0x%x", item->Attributes.Usage.Page);
-          break;
+        last->width++;
+        break;
       }
+
+      op = add_op(gamepad, field->report_id, bitSize == 1 ? HID_OP_BUTTONS : HID_OP_BUTTON, bitOffset, bitSize);
+      if (op) op->shift = usage - 1;
+      break;
     }
-    item = item->Next;
+    default:
+      if (HID_DEBUG) TU_LOG1(" HID_USAGE_PAGE_NOT_HANDLED 0x%x", field->usage_page);
+      break;
+  }
+}
+
+// Compiles the parsed HID descriptor into extraction ops
+void parse_descriptor(dinput_instance_t* gamepad)
+{
+  for (HID_ReportItem_t *item = info->FirstReportItem; item; item = item->Next)
+  {
+    hid_stream_field_t field = {
+      .report_id = item->ReportID,
+      .bit_offset = item->BitOffset,
+      .bit_size = item->Attributes.BitSize,
+      .usage_page = item->Attributes.Usage.Page,
+      .usage = item->Attributes.Usage.Usage,
+      .logical_min = (int32_t)item->Attributes.Logical.Minimum,
+      .logical_max = (int32_t)item->Attributes.Logical.Maximum,
+    };
+    compile_field(gamepad, &field);
     if (HID_DEBUG) TU_LOG1("\n\n");
   }
+}
 
-  hid_devices[dev_addr].instances[instance].buttonCnt = btns_count;
-  // hid_devices[dev_addr].instances[instance].reportID = item->ReportID;
+// compiles the gamepad fields as the streaming parser emits them
+static void stream_field(void* ctx, hid_stream_field_t const* field)
+{
+  if (!is_gamepad_usage(field->usage_page, field->usage)) return;
+
+  compile_field((dinput_instance_t*)ctx, field);
+  if (HID_DEBUG) TU_LOG1("\n\n");
 }
 
-//
-bool is_hid_gamepad(uint16_t vid, uint16_t pid)
+// remembers a compiled descriptor, skipping the parse on later mounts
+static void store_compiled(dinput_instance_t const* gamepad, uint16_t vid, uint16_t pid, uint16_t desc_len, uint32_t desc_hash)
 {
-  return false;
+  hid_cache_store(vid, pid, desc_len, desc_hash,
+                  gamepad->button_count > 0 ? CONTROLLER_DINPUT : CONTROLLER_UNKNOWN,
+                  gamepad->ops, gamepad->op_count, gamepad->button_count);
 }
 
 // hid_parser
 bool parse_hid_gamepad(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len)
 {
-  uint8_t ret = USB_ProcessHIDReport(dev_addr, instance, desc_report, desc_len, &(info));
-  if(ret == HID_PARSE_Successful)
+  dinput_instance_t* gamepad = get_instance(dev_addr, instance, true);
+  if (!gamepad)
   {
-    parse_descriptor(dev_addr, instance);
+    TU_LOG1("Error: no free DINPUT instance\r\n");
+    return false;
+  }
+  gamepad->op_count = 0;
+  gamepad->button_count = 0;
+
+  // a descriptor seen before skips the parse
+  uint16_t vid, pid;
+  tuh_vid_pid_get(dev_addr, &vid, &pid);
+  uint32_t desc_hash = hid_cache_hash(desc_report, desc_len);
+
+  const hid_cache_entry_t* cached = hid_cache_lookup(vid, pid, desc_len, desc_hash);
+  if (cached)
+  {
+    gamepad->op_count = cached->op_count;
+    memcpy(gamepad->ops, cached->ops, cached->op_count * sizeof(hid_field_op_t));
+    link_reports(gamepad);
+    if (HID_DEBUG) TU_LOG1("DINPUT: cached\r\n");
+  }
+  else if (desc_len > CFG_TUH_ENUMERATION_BUFSIZE)
+  {
+    // descriptors too large for the enumeration buffer (fetched again by
+    // hid_app) are compiled in one streaming pass, without item lists
+    static hid_stream_t stream;
+    hid_stream_init(&stream, stream_field, gamepad);
+    hid_stream_feed(&stream, desc_report, desc_len);
+    if (stream.error) TU_LOG1("Error: descriptor exceeds the stream parser\r\n");
+
+    link_reports(gamepad);
+    if (!stream.error) store_compiled(gamepad, vid, pid, desc_len, desc_hash);
   }
   else
   {
-    TU_LOG1("Error: USB_ProcessHIDReport failed: %d\r\n", ret);
+    uint8_t ret = USB_ProcessHIDReport(dev_addr, instance, desc_report, desc_len, &(info));
+    if(ret == HID_PARSE_Successful)
+    {
+      parse_descriptor(gamepad);
+      link_reports(gamepad);
+      store_compiled(gamepad, vid, pid, desc_len, desc_hash);
+    }
+    else
+    {
+      TU_LOG1("Error: USB_ProcessHIDReport failed: %d\r\n", ret);
+    }
+
+    // free up memory for next report to be parsed
+    USB_FreeReportInfo(info);
+    info = NULL;
   }
 
-  // free up memory for next report to be parsed
-  USB_FreeReportInfo(info);
-  info = NULL;
+  if (HID_DEBUG) TU_LOG1("DINPUT: %d ops, %d reports, %d pads, %d buttons\r\n",
+                         gamepad->op_count, gamepad->report_count, gamepad->pad_count, gamepad->button_count);
 
   // assume it is d-input device if buttons exist on report
-  if (hid_devices[dev_addr].instances[instance].buttonCnt > 0) {
-    return true;  
+  if (gamepad->button_count > 0) {
+    return true;
   }
 
+  gamepad->dev_addr = 0;
   return false;
 }
 
@@ -243,228 +389,185 @@ bool CALLBACK_HIDParser_FilterHIDReportItem(uint8_t dev_addr, uint8_t instance,
   if (CurrentItem->ItemType != HID_REPORT_ITEM_In)
     return false;
 
-  // if (hid_devices[dev_addr].instances[instance].reportID == INVALID_REPORT_ID)
-  // {
-  //   hid_devices[dev_addr].instances[instance].reportID = CurrentItem->ReportID;
-  // }
-  switch (CurrentItem->Attributes.Usage.Page)
-  {
-    case HID_USAGE_PAGE_DESKTOP:
-      // TU_LOG1("HID_USAGE: 0x%x\n", CurrentItem->Attributes.Usage.Usage);
-      switch (CurrentItem->Attributes.Usage.Usage)
-      {
-        case HID_USAGE_DESKTOP_X:
-        case HID_USAGE_DESKTOP_Y:
-        case HID_USAGE_DESKTOP_Z:
-        case HID_USAGE_DESKTOP_RZ:
-        case HID_USAGE_DESKTOP_RX:
-        case HID_USAGE_DESKTOP_RY:
-        case HID_USAGE_DESKTOP_HAT_SWITCH:
-        case HID_USAGE_DESKTOP_DPAD_UP:
-        case HID_USAGE_DESKTOP_DPAD_DOWN:
-        case HID_USAGE_DESKTOP_DPAD_LEFT:
-        case HID_USAGE_DESKTOP_DPAD_RIGHT:
-          return true;
-      }
-      return false;
-    case HID_USAGE_PAGE_BUTTON:
-      return true;
-  }
-  return false;
+  return is_gamepad_usage(CurrentItem->Attributes.Usage.Page, CurrentItem->Attributes.Usage.Usage);
+}
+
+// value * 127 / divisor for value <= divisor. the Q16 reciprocal makes the
+// product at most one short, which the compare corrects.
+static inline uint32_t __not_in_flash_func(scale_half)(uint32_t value, uint32_t divisor, uint32_t scale)
+{
+  uint32_t scaled = (value * scale) >> 16;
+  if ((scaled + 1) * divisor <= value * 127) scaled++;
+  return scaled;
 }
 
-// scales down switch analog value to a single byte
-uint8_t scale_analog_hid_gamepad(uint16_t value, uint32_t max_value)
+// scales a logical value in [0, max_value] to a single byte
+static inline uint8_t __not_in_flash_func(scale_analog_hid_gamepad)(uint32_t value, uint32_t max_value, uint32_t const scale[2])
 {
-  int mid_point = max_value / 2;
-  int scaled_value;
+  uint32_t mid_point = max_value / 2;
 
   if (value <= mid_point) {
     // Scale between [0, mid_point] to [1, 128]
-    scaled_value = 1 + (value * 127) / mid_point;
+    return 1 + scale_half(value, mid_point, scale[0]);
   } else {
     // Scale between [mid_point, max_value] to [128, 255]
-    scaled_value = 128 + ((value - mid_point) * 127) / (max_value - mid_point);
+    return 128 + scale_half(value - mid_point, max_value - mid_point, scale[1]);
   }
-
-  return scaled_value;
 }
 
-// process generic usb hid input reports (from parsed HID descriptor byteIndexes & bitMasks)
-void process_hid_gamepad(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
+// reads one little-endian field of any width, sign extended if signed
+static inline uint32_t __not_in_flash_func(extract_field)(uint8_t const* report, uint16_t len, hid_field_op_t const* op)
 {
-  static dinput_gamepad_t previous[5][5];
-  dinput_gamepad_t current = {0};
-  current.value = 0;
-
-  uint16_t xValue, yValue, zValue, rzValue, rxValue, ryValue;
-
-  if (hid_devices[dev_addr].instances[instance].xLoc.bitMask > 0xFF) { // if bitmask is larger than 8 bits
-    // Combine the current byte and the next byte into a 16-bit value
-    uint16_t combinedBytes = ((uint16_t)report[hid_devices[dev_addr].instances[instance].xLoc.byteIndex] << 8) | report[hid_devices[dev_addr].instances[instance].xLoc.byteIndex + 1];
-    // Apply the bitmask to the combined 16-bit value
-    xValue = (combinedBytes & hid_devices[dev_addr].instances[instance].xLoc.bitMask) >> (__builtin_ctz(hid_devices[dev_addr].instances[instance].xLoc.bitMask));
-  } else if (hid_devices[dev_addr].instances[instance].xLoc.bitMask) {
-    // Apply the bitmask to the single byte value (your existing implementation)
-    xValue = report[hid_devices[dev_addr].instances[instance].xLoc.byteIndex] & hid_devices[dev_addr].instances[instance].xLoc.bitMask;
-  }
+  uint16_t byte = op->bit_offset >> 3;
+  uint8_t bit = op->bit_offset & 7;
+  uint8_t bytes = (bit + op->width + 7) >> 3;
+  uint64_t raw = 0;
 
-  if (hid_devices[dev_addr].instances[instance].yLoc.bitMask > 0xFF) { // if bitmask is larger than 8 bits
-    // Combine the current byte and the next byte into a 16-bit value
-    uint16_t combinedBytes = ((uint16_t)report[hid_devices[dev_addr].instances[instance].yLoc.byteIndex] << 8) | report[hid_devices[dev_addr].instances[instance].yLoc.byteIndex + 1];
-    // Apply the bitmask to the combined 16-bit value
-    yValue = (combinedBytes & hid_devices[dev_addr].instances[instance].yLoc.bitMask) >> (__builtin_ctz(hid_devices[dev_addr].instances[instance].yLoc.bitMask));
-  } else if (hid_devices[dev_addr].instances[instance].yLoc.bitMask) {
-    // Apply the bitmask to the single byte value (your existing implementation)
-    yValue = report[hid_devices[dev_addr].instances[instance].yLoc.byteIndex] & hid_devices[dev_addr].instances[instance].yLoc.bitMask;
+  for (uint8_t n = 0; n < bytes && byte + n < len; n++)
+  {
+    raw |= (uint64_t)report[byte + n] << (8 * n);
   }
 
-  if (hid_devices[dev_addr].instances[instance].zLoc.bitMask > 0xFF) { // if bitmask is larger than 8 bits
-    // Combine the current byte and the next byte into a 16-bit value
-    uint16_t combinedBytes = ((uint16_t)report[hid_devices[dev_addr].instances[instance].zLoc.byteIndex] << 8) | report[hid_devices[dev_addr].instances[instance].zLoc.byteIndex + 1];
-    // Apply the bitmask to the combined 16-bit value
-    zValue = (combinedBytes & hid_devices[dev_addr].instances[instance].zLoc.bitMask) >> (__builtin_ctz(hid_devices[dev_addr].instances[instance].zLoc.bitMask));
-  } else if (hid_devices[dev_addr].instances[instance].zLoc.bitMask) {
-    // Apply the bitmask to the single byte value (your existing implementation)
-    zValue = report[hid_devices[dev_addr].instances[instance].zLoc.byteIndex] & hid_devices[dev_addr].instances[instance].zLoc.bitMask;
+  uint32_t value = (uint32_t)(raw >> bit);
+  if (op->width < 32)
+  {
+    uint32_t mask = (1u << op->width) - 1;
+    value &= mask;
+    if (op->is_signed && (value >> (op->width - 1))) value |= ~mask;
   }
 
-  if (hid_devices[dev_addr].instances[instance].rzLoc.bitMask > 0xFF) { // if bitmask is larger than 8 bits
-    // Combine the current byte and the next byte into a 16-bit value
-    uint16_t combinedBytes = ((uint16_t)report[hid_devices[dev_addr].instances[instance].rzLoc.byteIndex] << 8) | report[hid_devices[dev_addr].instances[instance].rzLoc.byteIndex + 1];
-    // Apply the bitmask to the combined 16-bit value
-    rzValue = (combinedBytes & hid_devices[dev_addr].instances[instance].rzLoc.bitMask) >> (__builtin_ctz(hid_devices[dev_addr].instances[instance].rzLoc.bitMask));
-  } else if (hid_devices[dev_addr].instances[instance].rzLoc.bitMask) {
-    // Apply the bitmask to the single byte value (your existing implementation)
-    rzValue = report[hid_devices[dev_addr].instances[instance].rzLoc.byteIndex] & hid_devices[dev_addr].instances[instance].rzLoc.bitMask;
-  }
+  return value;
+}
 
-  if (hid_devices[dev_addr].instances[instance].rxLoc.bitMask > 0xFF) { // if bitmask is larger than 8 bits
-    // Combine the current byte and the next byte into a 16-bit value
-    uint16_t combinedBytes = ((uint16_t)report[hid_devices[dev_addr].instances[instance].rxLoc.byteIndex] << 8) | report[hid_devices[dev_addr].instances[instance].rxLoc.byteIndex + 1];
-    // Apply the bitmask to the combined 16-bit value
-    rxValue = (combinedBytes & hid_devices[dev_addr].instances[instance].rxLoc.bitMask) >> (__builtin_ctz(hid_devices[dev_addr].instances[instance].rxLoc.bitMask));
-  } else if (hid_devices[dev_addr].instances[instance].rxLoc.bitMask) {
-    // Apply the bitmask to the single byte value (your existing implementation)
-    rxValue = report[hid_devices[dev_addr].instances[instance].rxLoc.byteIndex] & hid_devices[dev_addr].instances[instance].rxLoc.bitMask;
-  }
+// runs the ops of one report, each op overwrites the fields it owns
+static void __not_in_flash_func(run_ops)(hid_field_op_t const* ops, uint32_t const (*axis_scale)[2], uint8_t op_count,
+                                         uint8_t const* report, uint16_t len, dinput_gamepad_t* current)
+{
+  for (uint8_t i = 0; i < op_count; i++)
+  {
+    hid_field_op_t const* op = &ops[i];
+    uint32_t value = extract_field(report, len, op);
 
-  if (hid_devices[dev_addr].instances[instance].ryLoc.bitMask > 0xFF) { // if bitmask is larger than 8 bits
-    // Combine the current byte and the next byte into a 16-bit value
-    uint16_t combinedBytes = ((uint16_t)report[hid_devices[dev_addr].instances[instance].ryLoc.byteIndex] << 8) | report[hid_devices[dev_addr].instances[instance].ryLoc.byteIndex + 1];
-    // Apply the bitmask to the combined 16-bit value
-    ryValue = (combinedBytes & hid_devices[dev_addr].instances[instance].ryLoc.bitMask) >> (__builtin_ctz(hid_devices[dev_addr].instances[instance].ryLoc.bitMask));
-  } else if (hid_devices[dev_addr].instances[instance].ryLoc.bitMask) {
-    // Apply the bitmask to the single byte value (your existing implementation)
-    ryValue = report[hid_devices[dev_addr].instances[instance].ryLoc.byteIndex] & hid_devices[dev_addr].instances[instance].ryLoc.bitMask;
-  }
+    switch (op->dest)
+    {
+    case HID_OP_BUTTONS:
+    {
+      uint32_t mask = op->width < 32 ? (1u << op->width) - 1 : 0xffffffff;
+      current->buttons = (current->buttons & ~(mask << op->shift)) | (value << op->shift);
+      break;
+    }
 
-  uint8_t hatValue = report[hid_devices[dev_addr].instances[instance].hatLoc.byteIndex] & hid_devices[dev_addr].instances[instance].hatLoc.bitMask;
+    case HID_OP_BUTTON:
+      if (value) current->buttons |= (1u << op->shift);
+      else current->buttons &= ~(1u << op->shift);
+      break;
 
-  // parse hat from report
-  if (hid_devices[dev_addr].instances[instance].hatLoc.bitMask) {
-    uint8_t direction = hatValue <= 8 ? hatValue : 8; // fix for hats with pressed state greater than 8
-    current.all_direction |= HAT_SWITCH_TO_DIRECTION_BUTTONS[direction];
-  } else {
-    hatValue = 8;
-  }
+    case HID_OP_HAT:
+    {
+      // values outside the logical range are released
+      uint32_t direction = (uint32_t)((int32_t)value - op->minimum);
+      current->dpad = HAT_SWITCH_TO_DIRECTION_BUTTONS[direction < 8 ? direction : 8];
+      break;
+    }
+
+    default: // axes
+    {
+      int32_t offset = (int32_t)value - op->minimum;
+      uint32_t scaled = offset < 0 ? 0 : ((uint32_t)offset >> op->shift);
+      if (scaled > op->range) scaled = op->range;
+      uint8_t axis = scale_analog_hid_gamepad(scaled, op->range, axis_scale[i]);
 
-  // parse buttons from report
-  current.all_buttons = 0;
-  for (int i = 0; i < 12; i++) {
-    if (report[hid_devices[dev_addr].instances[instance].buttonLoc[i].byteIndex] & hid_devices[dev_addr].instances[instance].buttonLoc[i].bitMask) {
-      current.all_buttons |= (0x01 << i);
+      switch (op->dest)
+      {
+      case HID_OP_X: current->x = axis; break;
+      case HID_OP_Y: current->y = axis; break;
+      case HID_OP_Z: current->z = axis; break;
+      case HID_OP_RZ: current->rz = axis; break;
+      case HID_OP_RX: current->rx = axis; break;
+      case HID_OP_RY: current->ry = axis; break;
+      }
+      break;
+    }
     }
   }
+}
 
-  // parse analog from report
-  if (hid_devices[dev_addr].instances[instance].xLoc.max) {
-    current.x = scale_analog_hid_gamepad(xValue, hid_devices[dev_addr].instances[instance].xLoc.max);
-  } else {
-    current.x = 128;
-  }
-  if (hid_devices[dev_addr].instances[instance].yLoc.max) {
-    current.y = scale_analog_hid_gamepad(yValue, hid_devices[dev_addr].instances[instance].yLoc.max);
-  } else {
-    current.y = 128;
-  }
-  if (hid_devices[dev_addr].instances[instance].zLoc.max) {
-    current.z = scale_analog_hid_gamepad(zValue, hid_devices[dev_addr].instances[instance].zLoc.max);
-  } else {
-    current.z = 128;
-  }
-  if (hid_devices[dev_addr].instances[instance].rzLoc.max) {
-    current.rz = scale_analog_hid_gamepad(rzValue, hid_devices[dev_addr].instances[instance].rzLoc.max);
-  } else {
-    current.rz = 128;
-  }
-  if (hid_devices[dev_addr].instances[instance].rxLoc.max) {
-    current.rx = scale_analog_hid_gamepad(rxValue, hid_devices[dev_addr].instances[instance].rxLoc.max);
-  } else {
-    current.rx = 0;
-  }
-  if (hid_devices[dev_addr].instances[instance].ryLoc.max) {
-    current.ry = scale_analog_hid_gamepad(ryValue, hid_devices[dev_addr].instances[instance].ryLoc.max);
-  } else {
-    current.ry = 0;
-  }
+// process generic usb hid input reports (from the compiled descriptor ops)
+void process_hid_gamepad(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
+{
+  dinput_instance_t* gamepad = get_instance(dev_addr, instance, false);
+  if (!gamepad || !gamepad->report_count || !len) return;
+
+  // with report ids, the first byte picks the report's ops
+  uint8_t index = gamepad->reports[0].report_id ? gamepad->report_index[report[0]] : 1;
+  if (!index) return;
+
+  dinput_report_t const* map = &gamepad->reports[index - 1];
+  dinput_pad_t* pad = &gamepad->pads[map->pad];
+  run_ops(&gamepad->ops[map->op_start], &gamepad->axis_scale[map->op_start], map->op_count, report, len, &pad->current);
+  dinput_gamepad_t current = pad->current;
 
   // TODO: based on diff report rather than current's datastructure in order to get subtle analog changes
-  if (previous[dev_addr-1][instance].value != current.value)
+  if (memcmp(&pad->previous, &current, sizeof(current)) != 0)
   {
-    previous[dev_addr-1][instance] = current;
+    pad->previous = current;
+
+    uint8_t buttonCount = pad->button_count;
+    if (buttonCount > MAX_BUTTONS) buttonCount = MAX_BUTTONS;
 
     if (HID_DEBUG) {
       TU_LOG1("Super HID Report: ");
-      TU_LOG1("Button Count: %d\n", hid_devices[dev_addr].instances[instance].buttonCnt);
-      TU_LOG1(" x:%d, y:%d, z:%d, rz:%d dPad:%d \n", current.x, current.y, current.z, current.rz, hatValue);
-      for (int i = 0; i < 12; i++) {
-        TU_LOG1(" B%d:%d", i + 1, (report[hid_devices[dev_addr].instances[instance].buttonLoc[i].byteIndex] & hid_devices[dev_addr].instances[instance].buttonLoc[i].bitMask) ? 1 : 0 );
+      TU_LOG1("Button Count: %d\n", pad->button_count);
+      TU_LOG1(" x:%d, y:%d, z:%d, rz:%d dPad:%d \n", current.x, current.y, current.z, current.rz, current.dpad);
+      for (int i = 0; i < buttonCount; i++) {
+        TU_LOG1(" B%d:%d", i + 1, DINPUT_BUTTON(current, i + 1) ? 1 : 0);
       }
       TU_LOG1("\n");
     }
 
-    uint8_t buttonCount = hid_devices[dev_addr].instances[instance].buttonCnt;
-    if (buttonCount > 12) buttonCount = 12;
-    bool buttonSelect = current.all_buttons & (0x01 << (buttonCount-2));
-    bool buttonStart = current.all_buttons & (0x01 << (buttonCount-1));
-    bool buttonI = current.button1;
-    bool buttonIII = current.button3;
-    bool buttonIV = current.button4;
-    bool buttonV = buttonCount >=7 ? current.button5 : 0;
-    bool buttonVI = buttonCount >=8 ? current.button6 : 0;
-    bool buttonVII = buttonCount >=9 ? current.button7 : 0;
-    bool buttonVIII = buttonCount >=10 ? current.button8 : 0;
-    bool buttonIX = buttonCount >=11 ? current.button9 : 0;
-    bool buttonX = buttonCount >=12 ? current.button10 : 0;
+    bool buttonSelect = buttonCount >= 2 && DINPUT_BUTTON(current, buttonCount-1);
+    bool buttonStart = buttonCount >= 1 && DINPUT_BUTTON(current, buttonCount);
+    bool buttonI = DINPUT_BUTTON(current, 1);
+    bool buttonIII = DINPUT_BUTTON(current, 3);
+    bool buttonIV = DINPUT_BUTTON(current, 4);
+    bool buttonV = buttonCount >=7 ? DINPUT_BUTTON(current, 5) : 0;
+    bool buttonVI = buttonCount >=8 ? DINPUT_BUTTON(current, 6) : 0;
+    bool buttonVII = buttonCount >=9 ? DINPUT_BUTTON(current, 7) : 0;
+    bool buttonVIII = buttonCount >=10 ? DINPUT_BUTTON(current, 8) : 0;
+    bool buttonHome = false;
     bool has_6btns = buttonCount >= 6;
 
     // assume DirectInput mapping
     if (buttonCount >= 10) {
-      buttonSelect = current.button9;
-      buttonStart = current.button10;
-      buttonI = current.button3;
-      buttonIII = current.button4;
-      buttonIV = current.button1;
+      buttonSelect = DINPUT_BUTTON(current, 9);
+      buttonStart = DINPUT_BUTTON(current, 10);
+      buttonI = DINPUT_BUTTON(current, 3);
+      buttonIII = DINPUT_BUTTON(current, 4);
+      buttonIV = DINPUT_BUTTON(current, 1);
     }
 
-    buttons = (((current.button12)? 0x00 : 0x20000) | // r3
-               ((current.button11)? 0x00 : 0x10000) | // l3
+    // DirectInput pads with a 13th button put PS/Home there
+    if (buttonCount >= 13) {
+      buttonHome = DINPUT_BUTTON(current, 13);
+    }
+
+    buttons = ((DINPUT_BUTTON(current, 12)? 0x00 : 0x20000) | // r3
+               (DINPUT_BUTTON(current, 11)? 0x00 : 0x10000) | // l3
                ((buttonVI)        ? 0x00 : 0x8000) |
                ((buttonV)         ? 0x00 : 0x4000) |
                ((buttonIV)        ? 0x00 : 0x2000) |
                ((buttonIII)       ? 0x00 : 0x1000) |
                ((has_6btns)       ? 0x00 : 0x0800) |
-               ((false)           ? 0x00 : 0x0400) | // home
+               ((buttonHome)      ? 0x00 : 0x0400) | // home
                ((buttonVIII)      ? 0x00 : 0x0200) | // r2
                ((buttonVII)       ? 0x00 : 0x0100) | // l2
-               ((current.left)    ? 0x00 : 0x0008) |
-               ((current.down)    ? 0x00 : 0x0004) |
-               ((current.right)   ? 0x00 : 0x0002) |
-               ((current.up)      ? 0x00 : 0x0001) |
+               ((current.dpad & 0x08) ? 0x00 : 0x0008) | // left
+               ((current.dpad & 0x04) ? 0x00 : 0x0004) | // down
+               ((current.dpad & 0x02) ? 0x00 : 0x0002) | // right
+               ((current.dpad & 0x01) ? 0x00 : 0x0001) | // up
                ((buttonStart)     ? 0x00 : 0x0080) |
                ((buttonSelect)    ? 0x00 : 0x0040) |
-               ((current.button2) ? 0x00 : 0x0020) |
+               (DINPUT_BUTTON(current, 2) ? 0x00 : 0x0020) |
                ((buttonI)         ? 0x00 : 0x0010));
 
     // invert vertical axis
@@ -476,7 +579,20 @@ void process_hid_gamepad(uint8_t dev_addr, uint8_t instance, uint8_t const* repo
     // keep analog within range [1-255]
     ensureAllNonZero(&axis_x, &axis_y, &axis_z, &axis_rz);
 
-    post_globals(dev_addr, instance, buttons, axis_x, axis_y, axis_z, axis_rz, current.rx, current.ry, 0, 0);
+    // extra pads post as the instances after this one, as the GameCube
+    // adapter does for its ports
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance + map->pad,
+      .buttons = buttons,
+      .analog_1x = axis_x,
+      .analog_1y = axis_y,
+      .analog_2x = axis_z,
+      .analog_2y = axis_rz,
+      .analog_l = current.rx,
+      .analog_r = current.ry,
+    };
+    post_input(&input);
   }
 }
 
@@ -484,36 +600,12 @@ void process_hid_gamepad(uint8_t dev_addr, uint8_t instance, uint8_t const* repo
 void unmount_hid_gamepad(uint8_t dev_addr, uint8_t instance)
 {
   TU_LOG1("DINPUT[%d|%d]: Unmount Reset\r\n", dev_addr, instance);
-  hid_devices[dev_addr].instances[instance].xLoc.byteIndex = 0;
-  hid_devices[dev_addr].instances[instance].xLoc.bitMask = 0;
-  hid_devices[dev_addr].instances[instance].xLoc.max = 0;
-  hid_devices[dev_addr].instances[instance].yLoc.byteIndex = 0;
-  hid_devices[dev_addr].instances[instance].yLoc.bitMask = 0;
-  hid_devices[dev_addr].instances[instance].yLoc.max = 0;
-  hid_devices[dev_addr].instances[instance].zLoc.byteIndex = 0;
-  hid_devices[dev_addr].instances[instance].zLoc.bitMask = 0;
-  hid_devices[dev_addr].instances[instance].zLoc.max = 0;
-  hid_devices[dev_addr].instances[instance].rzLoc.byteIndex = 0;
-  hid_devices[dev_addr].instances[instance].rzLoc.bitMask = 0;
-  hid_devices[dev_addr].instances[instance].rzLoc.max = 0;
-  hid_devices[dev_addr].instances[instance].rxLoc.byteIndex = 0;
-  hid_devices[dev_addr].instances[instance].rxLoc.bitMask = 0;
-  hid_devices[dev_addr].instances[instance].rxLoc.max = 0;
-  hid_devices[dev_addr].instances[instance].ryLoc.byteIndex = 0;
-  hid_devices[dev_addr].instances[instance].ryLoc.bitMask = 0;
-  hid_devices[dev_addr].instances[instance].ryLoc.max = 0;
-  hid_devices[dev_addr].instances[instance].hatLoc.byteIndex = 0;
-  hid_devices[dev_addr].instances[instance].hatLoc.bitMask = 0;
-  hid_devices[dev_addr].instances[instance].buttonCnt = 0;
-  for (int i = 0; i < MAX_BUTTONS; i++) {
-    hid_devices[dev_addr].instances[instance].buttonLoc[i].byteIndex = 0;
-    hid_devices[dev_addr].instances[instance].buttonLoc[i].bitMask = 0;
-  }
+  dinput_instance_t* gamepad = get_instance(dev_addr, instance, false);
+  if (gamepad) gamepad->dev_addr = 0;
 }
 
 DeviceInterface hid_gamepad_interface = {
   .name = "DirectInput",
-  .is_device = is_hid_gamepad,
   .check_descriptor = parse_hid_gamepad,
   .process = process_hid_gamepad,
   .unmount = unmount_hid_gamepad,
@@ -8,43 +8,55 @@
 
 #define INVALID_REPORT_ID -1 // means 1/X of half range of analog would be dead zone
 #define DEAD_ZONE 4U
-#define MAX_BUTTONS 12 // max generic HID buttons to map
+#define MAX_BUTTONS 32 // max generic HID buttons to map
 #define HID_DEBUG 1
 
-typedef union
+#define HID_GAMEPAD_INSTANCES 8 // generic HID gamepads mounted at once
+#define HID_GAMEPAD_MAX_OPS 40  // extraction ops per gamepad
+#define HID_GAMEPAD_MAX_REPORTS 4 // input report ids decoded per gamepad
+
+// 1: every input report id carrying buttons is its own player, so adapters
+// multiplexing pads over one interface show up as separate players.
+// 0: all report ids of an instance update one player.
+#define HID_GAMEPAD_REPORT_PLAYERS 1
+
+// extraction op destinations
+enum
+{
+  HID_OP_NONE,
+  HID_OP_BUTTONS, // run of 1-bit buttons, stored into buttons at shift
+  HID_OP_BUTTON,  // wider button field, pressed when nonzero
+  HID_OP_HAT,
+  HID_OP_X,
+  HID_OP_Y,
+  HID_OP_Z,
+  HID_OP_RZ,
+  HID_OP_RX,
+  HID_OP_RY,
+};
+
+// one report field compiled from the HID descriptor
+typedef struct
 {
-  struct
-  {
-    bool up : 1;
-    bool right : 1;
-    bool down : 1;
-    bool left : 1;
-    bool button1 : 1;
-    bool button2 : 1;
-    bool button3 : 1;
-    bool button4 : 1;
-
-    bool button5 : 1;
-    bool button6 : 1;
-    bool button7 : 1;
-    bool button8 : 1;
-    bool button9 : 1;
-    bool button10 : 1;
-    bool button11 : 1;
-    bool button12 : 1;
-
-    uint8_t x, y, z, rz, rx, ry; // analog joystick/triggers
-  };
-  struct
-  {
-    uint8_t all_direction : 4;
-    uint16_t all_buttons : 12;
-    uint32_t analog_sticks : 32;
-    uint16_t analog_triggers : 16;
-  };
-  uint64_t value : 64;
+  uint16_t bit_offset; // from the start of the report (report id included)
+  uint8_t width;       // field bits, 1..32
+  uint8_t dest;        // HID_OP_*
+  uint8_t shift;       // buttons: first button bit, axes: range pre-shift
+  bool is_signed;
+  uint8_t report_id;   // report the field is in, 0 without report ids
+  int32_t minimum;     // logical minimum
+  uint32_t range;      // (logical max - min) >> shift
+} hid_field_op_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint32_t buttons; // button n at bit n-1
+  uint8_t dpad;     // up, right, down, left bits
+  uint8_t x, y, z, rz, rx, ry; // analog joystick/triggers
 } dinput_gamepad_t;
 
+#define DINPUT_BUTTON(gamepad, n) (((gamepad).buttons >> ((n) - 1)) & 1)
+
 extern DeviceInterface hid_gamepad_interface;
 
 uint32_t buttons;
@@ -1,7 +1,7 @@
 // hid_keyboard.c
 #include "hid_keyboard.h"
 #include "globals.h"
-#include "bsp/board_api.h"
+#include "hid_output.h"
 
 #ifdef CONFIG_NGC
 #define KB_ANALOG_MID 28
@@ -18,6 +18,8 @@ typedef struct TU_ATTR_PACKED
   bool ready;
   uint8_t leds;
   uint8_t rumble;
+  uint8_t kbd_leds; // LED state sent to the keyboard
+  uint8_t prev_kbd_leds;
 } hid_kb_instance_t;
 
 // Cached device report properties on mount
@@ -28,10 +30,6 @@ typedef struct TU_ATTR_PACKED
 
 static hid_kb_device_t hid_kb_devices[MAX_DEVICES] = { 0 };
 
-// Keyboard LED control
-static uint8_t kbd_leds = 0;
-static uint8_t prev_kbd_leds = 0xFF;
-
 // Core functionality
 // ------------------
 static uint8_t const keycode2ascii[128][2] =  { HID_KEYCODE_TO_ASCII };
@@ -450,7 +448,19 @@ void process_hid_keyboard(uint8_t dev_addr, uint8_t instance, uint8_t const* hid
              ((btns_two)   ? 0x00 : 0x0020) |
              ((btns_one)   ? 0x00 : 0x0010));
 
-  post_globals(dev_addr, instance, buttons, analog_left_x, analog_left_y, analog_right_x, analog_right_y, analog_l, analog_r, reportKeys, 0);
+  input_state_t input = {
+    .dev_addr = dev_addr,
+    .instance = instance,
+    .buttons = buttons,
+    .analog_1x = analog_left_x,
+    .analog_1y = analog_left_y,
+    .analog_2x = analog_right_x,
+    .analog_2y = analog_right_y,
+    .analog_l = analog_l,
+    .analog_r = analog_r,
+    .keys = reportKeys,
+  };
+  post_input(&input);
 
   prev_report = *report;
 }
@@ -459,15 +469,15 @@ void process_hid_keyboard(uint8_t dev_addr, uint8_t instance, uint8_t const* hid
 void output_hid_keyboard(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds)
 {
   // Keyboard LED control
-  static uint8_t kbd_leds = 0;
-  static uint8_t prev_kbd_leds = 0xFF;
+  uint8_t kbd_leds = hid_kb_devices[dev_addr].instances[instance].kbd_leds;
 
   if (!hid_kb_devices[dev_addr].instances[instance].init && hid_kb_devices[dev_addr].instances[instance].ready)
   {
     hid_kb_devices[dev_addr].instances[instance].init = true;
+    hid_kb_devices[dev_addr].instances[instance].prev_kbd_leds = 0xFF;
 
     // kbd_leds = KEYBOARD_LED_NUMLOCK;
-    tuh_hid_set_report(dev_addr, instance, 0, HID_REPORT_TYPE_OUTPUT, &kbd_leds, sizeof(kbd_leds));
+    hid_output_set_report(dev_addr, instance, 0, HID_REPORT_TYPE_OUTPUT, &kbd_leds, sizeof(kbd_leds));
   }
   else if (leds != hid_kb_devices[dev_addr].instances[instance].leds || is_fun)
   {
@@ -481,7 +491,7 @@ void output_hid_keyboard(uint8_t dev_addr, uint8_t instance, int player_index, u
     if (leds & 0x4) kbd_leds |= KEYBOARD_LED_SCROLLLOCK;
     else kbd_leds &= ~KEYBOARD_LED_SCROLLLOCK;
 
-    tuh_hid_set_report(dev_addr, instance, 0, HID_REPORT_TYPE_OUTPUT, &kbd_leds, sizeof(kbd_leds));
+    hid_output_set_report(dev_addr, instance, 0, HID_REPORT_TYPE_OUTPUT, &kbd_leds, sizeof(kbd_leds));
     hid_kb_devices[dev_addr].instances[instance].leds = leds;
   }
   if (rumble != hid_kb_devices[dev_addr].instances[instance].rumble)
@@ -494,26 +504,14 @@ void output_hid_keyboard(uint8_t dev_addr, uint8_t instance, int player_index, u
     }
     hid_kb_devices[dev_addr].instances[instance].rumble = rumble;
 
-    if (kbd_leds != prev_kbd_leds)
+    if (kbd_leds != hid_kb_devices[dev_addr].instances[instance].prev_kbd_leds)
     {
-      tuh_hid_set_report(dev_addr, instance, 0, HID_REPORT_TYPE_OUTPUT, &kbd_leds, sizeof(kbd_leds));
-      prev_kbd_leds = kbd_leds;
+      hid_output_set_report(dev_addr, instance, 0, HID_REPORT_TYPE_OUTPUT, &kbd_leds, sizeof(kbd_leds));
+      hid_kb_devices[dev_addr].instances[instance].prev_kbd_leds = kbd_leds;
     }
   }
-}
 
-// process usb hid output reports
-void task_hid_keyboard(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds)
-{
-  const uint32_t interval_ms = 20;
-  static uint32_t start_ms = 0;
-
-  uint32_t current_time_ms = board_millis();
-  if (current_time_ms - start_ms >= interval_ms)
-  {
-    start_ms = current_time_ms;
-    output_hid_keyboard(dev_addr, instance, player_index, rumble, leds);
-  }
+  hid_kb_devices[dev_addr].instances[instance].kbd_leds = kbd_leds;
 }
 
 // resets default values in case devices are hotswapped
@@ -522,13 +520,13 @@ void unmount_hid_keyboard(uint8_t dev_addr, uint8_t instance)
   hid_kb_devices[dev_addr].instances[instance].ready = false;
   hid_kb_devices[dev_addr].instances[instance].init = false;
   hid_kb_devices[dev_addr].instances[instance].leds = 0;
+  hid_kb_devices[dev_addr].instances[instance].kbd_leds = 0;
 }
 
 DeviceInterface hid_keyboard_interface = {
   .name = "HID Keyboard",
-  .is_device = NULL,
   .init = NULL,
-  .task = task_hid_keyboard,
+  .task = output_hid_keyboard,
   .process = process_hid_keyboard,
   .unmount = unmount_hid_keyboard,
 };
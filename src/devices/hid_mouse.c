@@ -1,6 +1,9 @@
 // hid_mouse.c
 #include "hid_mouse.h"
 #include "globals.h"
+#include "config.h"
+#include "spinner.h"
+#include "mouse.h"
 
 // Button swap functionality
 // -------------------------
@@ -10,7 +13,11 @@ const bool buttons_swappable = true;
 const bool buttons_swappable = false;
 #endif
 
-static bool buttons_swapped = false;
+// wheel and x movement drive the nuon spinner
+#ifdef CONFIG_NUON
+static spinner_t mouse_spinner = { 0 };
+#endif
+static uint8_t spinner = 0;
 
 void cursor_movement(int8_t x, int8_t y, int8_t wheel, uint8_t spinner)
 {
@@ -56,6 +63,7 @@ void process_hid_mouse(uint8_t dev_addr, uint8_t instance, uint8_t const* mouse_
   static hid_mouse_report_t prev_report = { 0 };
 
   static bool previous_middle_button = false;
+  static bool previous_backward_button = false;
 
   //------------- button state  -------------//
   uint8_t button_changed_mask = report->buttons ^ prev_report.buttons;
@@ -70,12 +78,19 @@ void process_hid_mouse(uint8_t dev_addr, uint8_t instance, uint8_t const* mouse_
 
     if (buttons_swappable && (report->buttons & MOUSE_BUTTON_MIDDLE) &&
         (previous_middle_button == false))
-       buttons_swapped = (buttons_swapped ? false : true);
+       config_set(CONFIG_KEY_MOUSE_SWAP, !config_get(CONFIG_KEY_MOUSE_SWAP));
 
     previous_middle_button = (report->buttons & MOUSE_BUTTON_MIDDLE);
   }
 
-  if (buttons_swapped)
+  // backward button cycles the sensitivity/acceleration curve
+  if ((report->buttons & MOUSE_BUTTON_BACKWARD) && !previous_backward_button)
+  {
+    mouse_next_curve();
+  }
+  previous_backward_button = (report->buttons & MOUSE_BUTTON_BACKWARD);
+
+  if (config_get(CONFIG_KEY_MOUSE_SWAP))
   {
      buttons = (((0xfff00)) | // no six button controller byte
                 ((0x0000f)) | // no dpad button presses
@@ -103,45 +118,31 @@ void process_hid_mouse(uint8_t dev_addr, uint8_t instance, uint8_t const* mouse_
 #endif
 
 #ifdef CONFIG_NUON
-  // mouse wheel to spinner rotation conversion
-  if (report->wheel != 0) {
-    if (report->wheel < 0) { // clockwise
-      spinner += ((-1 * report->wheel) + 3);
-      if (spinner > 255) spinner -= 255;
-    } else { // counter-clockwise
-      if (spinner >= ((report->wheel) + 3)) {
-        spinner += report->wheel;
-        spinner -= 3;
-      } else {
-        spinner = 255 - ((report->wheel) - spinner) - 3;
-      }
-    }
+  // mouse wheel to spinner rotation conversion, each notch turns 3 extra
+  if (report->wheel < 0) { // clockwise
+    spinner = spinner_move(&mouse_spinner, ((-1 * report->wheel) + 3) * SPINNER_STEP, 0);
+  } else if (report->wheel > 0) { // counter-clockwise
+    spinner = spinner_move(&mouse_spinner, -((report->wheel) + 3) * SPINNER_STEP, 0);
   }
 
-  int16_t delta = (report->x * -1);
-
-  // check max/min delta value
-  if (delta > 15) delta = 15;
-  if (delta < -15) delta = -15;
-
-  // mouse x-axis to spinner rotation conversion
-  if (delta != 0) {
-    if (delta < 0) { // clockwise
-      spinner += delta;
-      if (spinner > 255) spinner -= 255;
-    } else { // counter-clockwise
-      if (spinner >= ((delta))) {
-        spinner += delta;
-      } else {
-        spinner = 255 - delta - spinner;
-      }
-    }
+  // mouse x-axis to spinner rotation conversion, at most 15 per report
+  if (report->x != 0) {
+    spinner = spinner_move(&mouse_spinner, (report->x * -1) * SPINNER_STEP, 15 * SPINNER_STEP);
   }
 
 #endif
   // add to accumulator and post to the state machine
   // if a scan from the host machine is ongoing, wait
-  post_mouse_globals(dev_addr, instance, buttons, local_x, local_y, spinner);
+  input_state_t input = {
+    .dev_addr = dev_addr,
+    .instance = instance,
+    .is_mouse = true,
+    .buttons = buttons,
+    .delta_x = local_x,
+    .delta_y = local_y,
+    .quad_x = spinner,
+  };
+  post_input(&input);
 
   //------------- cursor movement -------------//
   cursor_movement(report->x, report->y, report->wheel, spinner);
@@ -149,7 +150,6 @@ void process_hid_mouse(uint8_t dev_addr, uint8_t instance, uint8_t const* mouse_
 
 DeviceInterface hid_mouse_interface = {
   .name = "HID Mouse",
-  .is_device = NULL,
   .init = NULL,
   .task = NULL,
   .process = process_hid_mouse,
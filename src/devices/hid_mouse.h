@@ -16,7 +16,6 @@ extern DeviceInterface hid_mouse_interface;
 // #define MID_BUTTON_SWAPPABLE  true
 
 uint32_t buttons;
-extern int16_t spinner;
 uint8_t local_x;
 uint8_t local_y;
 
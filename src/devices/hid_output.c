@@ -0,0 +1,155 @@
+// hid_output.c
+#include "hid_output.h"
+#include "tusb.h"
+#include "bsp/board_api.h"
+
+// minimum time between two sends of a kind on one instance
+static const uint32_t interval_ms[HID_OUTPUT_KIND_COUNT] = {
+  0,  // HID_OUTPUT_COMMAND
+  20, // HID_OUTPUT_FEEDBACK
+  20, // HID_OUTPUT_CONTROL
+};
+
+// newest report of one kind waiting to go out
+typedef struct
+{
+  bool pending;
+  uint8_t report_id;
+  uint8_t report_type; // control only
+  uint16_t len;
+  uint8_t buf[HID_OUTPUT_REPORT_MAX];
+} hid_output_slot_t;
+
+// output state of one instance (dev_addr 0 when unused)
+typedef struct
+{
+  uint8_t dev_addr;
+  uint8_t instance;
+  uint32_t sent_ms[HID_OUTPUT_KIND_COUNT];
+  hid_output_slot_t slots[HID_OUTPUT_KIND_COUNT];
+} hid_output_queue_t;
+
+static hid_output_queue_t queues[HID_OUTPUT_QUEUES] = { 0 };
+
+// control requests are asynchronous, so their data must outlive the queue
+// slot. the host has one control pipe, so one buffer serves every device.
+static uint8_t control_buf[HID_OUTPUT_REPORT_MAX];
+static uint8_t control_addr = 0; // device with a request in flight, 0 idle
+
+// find (or claim) the queue of an instance
+static hid_output_queue_t* get_queue(uint8_t dev_addr, uint8_t instance, bool claim)
+{
+  hid_output_queue_t* unused = NULL;
+
+  for (int i = 0; i < HID_OUTPUT_QUEUES; i++)
+  {
+    if (queues[i].dev_addr == dev_addr && queues[i].instance == instance) return &queues[i];
+    if (!queues[i].dev_addr && !unused) unused = &queues[i];
+  }
+
+  if (!claim) return NULL;
+  if (!unused)
+  {
+    TU_LOG1("HID output queues full [%d|%d]\r\n", dev_addr, instance);
+    return NULL;
+  }
+
+  *unused = (hid_output_queue_t){ .dev_addr = dev_addr, .instance = instance };
+  return unused;
+}
+
+// store a report as the pending one of its kind
+static bool enqueue(uint8_t dev_addr, uint8_t instance, hid_output_kind_t kind,
+                    uint8_t report_id, uint8_t report_type, void const* report, uint16_t len)
+{
+  if (!dev_addr || len > HID_OUTPUT_REPORT_MAX) return false;
+
+  hid_output_queue_t* queue = get_queue(dev_addr, instance, true);
+  if (!queue) return false;
+
+  hid_output_slot_t* slot = &queue->slots[kind];
+  slot->report_id = report_id;
+  slot->report_type = report_type;
+  slot->len = len;
+  memcpy(slot->buf, report, len);
+  slot->pending = true;
+
+  return true;
+}
+
+// queue a report for the interrupt OUT endpoint
+bool hid_output_send(uint8_t dev_addr, uint8_t instance, hid_output_kind_t kind,
+                     uint8_t report_id, void const* report, uint16_t len)
+{
+  if (kind == HID_OUTPUT_CONTROL) return false;
+
+  return enqueue(dev_addr, instance, kind, report_id, 0, report, len);
+}
+
+// queue a SET_REPORT request for the control pipe
+bool hid_output_set_report(uint8_t dev_addr, uint8_t instance, uint8_t report_id,
+                           uint8_t report_type, void const* report, uint16_t len)
+{
+  return enqueue(dev_addr, instance, HID_OUTPUT_CONTROL, report_id, report_type, report, len);
+}
+
+// hand pending reports to tinyusb, keeping those refused by a busy pipe
+void hid_output_task(void)
+{
+  uint32_t current_time_ms = board_millis();
+
+  for (int i = 0; i < HID_OUTPUT_QUEUES; i++)
+  {
+    hid_output_queue_t* queue = &queues[i];
+    if (!queue->dev_addr) continue;
+
+    for (int kind = 0; kind < HID_OUTPUT_KIND_COUNT; kind++)
+    {
+      hid_output_slot_t* slot = &queue->slots[kind];
+      if (!slot->pending) continue;
+      if (current_time_ms - queue->sent_ms[kind] < interval_ms[kind]) continue;
+
+      bool sent;
+      if (kind == HID_OUTPUT_CONTROL)
+      {
+        if (control_addr) continue;
+
+        memcpy(control_buf, slot->buf, slot->len);
+        sent = tuh_hid_set_report(queue->dev_addr, queue->instance, slot->report_id,
+                                  slot->report_type, control_buf, slot->len);
+        if (sent) control_addr = queue->dev_addr;
+      }
+      else
+      {
+        sent = tuh_hid_send_report(queue->dev_addr, queue->instance, slot->report_id,
+                                   slot->buf, slot->len);
+      }
+
+      if (sent)
+      {
+        slot->pending = false;
+        queue->sent_ms[kind] = current_time_ms;
+      }
+    }
+  }
+}
+
+// drop queued output of an unmounted instance
+void hid_output_unmount(uint8_t dev_addr, uint8_t instance)
+{
+  hid_output_queue_t* queue = get_queue(dev_addr, instance, false);
+  if (queue) queue->dev_addr = 0;
+
+  if (control_addr == dev_addr) control_addr = 0;
+}
+
+// Invoked when a SET_REPORT control request completes (or fails)
+void tuh_hid_set_report_complete_cb(uint8_t dev_addr, uint8_t instance, uint8_t report_id, uint8_t report_type, uint16_t len)
+{
+  (void) instance;
+  (void) report_id;
+  (void) report_type;
+  (void) len;
+
+  if (control_addr == dev_addr) control_addr = 0;
+}
@@ -0,0 +1,30 @@
+// hid_output.h
+#ifndef HID_OUTPUT_H
+#define HID_OUTPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// largest output report a driver can queue (full-speed packet)
+#define HID_OUTPUT_REPORT_MAX 64
+
+// instances that can hold queued output at once
+#define HID_OUTPUT_QUEUES 8
+
+// Output report kinds. Each instance holds at most one pending report per
+// kind, a newer report of the same kind replaces one not yet sent.
+typedef enum {
+  HID_OUTPUT_COMMAND,  // init/handshake reports on the OUT endpoint, unpaced
+  HID_OUTPUT_FEEDBACK, // rumble/led reports on the OUT endpoint, paced
+  HID_OUTPUT_CONTROL,  // SET_REPORT requests on the control pipe, paced
+  HID_OUTPUT_KIND_COUNT
+} hid_output_kind_t;
+
+bool hid_output_send(uint8_t dev_addr, uint8_t instance, hid_output_kind_t kind,
+                     uint8_t report_id, void const* report, uint16_t len);
+bool hid_output_set_report(uint8_t dev_addr, uint8_t instance, uint8_t report_id,
+                           uint8_t report_type, void const* report, uint16_t len);
+void hid_output_task(void);
+void hid_output_unmount(uint8_t dev_addr, uint8_t instance);
+
+#endif // HID_OUTPUT_H
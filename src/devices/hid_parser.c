@@ -27,54 +27,44 @@
 #include "hid_parser.h"
 #include <string.h>
 #include <stdbool.h>
-#include <assert.h>
-
-#ifdef DYNAMIC
-#include <malloc.h>
-#define ACQUIRE_AND_RELEASE(structure, size) \
-__attribute__ ((always_inline)) static inline structure##_t* acquire_##structure() { return malloc(sizeof(structure##_t)); } \
-__attribute__ ((always_inline)) static inline void release_##structure(structure##_t* pointer) { free(pointer); }
-#else
-#define ACQUIRE_AND_RELEASE(structure, size) \
-enum { MAX_##structure =  size }; \
-static structure##_t structure##s[MAX_##structure]; \
-static bool structure##sAcquired[MAX_##structure]; \
-static structure##_t* acquire_##structure() \
-{\
-	for(uint8_t i=0; i < MAX_##structure; i++) \
-	{\
-	if(!structure##sAcquired[i])\
-		{\
-			structure##sAcquired[i] = true;\
-			return &structure##s[i];\
-		}\
-	}\
-	assert(false);\
-	return NULL;\
-}\
-static void release_##structure(structure##_t* pointer)\
-{\
-	structure##sAcquired[pointer - structure##s] = false;\
-}
-#endif
 
-ACQUIRE_AND_RELEASE(HID_ReportSizeInfo, 100);
-ACQUIRE_AND_RELEASE(HID_CollectionPath, 25);
-ACQUIRE_AND_RELEASE(HID_ReportInfo, 1);
-ACQUIRE_AND_RELEASE(HID_ReportItem, 50);
+/* Per-parse bump arena. Everything a parse allocates (report info, report ID
+ * sizes, collection paths and report items) is released at once when the
+ * next parse starts or the caller frees the report info. */
+#define HID_ARENA_SIZE 4096
+
+static uint8_t HID_Arena[HID_ARENA_SIZE] __attribute__((aligned(4)));
+static uint16_t HID_ArenaUsed = 0;
+
+static void* HID_ArenaAlloc(uint16_t Size)
+{
+	Size = (Size + 3) & ~3;
+	if (Size > HID_ARENA_SIZE - HID_ArenaUsed)
+		return NULL;
+
+	void* Block = &HID_Arena[HID_ArenaUsed];
+	HID_ArenaUsed += Size;
+	memset(Block, 0x00, Size);
+	return Block;
+}
 
 void USB_FreeReportInfo(HID_ReportInfo_t *ReportInfo)
 {
-	if (ReportInfo)
+	(void)ReportInfo;
+	HID_ArenaUsed = 0;
+}
+
+/* Logical extents are signed, sign extend them from their encoded size */
+static int32_t HID_SignedItemData(uint8_t HIDReportItem, uint32_t ReportItemData)
+{
+	switch (HIDReportItem & HID_RI_DATA_SIZE_MASK)
 	{
-		HID_ReportItem_t *item = ReportInfo->FirstReportItem;
-		while (item)
-		{
-			HID_ReportItem_t *current = item;
-			item = item->Next;
-			release_HID_ReportItem(current);
-		}
-		release_HID_ReportInfo(ReportInfo);
+		case HID_RI_DATA_BITS_8:
+			return (int8_t)ReportItemData;
+		case HID_RI_DATA_BITS_16:
+			return (int16_t)ReportItemData;
+		default:
+			return (int32_t)ReportItemData;
 	}
 }
 
@@ -84,10 +74,11 @@ uint8_t USB_ProcessHIDReport(uint8_t dev_addr,
 							 uint16_t ReportSize,
 							 HID_ReportInfo_t **ParserDataOut)
 {
-	HID_ReportSizeInfo_t *FirstReportIDSize = acquire_HID_ReportSizeInfo();
-	HID_CollectionPath_t *FirstCollectionPath = acquire_HID_CollectionPath();
-	memset(FirstCollectionPath, 0, sizeof(HID_CollectionPath_t));
-	HID_ReportInfo_t *ParserData = acquire_HID_ReportInfo();
+	HID_ArenaUsed = 0;
+
+	HID_ReportSizeInfo_t *FirstReportIDSize = HID_ArenaAlloc(sizeof(HID_ReportSizeInfo_t));
+	HID_CollectionPath_t *FirstCollectionPath = HID_ArenaAlloc(sizeof(HID_CollectionPath_t));
+	HID_ReportInfo_t *ParserData = HID_ArenaAlloc(sizeof(HID_ReportInfo_t));
 	HID_StateTable_t StateTable[HID_STATETABLE_STACK_DEPTH];
 	HID_StateTable_t *CurrStateTable = &StateTable[0];
 	HID_CollectionPath_t *CurrCollectionPath = NULL;
@@ -96,9 +87,10 @@ uint8_t USB_ProcessHIDReport(uint8_t dev_addr,
 	uint8_t UsageListSize = 0;
 	HID_MinMax_t UsageMinMax = {0, 0};
 
-	memset(ParserData, 0x00, sizeof(HID_ReportInfo_t));
+	if (!FirstReportIDSize || !FirstCollectionPath || !ParserData)
+		return HID_PARSE_OutOfMemory;
+
 	memset(CurrStateTable, 0x00, sizeof(HID_StateTable_t));
-	memset(CurrReportIDInfo, 0x00, sizeof(HID_ReportSizeInfo_t));
 
 	ParserData->TotalDeviceReports = 1;
 	uint8_t Result = HID_PARSE_Successful;
@@ -168,11 +160,16 @@ uint8_t USB_ProcessHIDReport(uint8_t dev_addr,
 				break;
 
 			case HID_RI_LOGICAL_MINIMUM(0):
-				CurrStateTable->Attributes.Logical.Minimum = ReportItemData;
+				CurrStateTable->Attributes.Logical.Minimum = HID_SignedItemData(HIDReportItem, ReportItemData);
 				break;
 
 			case HID_RI_LOGICAL_MAXIMUM(0):
-				CurrStateTable->Attributes.Logical.Maximum = ReportItemData;
+				/* many devices encode an unsigned maximum (e.g. 255 in one byte), keep it
+				 * unsigned when the signed reading would fall below the minimum */
+				if (HID_SignedItemData(HIDReportItem, ReportItemData) >= (int32_t)CurrStateTable->Attributes.Logical.Minimum)
+				  CurrStateTable->Attributes.Logical.Maximum = HID_SignedItemData(HIDReportItem, ReportItemData);
+				else
+				  CurrStateTable->Attributes.Logical.Maximum = ReportItemData;
 				break;
 
 			case HID_RI_PHYSICAL_MINIMUM(0):
@@ -220,9 +217,13 @@ uint8_t USB_ProcessHIDReport(uint8_t dev_addr,
 
 					if (CurrReportIDInfo == NULL)
 					{
+						iterator->Next = CurrReportIDInfo = HID_ArenaAlloc(sizeof(HID_ReportSizeInfo_t));
+						if (!CurrReportIDInfo)
+						{
+							Result = HID_PARSE_OutOfMemory;
+							break;
+						}
 						ParserData->TotalDeviceReports++;
-						iterator->Next = CurrReportIDInfo = acquire_HID_ReportSizeInfo();
-						memset(CurrReportIDInfo, 0x00, sizeof(HID_ReportSizeInfo_t));
 					}
 				}
 
@@ -266,10 +267,14 @@ uint8_t USB_ProcessHIDReport(uint8_t dev_addr,
 					{
 						CurrCollectionPath = CurrCollectionPath->Next;
 					}
-					HID_CollectionPath_t *NewCollectionPath = acquire_HID_CollectionPath();
+					HID_CollectionPath_t *NewCollectionPath = HID_ArenaAlloc(sizeof(HID_CollectionPath_t));
+					if (!NewCollectionPath)
+					{
+						Result = HID_PARSE_OutOfMemory;
+						break;
+					}
 					CurrCollectionPath->Next = NewCollectionPath;
 					CurrCollectionPath = NewCollectionPath;
-					memset(CurrCollectionPath, 0, sizeof(HID_CollectionPath_t));
 					CurrCollectionPath->Parent = ParentCollectionPath;
 				}
 
@@ -299,11 +304,6 @@ uint8_t USB_ProcessHIDReport(uint8_t dev_addr,
 					break;
 				}
 				CurrCollectionPath = CurrCollectionPath->Parent;
-				if (CurrCollectionPath)
-				{
-					release_HID_CollectionPath(CurrCollectionPath->Next);
-					CurrCollectionPath->Next = NULL;
-				}
 				break;
 
 			case HID_RI_INPUT(0):
@@ -351,16 +351,19 @@ uint8_t USB_ProcessHIDReport(uint8_t dev_addr,
 
 					if (!(ReportItemData & HID_IOF_CONSTANT) && CALLBACK_HIDParser_FilterHIDReportItem(dev_addr, instance, &NewReportItem))
 					{
-						if (!ParserData->FirstReportItem)
+						HID_ReportItem_t *ReportItem = HID_ArenaAlloc(sizeof(HID_ReportItem_t));
+						if (!ReportItem)
 						{
-							ParserData->FirstReportItem = acquire_HID_ReportItem();
-							ParserData->LastReportItem = ParserData->FirstReportItem;
+							Result = HID_PARSE_OutOfMemory;
+							break;
 						}
+
+						if (!ParserData->FirstReportItem)
+							ParserData->FirstReportItem = ReportItem;
 						else
-						{
-							ParserData->LastReportItem->Next = acquire_HID_ReportItem();
-							ParserData->LastReportItem = ParserData->LastReportItem->Next;
-						}
+							ParserData->LastReportItem->Next = ReportItem;
+						ParserData->LastReportItem = ReportItem;
+
 						memcpy(ParserData->LastReportItem, &NewReportItem, sizeof(HID_ReportItem_t));
 						ParserData->LastReportItem->Next = NULL;
 						ParserData->TotalReportItems++;
@@ -389,27 +392,13 @@ uint8_t USB_ProcessHIDReport(uint8_t dev_addr,
 	if (Result != HID_PARSE_Successful)
 	{
 		USB_FreeReportInfo(ParserData);
+		*ParserDataOut = NULL;
 	}
 	else
 	{
 		*ParserDataOut = ParserData;
 	}
 
-	HID_ReportSizeInfo_t *iteratorReportIDSizes = FirstReportIDSize;
-	while (iteratorReportIDSizes)
-	{
-		HID_ReportSizeInfo_t *temp = iteratorReportIDSizes->Next;
-		release_HID_ReportSizeInfo(iteratorReportIDSizes);
-		iteratorReportIDSizes = temp;
-	}
-
-	HID_CollectionPath_t *iteratorCollectionPaths = FirstCollectionPath;
-	while (iteratorCollectionPaths)
-	{
-		HID_CollectionPath_t *temp = iteratorCollectionPaths->Next;
-		release_HID_CollectionPath(iteratorCollectionPaths);
-		iteratorCollectionPaths = temp;
-	}
 	return Result;
 }
 
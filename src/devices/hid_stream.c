@@ -0,0 +1,207 @@
+// hid_stream.c
+#include <string.h>
+#include "hid_stream.h"
+#include "hid_parser.h"
+
+#define HID_LONG_ITEM 0xFE
+
+void hid_stream_init(hid_stream_t* stream, hid_stream_field_cb_t field, void* ctx)
+{
+  memset(stream, 0, sizeof(hid_stream_t));
+  stream->field = field;
+  stream->ctx = ctx;
+}
+
+// input bits of a report id, claiming a table entry on first use
+static uint32_t* report_bits(hid_stream_t* stream, uint8_t report_id)
+{
+  for (uint8_t i = 0; i < stream->report_id_count; i++)
+  {
+    if (stream->report_ids[i] == report_id) return &stream->report_bits[i];
+  }
+
+  if (stream->report_id_count == HID_STREAM_REPORTS) return NULL;
+
+  uint8_t i = stream->report_id_count++;
+  stream->report_ids[i] = report_id;
+  stream->report_bits[i] = 0;
+  return &stream->report_bits[i];
+}
+
+// local usage of the n-th field of a main item
+static uint32_t field_usage(hid_stream_t const* stream, uint16_t n)
+{
+  if (stream->usage_count)
+  {
+    return stream->usages[n < stream->usage_count ? n : stream->usage_count - 1];
+  }
+
+  if (stream->has_usage_range)
+  {
+    uint32_t usage = stream->usage_min + n;
+    return usage > stream->usage_max ? stream->usage_max : usage;
+  }
+
+  return 0;
+}
+
+// emits the variable fields of an input item and advances its report
+static void input_item(hid_stream_t* stream, uint32_t flags)
+{
+  hid_stream_globals_t const* globals = &stream->globals;
+  uint32_t* bits = report_bits(stream, globals->report_id);
+  if (!bits)
+  {
+    stream->error = true;
+    return;
+  }
+
+  // constant padding and arrays only take up space
+  if ((flags & HID_IOF_CONSTANT) || !(flags & HID_IOF_VARIABLE))
+  {
+    *bits += (uint32_t)globals->report_size * globals->report_count;
+    return;
+  }
+
+  int32_t logical_max = globals->logical_max;
+  if (logical_max < globals->logical_min) logical_max = (int32_t)globals->logical_max_raw;
+
+  for (uint16_t n = 0; n < globals->report_count; n++)
+  {
+    uint32_t usage = field_usage(stream, n);
+    hid_stream_field_t field = {
+      .report_id = globals->report_id,
+      .bit_offset = *bits,
+      .bit_size = globals->report_size,
+      .usage_page = (usage >> 16) ? (usage >> 16) : globals->usage_page,
+      .usage = usage & 0xffff,
+      .logical_min = globals->logical_min,
+      .logical_max = logical_max,
+    };
+    stream->field(stream->ctx, &field);
+
+    *bits += globals->report_size;
+  }
+}
+
+// applies one complete short item
+static void short_item(hid_stream_t* stream)
+{
+  hid_stream_globals_t* globals = &stream->globals;
+  uint32_t data = stream->data;
+  int32_t signed_data = stream->size == 1 ? (int8_t)data :
+                        stream->size == 2 ? (int16_t)data : (int32_t)data;
+  // 32-bit usages already carry their page
+  uint32_t usage = stream->size == 4 ? data : (data & 0xffff);
+
+  switch (stream->prefix & (HID_RI_TYPE_MASK | HID_RI_TAG_MASK))
+  {
+    case HID_RI_USAGE_PAGE(0):
+      globals->usage_page = data;
+      break;
+
+    case HID_RI_LOGICAL_MINIMUM(0):
+      globals->logical_min = signed_data;
+      break;
+
+    case HID_RI_LOGICAL_MAXIMUM(0):
+      globals->logical_max = signed_data;
+      globals->logical_max_raw = data;
+      break;
+
+    case HID_RI_REPORT_SIZE(0):
+      globals->report_size = data;
+      break;
+
+    case HID_RI_REPORT_COUNT(0):
+      globals->report_count = data;
+      break;
+
+    case HID_RI_REPORT_ID(0):
+      globals->report_id = data;
+      break;
+
+    case HID_RI_PUSH(0):
+      if (stream->depth == HID_STREAM_STACK)
+      {
+        stream->error = true;
+        break;
+      }
+      stream->stack[stream->depth++] = *globals;
+      break;
+
+    case HID_RI_POP(0):
+      if (!stream->depth)
+      {
+        stream->error = true;
+        break;
+      }
+      *globals = stream->stack[--stream->depth];
+      break;
+
+    case HID_RI_USAGE(0):
+      if (stream->usage_count < HID_STREAM_USAGES) stream->usages[stream->usage_count++] = usage;
+      break;
+
+    case HID_RI_USAGE_MINIMUM(0):
+      stream->usage_min = usage;
+      stream->has_usage_range = true;
+      break;
+
+    case HID_RI_USAGE_MAXIMUM(0):
+      stream->usage_max = usage;
+      stream->has_usage_range = true;
+      break;
+
+    case HID_RI_INPUT(0):
+      input_item(stream, data);
+      // main items end the local state
+      /* fallthrough */
+    case HID_RI_OUTPUT(0):
+    case HID_RI_FEATURE(0):
+    case HID_RI_COLLECTION(0):
+    case HID_RI_END_COLLECTION(0):
+      stream->usage_count = 0;
+      stream->usage_min = 0;
+      stream->usage_max = 0;
+      stream->has_usage_range = false;
+      break;
+  }
+}
+
+// parses the next chunk of a report descriptor
+void hid_stream_feed(hid_stream_t* stream, uint8_t const* data, uint16_t len)
+{
+  for (uint16_t i = 0; i < len && !stream->error; i++)
+  {
+    uint8_t byte = data[i];
+
+    if (stream->skip)
+    {
+      stream->skip--;
+      continue;
+    }
+
+    if (!stream->in_item)
+    {
+      stream->prefix = byte;
+      stream->got = 0;
+      stream->data = 0;
+      stream->in_item = true;
+
+      // long items carry their data size and tag in two header bytes
+      if (byte == HID_LONG_ITEM) stream->size = 2;
+      else stream->size = (byte & HID_RI_DATA_SIZE_MASK) == HID_RI_DATA_BITS_32 ? 4 : (byte & HID_RI_DATA_SIZE_MASK);
+    }
+    else
+    {
+      stream->data |= (uint32_t)byte << (8 * stream->got++);
+    }
+
+    if (stream->got < stream->size) continue;
+    stream->in_item = false;
+
+    if (stream->prefix == HID_LONG_ITEM) stream->skip = stream->data & 0xff;
+    else short_item(stream);
+  }
+}
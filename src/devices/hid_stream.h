@@ -0,0 +1,76 @@
+// hid_stream.h
+#ifndef HID_STREAM_H
+#define HID_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HID_STREAM_USAGES 16  // local usages kept per main item
+#define HID_STREAM_STACK 2    // push/pop depth
+#define HID_STREAM_REPORTS 16 // input report ids tracked
+
+// one variable input field, emitted as soon as its main item is read
+typedef struct
+{
+  uint8_t report_id;   // 0 without report ids
+  uint16_t bit_offset; // from the start of the report data (after the id byte)
+  uint16_t bit_size;
+  uint16_t usage_page;
+  uint16_t usage;
+  int32_t logical_min;
+  int32_t logical_max;
+} hid_stream_field_t;
+
+typedef void (*hid_stream_field_cb_t)(void* ctx, hid_stream_field_t const* field);
+
+// global item state, saved by push/pop
+typedef struct
+{
+  uint16_t usage_page;
+  uint8_t report_id;
+  uint16_t report_size;
+  uint16_t report_count;
+  int32_t logical_min;
+  int32_t logical_max;      // sign extended
+  uint32_t logical_max_raw; // unsigned, used when the signed max is below min
+} hid_stream_globals_t;
+
+// Parser state. Descriptor bytes can be fed in chunks of any size, no item
+// lists are built, so memory stays the same whatever the descriptor size.
+typedef struct
+{
+  hid_stream_field_cb_t field;
+  void* ctx;
+
+  // item being read
+  uint8_t prefix;
+  uint8_t size;    // data bytes of the item
+  uint8_t got;     // data bytes read so far
+  bool in_item;
+  uint32_t data;
+  uint16_t skip;   // long item data still to skip
+
+  hid_stream_globals_t globals;
+  hid_stream_globals_t stack[HID_STREAM_STACK];
+  uint8_t depth;
+
+  // local items, cleared by each main item. usages read with a 32-bit item
+  // carry their page in the upper half.
+  uint32_t usages[HID_STREAM_USAGES];
+  uint8_t usage_count;
+  uint32_t usage_min;
+  uint32_t usage_max;
+  bool has_usage_range;
+
+  // input bits used so far per report id
+  uint8_t report_ids[HID_STREAM_REPORTS];
+  uint32_t report_bits[HID_STREAM_REPORTS];
+  uint8_t report_id_count;
+
+  bool error; // stack or report table overflow, the rest is ignored
+} hid_stream_t;
+
+void hid_stream_init(hid_stream_t* stream, hid_stream_field_cb_t field, void* ctx);
+void hid_stream_feed(hid_stream_t* stream, uint8_t const* data, uint16_t len);
+
+#endif // HID_STREAM_H
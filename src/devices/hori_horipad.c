@@ -2,12 +2,11 @@
 #include "hori_horipad.h"
 #include "globals.h"
 
-// check if device is HORIPAD for Nintendo Switch 
+// vid/pid of HORIPAD for Nintendo Switch 
 //                (or Sega Genesis mini controllers)
-bool is_hori_horipad(uint16_t vid, uint16_t pid)
-{
-  return ((vid == 0x0f0d && pid == 0x00c1)); // Switch HORI HORIPAD
-}
+static const device_id_t hori_horipad_ids[] = {
+  { 0x0f0d, 0x00c1 }, // Switch HORI HORIPAD
+};
 
 // check if 2 reports are different enough
 bool diff_report_horipad(hori_horipad_report_t const* rpt1, hori_horipad_report_t const* rpt2) {
@@ -25,12 +24,12 @@ bool diff_report_horipad(hori_horipad_report_t const* rpt1, hori_horipad_report_
 // process usb hid input reports
 void process_hori_horipad(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static hori_horipad_report_t prev_report[5] = { 0 };
+  static hori_horipad_report_t prev_report[MAX_DEVICES] = { 0 };
 
   hori_horipad_report_t input_report;
   memcpy(&input_report, report, sizeof(input_report));
 
-  if (diff_report_horipad(&prev_report[dev_addr-1], &input_report)) {
+  if (diff_report_horipad(&prev_report[dev_addr], &input_report)) {
     TU_LOG1("(x, y, z, rz) = (%d, %d, %d, %d) ", input_report.axis_x, input_report.axis_y, input_report.axis_z, input_report.axis_rz);
     TU_LOG1("DPad = %d ", input_report.dpad);
 
@@ -105,15 +104,25 @@ void process_hori_horipad(uint8_t dev_addr, uint8_t instance, uint8_t const* rep
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, axis_x, axis_y, axis_z, axis_rz, 0, 0, 0, 0);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = axis_x,
+      .analog_1y = axis_y,
+      .analog_2x = axis_z,
+      .analog_2y = axis_rz,
+    };
+    post_input(&input);
 
-    prev_report[dev_addr-1] = input_report;
+    prev_report[dev_addr] = input_report;
   }
 }
 
 DeviceInterface hori_horipad_interface = {
   .name = "HORI HORIPAD (or Genesis/MD Mini)",
-  .is_device = is_hori_horipad,
+  .ids = hori_horipad_ids,
+  .id_count = TU_ARRAY_SIZE(hori_horipad_ids),
   .process = process_hori_horipad,
   .task = NULL,
   .init = NULL
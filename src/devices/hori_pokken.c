@@ -2,10 +2,10 @@
 #include "hori_pokken.h"
 #include "globals.h"
 
-// check if device is HORI Pokken controller for Wii U
-static inline bool is_hori_pokken(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x0f0d && pid == 0x0092)); // Wii U Pokken
-}
+// vid/pid of HORI Pokken controller for Wii U
+static const device_id_t hori_pokken_ids[] = {
+  { 0x0f0d, 0x0092 }, // Wii U Pokken
+};
 
 // check if 2 reports are different enough
 bool diff_report_pokken(hori_pokken_report_t const* rpt1, hori_pokken_report_t const* rpt2) {
@@ -23,12 +23,12 @@ bool diff_report_pokken(hori_pokken_report_t const* rpt1, hori_pokken_report_t c
 // process usb hid input reports
 void process_hori_pokken(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static hori_pokken_report_t prev_report[5][5];
+  static hori_pokken_report_t prev_report[MAX_DEVICES][5];
 
   hori_pokken_report_t update_report;
   memcpy(&update_report, report, sizeof(update_report));
 
-  if (diff_report_pokken(&prev_report[dev_addr-1][instance], &update_report)) {
+  if (diff_report_pokken(&prev_report[dev_addr][instance], &update_report)) {
     TU_LOG1("(x, y, z, rz) = (%u, %u %u, %u)\r\n", update_report.x_axis, update_report.y_axis, update_report.z_axis, update_report.rz_axis);
     TU_LOG1("DPad = %d ", update_report.dpad);
     if (update_report.y) TU_LOG1("Y ");
@@ -80,15 +80,25 @@ void process_hori_pokken(uint8_t dev_addr, uint8_t instance, uint8_t const* repo
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, axis_x, axis_y, axis_z, axis_rz, 0, 0, 0, 0);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = axis_x,
+      .analog_1y = axis_y,
+      .analog_2x = axis_z,
+      .analog_2y = axis_rz,
+    };
+    post_input(&input);
 
-    prev_report[dev_addr-1][instance] = update_report;
+    prev_report[dev_addr][instance] = update_report;
   }
 }
 
 DeviceInterface hori_pokken_interface = {
   .name = "HORI Pokken for Wii U",
-  .is_device = is_hori_pokken,
+  .ids = hori_pokken_ids,
+  .id_count = TU_ARRAY_SIZE(hori_pokken_ids),
   .process = process_hori_pokken,
   .task = NULL,
   .init = NULL
@@ -2,10 +2,10 @@
 #include "logitech_wingman.h"
 #include "globals.h"
 
-// check if device is Logitech WingMan Action controller
-static inline bool is_logitech_wingman(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x046d && pid == 0xc20b)); // Logitech WingMan Action controller
-}
+// vid/pid of Logitech WingMan Action controller
+static const device_id_t logitech_wingman_ids[] = {
+  { 0x046d, 0xc20b }, // Logitech WingMan Action controller
+};
 
 // check if 2 reports are different enough
 bool diff_report_logitech_wingman(logitech_wingman_report_t const* rpt1, logitech_wingman_report_t const* rpt2) {
@@ -32,12 +32,12 @@ bool diff_report_logitech_wingman(logitech_wingman_report_t const* rpt1, logitec
 // process usb hid input reports
 void process_logitech_wingman(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static logitech_wingman_report_t prev_report[5] = { 0 };
+  static logitech_wingman_report_t prev_report[MAX_DEVICES] = { 0 };
 
   logitech_wingman_report_t wingman_report;
   memcpy(&wingman_report, report, sizeof(wingman_report));
 
-  if (diff_report_logitech_wingman(&prev_report[dev_addr-1], &wingman_report)) {
+  if (diff_report_logitech_wingman(&prev_report[dev_addr], &wingman_report)) {
     TU_LOG1("(x, y, z) = (%u, %u, %u)\r\n", wingman_report.analog_x, wingman_report.analog_y, wingman_report.analog_z);
     TU_LOG1("DPad = %d ", wingman_report.dpad);
     if (wingman_report.a) TU_LOG1("A ");
@@ -114,15 +114,25 @@ void process_logitech_wingman(uint8_t dev_addr, uint8_t instance, uint8_t const*
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, analog_x1, analog_y1, analog_x2, analog_y2, 0, 0, 0, 0);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = analog_x1,
+      .analog_1y = analog_y1,
+      .analog_2x = analog_x2,
+      .analog_2y = analog_y2,
+    };
+    post_input(&input);
 
-    prev_report[dev_addr-1] = wingman_report;
+    prev_report[dev_addr] = wingman_report;
   }
 }
 
 DeviceInterface logitech_wingman_interface = {
   .name = "Logitech WingMan Action",
-  .is_device = is_logitech_wingman,
+  .ids = logitech_wingman_ids,
+  .id_count = TU_ARRAY_SIZE(logitech_wingman_ids),
   .process = process_logitech_wingman,
   .task = NULL,
   .init = NULL
@@ -2,14 +2,12 @@
 #include "sega_astrocity.h"
 #include "globals.h"
 
-// check if device is Sega Astro City mini controller
-static inline bool is_sega_astrocity(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x0ca3 && (
-           pid == 0x0028 || // Astro City mini joystick
-           pid == 0x0027 || // Astro City mini controller
-           pid == 0x0024    // 8BitDo M30 6-button controller (2.4g)
-         )));
-}
+// vid/pid of Sega Astro City mini controller
+static const device_id_t sega_astrocity_ids[] = {
+  { 0x0ca3, 0x0028 }, // Astro City mini joystick
+  { 0x0ca3, 0x0027 }, // Astro City mini controller
+  { 0x0ca3, 0x0024 }, // 8BitDo M30 6-button controller (2.4g)
+};
 
 // check if 2 reports are different enough
 bool diff_report_sega_astrocity(sega_astrocity_report_t const* rpt1, sega_astrocity_report_t const* rpt2) {
@@ -34,12 +32,12 @@ bool diff_report_sega_astrocity(sega_astrocity_report_t const* rpt1, sega_astroc
 // process usb hid input reports
 void process_sega_astrocity(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static sega_astrocity_report_t prev_report[5] = { 0 };
+  static sega_astrocity_report_t prev_report[MAX_DEVICES] = { 0 };
 
   sega_astrocity_report_t astro_report;
   memcpy(&astro_report, report, sizeof(astro_report));
 
-  if (diff_report_sega_astrocity(&prev_report[dev_addr-1], &astro_report)) {
+  if (diff_report_sega_astrocity(&prev_report[dev_addr], &astro_report)) {
     TU_LOG1("DPad = x:%d, y:%d ", astro_report.x, astro_report.y);
     if (astro_report.a) TU_LOG1("A "); // X   <-M30 buttons
     if (astro_report.b) TU_LOG1("B "); // Y
@@ -80,15 +78,25 @@ void process_sega_astrocity(uint8_t dev_addr, uint8_t instance, uint8_t const* r
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, 128, 128, 128, 128, 0, 0, 0, 0);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = 128,
+      .analog_1y = 128,
+      .analog_2x = 128,
+      .analog_2y = 128,
+    };
+    post_input(&input);
 
-    prev_report[dev_addr-1] = astro_report;
+    prev_report[dev_addr] = astro_report;
   }
 }
 
 DeviceInterface sega_astrocity_interface = {
   .name = "Sega Astro City Mini",
-  .is_device = is_sega_astrocity,
+  .ids = sega_astrocity_ids,
+  .id_count = TU_ARRAY_SIZE(sega_astrocity_ids),
   .process = process_sega_astrocity,
   .task = NULL,
   .init = NULL
@@ -1,7 +1,7 @@
 // sony_ds3.c
 #include "sony_ds3.h"
 #include "globals.h"
-#include "bsp/board_api.h"
+#include "hid_output.h"
 
 // DualSense instance state
 typedef struct TU_ATTR_PACKED
@@ -21,10 +21,10 @@ static ds3_device_t ds3_devices[MAX_DEVICES] = { 0 };
 // Special PS3 Controller enable commands
 const uint8_t ds3_init_cmd_buf[4] = {0x42, 0x0c, 0x00, 0x00};
 
-// check if device is Sony PlayStation 3 controllers
-bool is_sony_ds3(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x054c && pid == 0x0268)); // Sony DualShock3
-}
+// vid/pid of Sony PlayStation 3 controllers
+static const device_id_t sony_ds3_ids[] = {
+  { 0x054c, 0x0268 }, // Sony DualShock3
+};
 
 // check if 2 reports are different enough
 bool diff_report_ds3(sony_ds3_report_t const* rpt1, sony_ds3_report_t const* rpt2)
@@ -54,7 +54,7 @@ bool diff_report_ds3(sony_ds3_report_t const* rpt1, sony_ds3_report_t const* rpt
 // process input input reports
 void input_sony_ds3(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static sony_ds3_report_t prev_report[5] = { 0 };
+  static sony_ds3_report_t prev_report[MAX_DEVICES] = { 0 };
 
   uint8_t const report_id = report[0];
   report++;
@@ -67,12 +67,12 @@ void input_sony_ds3(uint8_t dev_addr, uint8_t instance, uint8_t const* report, u
     memcpy(&ds3_report, report, sizeof(ds3_report));
 
     // counter is +1, assign to make it easier to compare 2 report
-    prev_report[dev_addr-1].counter = ds3_report.counter;
+    prev_report[dev_addr].counter = ds3_report.counter;
 
     // only print if changes since it is polled ~ 5ms
     // Since count+1 after each report and  x, y, z, rz fluctuate within 1 or 2
     // We need more than memcmp to check if report is different enough
-    if ( diff_report_ds3(&prev_report[dev_addr-1], &ds3_report) )
+    if ( diff_report_ds3(&prev_report[dev_addr], &ds3_report) )
     {
       uint8_t analog_1x = ds3_report.lx;
       uint8_t analog_1y = 255 - ds3_report.ly;
@@ -148,9 +148,20 @@ void input_sony_ds3(uint8_t dev_addr, uint8_t instance, uint8_t const* report, u
 
       // add to accumulator and post to the state machine
       // if a scan from the host machine is ongoing, wait
-      post_globals(dev_addr, instance, buttons, analog_1x, analog_1y, analog_2x, analog_2y, analog_l, analog_r, 0, 0);
-
-      prev_report[dev_addr-1] = ds3_report;
+      input_state_t input = {
+        .dev_addr = dev_addr,
+        .instance = instance,
+        .buttons = buttons,
+        .analog_1x = analog_1x,
+        .analog_1y = analog_1y,
+        .analog_2x = analog_2x,
+        .analog_2y = analog_2y,
+        .analog_l = analog_l,
+        .analog_r = analog_r,
+      };
+      post_input(&input);
+
+      prev_report[dev_addr] = ds3_report;
     }
   }
 }
@@ -223,7 +234,7 @@ void output_sony_ds3(uint8_t dev_addr, uint8_t instance, int player_index, uint8
     ds3_devices[dev_addr].instances[instance].player = output_report.data.leds_bitmap;
 
     // Send report without the report ID, start at index 1 instead of 0
-    tuh_hid_send_report(dev_addr, instance, output_report.data.report_id, &(output_report.buf[1]), sizeof(output_report) - 1);
+    hid_output_send(dev_addr, instance, HID_OUTPUT_FEEDBACK, output_report.data.report_id, &(output_report.buf[1]), sizeof(output_report) - 1);
   }
 }
 
@@ -242,19 +253,7 @@ static inline bool init_sony_ds3(uint8_t dev_addr, uint8_t instance) {
   TU_LOG1("PS3 Init..\n");
 
   // Send a Set Report request to the control endpoint
-  return tuh_hid_set_report(dev_addr, instance, 0xF4, HID_REPORT_TYPE_FEATURE, (void *)(ds3_init_cmd_buf), sizeof(ds3_init_cmd_buf));
-}
-
-// process usb hid output reports
-void task_sony_ds3(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds) {
-  const uint32_t interval_ms = 20;
-  static uint32_t start_ms = 0;
-
-  uint32_t current_time_ms = board_millis();
-  if (current_time_ms - start_ms >= interval_ms) {
-    start_ms = current_time_ms;
-    output_sony_ds3(dev_addr, instance, player_index, rumble, leds);
-  }
+  return hid_output_set_report(dev_addr, instance, 0xF4, HID_REPORT_TYPE_FEATURE, ds3_init_cmd_buf, sizeof(ds3_init_cmd_buf));
 }
 
 // resets default values in case devices are hotswapped
@@ -267,8 +266,9 @@ void unmount_sony_ds3(uint8_t dev_addr, uint8_t instance)
 DeviceInterface sony_ds3_interface = {
   .name = "Sony DualShock 3",
   .init = init_sony_ds3,
-  .is_device = is_sony_ds3,
+  .ids = sony_ds3_ids,
+  .id_count = TU_ARRAY_SIZE(sony_ds3_ids),
   .process = input_sony_ds3,
-  .task = output_sony_ds3, // skips throttle task to resolve delayed responses
+  .task = output_sony_ds3,
   .unmount = unmount_sony_ds3,
 };
@@ -1,7 +1,8 @@
 // sony_ds4.c
 #include "sony_ds4.h"
 #include "globals.h"
-#include "bsp/board_api.h"
+#include "spinner.h"
+#include "hid_output.h"
 
 // DualSense instance state
 typedef struct TU_ATTR_PACKED
@@ -18,15 +19,21 @@ typedef struct TU_ATTR_PACKED
 
 static ds4_device_t ds4_devices[MAX_DEVICES] = { 0 };
 
-// check if device is Sony PlayStation 4 controllers
-bool is_sony_ds4(uint16_t vid, uint16_t pid) {
-  return ( (vid == 0x054c && (pid == 0x09cc || pid == 0x05c4)) // Sony DualShock4 
-    || (vid == 0x0f0d && pid == 0x005e) // Hori FC4 
-    || (vid == 0x0f0d && pid == 0x00ee) // Hori PS4 Mini (PS4-099U) 
-    || (vid == 0x1f4f && pid == 0x1002) // ASW GG xrd controller
-    || (vid == 0x1532 && pid == 0x0401) // Razer Panthera PS4 Controller (GP2040-CE PS4 Mode)
-  );
-}
+// touchpad swipes drive the nuon spinner
+#ifdef CONFIG_NUON
+static spinner_t tpad_spinner = { 0 };
+#endif
+static uint8_t spinner = 0;
+
+// vid/pid of Sony PlayStation 4 controllers
+static const device_id_t sony_ds4_ids[] = {
+  { 0x054c, 0x09cc }, // Sony DualShock4
+  { 0x054c, 0x05c4 }, // Sony DualShock4
+  { 0x0f0d, 0x005e }, // Hori FC4
+  { 0x0f0d, 0x00ee }, // Hori PS4 Mini (PS4-099U)
+  { 0x1f4f, 0x1002 }, // ASW GG xrd controller
+  { 0x1532, 0x0401 }, // Razer Panthera PS4 Controller (GP2040-CE PS4 Mode)
+};
 
 // check if 2 reports are different enough
 bool diff_report_ds4(sony_ds4_report_t const* rpt1, sony_ds4_report_t const* rpt2)
@@ -52,7 +59,7 @@ bool diff_report_ds4(sony_ds4_report_t const* rpt1, sony_ds4_report_t const* rpt
 void input_sony_ds4(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
 {
   // previous report used to compare for changes
-  static sony_ds4_report_t prev_report[5] = { 0 };
+  static sony_ds4_report_t prev_report[MAX_DEVICES] = { 0 };
 
   uint8_t const report_id = report[0];
   report++;
@@ -65,12 +72,12 @@ void input_sony_ds4(uint8_t dev_addr, uint8_t instance, uint8_t const* report, u
     memcpy(&ds4_report, report, sizeof(ds4_report));
 
     // counter is +1, assign to make it easier to compare 2 report
-    prev_report[dev_addr-1].counter = ds4_report.counter;
+    prev_report[dev_addr].counter = ds4_report.counter;
 
     // only print if changes since it is polled ~ 5ms
     // Since count+1 after each report and  x, y, z, rz fluctuate within 1 or 2
     // We need more than memcmp to check if report is different enough
-    if ( diff_report_ds4(&prev_report[dev_addr-1], &ds4_report) )
+    if ( diff_report_ds4(&prev_report[dev_addr], &ds4_report) )
     {
       TU_LOG1("(x, y, z, rz, l, r) = (%u, %u, %u, %u, %u, %u)\r\n", ds4_report.x, ds4_report.y, ds4_report.z, ds4_report.rz, ds4_report.r2_trigger, ds4_report.l2_trigger);
       TU_LOG1("DPad = %s ", ds4_report.dpad);
@@ -136,65 +143,41 @@ void input_sony_ds4(uint8_t dev_addr, uint8_t instance, uint8_t const* report, u
 #ifdef CONFIG_NUON
       // Touch Pad - Atari50 Tempest like spinner input
       if (!ds4_report.tpad_f1_down) {
-        // scroll spinner value while swipping
-        if (tpadDragging) {
-          // get directional difference delta
-          int16_t delta = 0;
-          if (tx >= tpadLastPos) delta = tx - tpadLastPos;
-          else delta = (-1) * (tpadLastPos - tx);
-
-          // check max/min delta value
-          if (delta > 12) delta = 12;
-          if (delta < -12) delta = -12;
-
-          // inc global spinner value by delta
-          spinner += delta;
-
-          // check max/min spinner value
-          if (spinner > 255) spinner -= 255;
-          if (spinner < 0) spinner = 256 - (-1 * spinner);
-        }
-
-        tpadLastPos = tx;
-        tpadDragging = true;
+        // scroll spinner value while swipping, at most 12 per report
+        int32_t delta = spinner_follow(&tpad_spinner, tx);
+        spinner = spinner_move(&tpad_spinner, delta * SPINNER_STEP, 12 * SPINNER_STEP);
       } else {
-        tpadDragging = false;
+        spinner_release(&tpad_spinner);
       }
       // TU_LOG1(" (spinner) = (%u)\r\n", spinner);
 #endif
       // keep analog within range [1-255]
       ensureAllNonZero(&analog_1x, &analog_1y, &analog_2x, &analog_2y);
 
-      // adds deadzone
-      uint8_t deadzone = 40;
-      if (analog_1x > (128-(deadzone/2)) && analog_1x < (128+(deadzone/2))) analog_1x = 128;
-      if (analog_1y > (128-(deadzone/2)) && analog_1y < (128+(deadzone/2))) analog_1y = 128;
-      if (analog_2x > (128-(deadzone/2)) && analog_2x < (128+(deadzone/2))) analog_2x = 128;
-      if (analog_2y > (128-(deadzone/2)) && analog_2y < (128+(deadzone/2))) analog_2y = 128;
-
       // add to accumulator and post to the state machine
       // if a scan from the host machine is ongoing, wait
-      post_globals(
-        dev_addr,
-        instance,
-        buttons,
-        analog_1x, // Left Analog X
-        analog_1y, // Left Analog Y
-        analog_2x, // Right Analog X
-        analog_2y, // Right Analog Y
-        analog_l,  // Left Trigger
-        analog_r,  // Right Trigger
-        0,
-        spinner    // Spinner Quad X
-      );
-
-      prev_report[dev_addr-1] = ds4_report;
+      input_state_t input = {
+        .dev_addr = dev_addr,
+        .instance = instance,
+        .buttons = buttons,
+        .analog_1x = analog_1x, // Left Analog X
+        .analog_1y = analog_1y, // Left Analog Y
+        .analog_2x = analog_2x, // Right Analog X
+        .analog_2y = analog_2y, // Right Analog Y
+        .analog_l = analog_l,   // Left Trigger
+        .analog_r = analog_r,   // Right Trigger
+        .quad_x = spinner,      // Spinner Quad X
+        .deadzone = 20,         // worn sticks drift
+      };
+      post_input(&input);
+
+      prev_report[dev_addr] = ds4_report;
     }
   }
 }
 
 // process usb hid output reports
-void output_sony_ds4(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble) {
+void output_sony_ds4(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds) {
   sony_ds4_output_report_t output_report = {0};
   output_report.set_led = 1;
 
@@ -342,19 +325,7 @@ void output_sony_ds4(uint8_t dev_addr, uint8_t instance, int player_index, uint8
   {
     ds4_devices[dev_addr].instances[instance].rumble = rumble;
     ds4_devices[dev_addr].instances[instance].player = is_fun ? fun_inc : player_index+1;
-    tuh_hid_send_report(dev_addr, instance, 5, &output_report, sizeof(output_report));
-  }
-}
-
-// process usb hid output reports
-void task_sony_ds4(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds) {
-  const uint32_t interval_ms = 20;
-  static uint32_t start_ms = 0;
-
-  uint32_t current_time_ms = board_millis();
-  if (current_time_ms - start_ms >= interval_ms) {
-    start_ms = current_time_ms;
-    output_sony_ds4(dev_addr, instance, player_index, rumble);
+    hid_output_send(dev_addr, instance, HID_OUTPUT_FEEDBACK, 5, &output_report, sizeof(output_report));
   }
 }
 
@@ -367,8 +338,9 @@ void unmount_sony_ds4(uint8_t dev_addr, uint8_t instance)
 
 DeviceInterface sony_ds4_interface = {
   .name = "Sony DualShock 4",
-  .is_device = is_sony_ds4,
+  .ids = sony_ds4_ids,
+  .id_count = TU_ARRAY_SIZE(sony_ds4_ids),
   .process = input_sony_ds4,
-  .task = task_sony_ds4,
+  .task = output_sony_ds4,
   .unmount = unmount_sony_ds4,
 };
@@ -1,7 +1,8 @@
 // sony_ds5.c
 #include "sony_ds5.h"
 #include "globals.h"
-#include "bsp/board_api.h"
+#include "spinner.h"
+#include "hid_output.h"
 
 // DualSense instance state
 typedef struct TU_ATTR_PACKED
@@ -18,12 +19,18 @@ typedef struct TU_ATTR_PACKED
 
 static ds5_device_t ds5_devices[MAX_DEVICES] = { 0 };
 
+// touchpad swipes drive the nuon spinner
+#ifdef CONFIG_NUON
+static spinner_t tpad_spinner = { 0 };
+#endif
+static uint8_t spinner = 0;
+
 const char* dpad_str[] = { "N", "NE", "E", "SE", "S", "SW", "W", "NW", "none" };
 
-// check if device is Sony PlayStation 5 controllers
-bool is_sony_ds5(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x054c && pid == 0x0ce6)); // Sony DualSense
-}
+// vid/pid of Sony PlayStation 5 controllers
+static const device_id_t sony_ds5_ids[] = {
+  { 0x054c, 0x0ce6 }, // Sony DualSense
+};
 
 // check if 2 reports are different enough
 bool diff_report_ds5(sony_ds5_report_t const* rpt1, sony_ds5_report_t const* rpt2) {
@@ -55,7 +62,7 @@ bool diff_report_ds5(sony_ds5_report_t const* rpt1, sony_ds5_report_t const* rpt
 // process usb hid input reports
 void input_sony_ds5(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static sony_ds5_report_t prev_report[5] = { 0 };
+  static sony_ds5_report_t prev_report[MAX_DEVICES] = { 0 };
 
   uint8_t const report_id = report[0];
   report++;
@@ -68,9 +75,9 @@ void input_sony_ds5(uint8_t dev_addr, uint8_t instance, uint8_t const* report, u
     memcpy(&ds5_report, report, sizeof(ds5_report));
 
     // counter is +1, assign to make it easier to compare 2 report
-    prev_report[dev_addr-1].counter = ds5_report.counter;
+    prev_report[dev_addr].counter = ds5_report.counter;
 
-    if ( diff_report_ds5(&prev_report[dev_addr-1], &ds5_report) )
+    if ( diff_report_ds5(&prev_report[dev_addr], &ds5_report) )
     {
       TU_LOG1("(x1, y1, x2, y2, rx, ry) = (%u, %u, %u, %u, %u, %u)\r\n", ds5_report.x1, ds5_report.y1, ds5_report.x2, ds5_report.y2, ds5_report.rx, ds5_report.ry);
       TU_LOG1("DPad = %s ", dpad_str[ds5_report.dpad]);
@@ -130,29 +137,11 @@ void input_sony_ds5(uint8_t dev_addr, uint8_t instance, uint8_t const* report, u
 #ifdef CONFIG_NUON
       // Touch Pad - Atari50 Tempest like spinner input
       if (!ds5_report.tpad_f1_down) {
-        // scroll spinner value while swipping
-        if (tpadDragging) {
-          // get directional difference delta
-          int16_t delta = 0;
-          if (tx >= tpadLastPos) delta = tx - tpadLastPos;
-          else delta = (-1) * (tpadLastPos - tx);
-
-          // check max/min delta value
-          if (delta > 12) delta = 12;
-          if (delta < -12) delta = -12;
-
-          // inc global spinner value by delta
-          spinner += delta;
-
-          // check max/min spinner value
-          if (spinner > 255) spinner -= 255;
-          if (spinner < 0) spinner = 256 - (-1 * spinner);
-        }
-
-        tpadLastPos = tx;
-        tpadDragging = true;
+        // scroll spinner value while swipping, at most 12 per report
+        int32_t delta = spinner_follow(&tpad_spinner, tx);
+        spinner = spinner_move(&tpad_spinner, delta * SPINNER_STEP, 12 * SPINNER_STEP);
       } else {
-        tpadDragging = false;
+        spinner_release(&tpad_spinner);
       }
       // TU_LOG1(" (spinner) = (%u)\r\n", spinner);
 #endif
@@ -168,27 +157,27 @@ void input_sony_ds5(uint8_t dev_addr, uint8_t instance, uint8_t const* report, u
 
       // add to accumulator and post to the state machine
       // if a scan from the host machine is ongoing, wait
-      post_globals(
-        dev_addr,
-        instance,
-        buttons,
-        analog_1x, // Left Analog X
-        analog_1y, // Left Analog Y
-        analog_2x, // Right Analog X
-        analog_2y, // Right Analog Y
-        analog_l,  // Left Trigger
-        analog_r,  // Right Trigger
-        0,
-        spinner    // Spinner Quad X
-      );
-
-      prev_report[dev_addr-1] = ds5_report;
+      input_state_t input = {
+        .dev_addr = dev_addr,
+        .instance = instance,
+        .buttons = buttons,
+        .analog_1x = analog_1x, // Left Analog X
+        .analog_1y = analog_1y, // Left Analog Y
+        .analog_2x = analog_2x, // Right Analog X
+        .analog_2y = analog_2y, // Right Analog Y
+        .analog_l = analog_l,   // Left Trigger
+        .analog_r = analog_r,   // Right Trigger
+        .quad_x = spinner,      // Spinner Quad X
+      };
+      post_input(&input);
+
+      prev_report[dev_addr] = ds5_report;
     }
   }
 }
 
 // process usb hid output reports
-void output_sony_ds5(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble) {
+void output_sony_ds5(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds) {
   ds5_feedback_t ds5_fb = {0};
   int32_t perc_threshold_l = -1;
   int32_t perc_threshold_r = -1;
@@ -404,19 +393,7 @@ void output_sony_ds5(uint8_t dev_addr, uint8_t instance, int player_index, uint8
   {
     ds5_devices[dev_addr].instances[instance].rumble = rumble;
     ds5_devices[dev_addr].instances[instance].player = ds5_fb.player_led & 0xff;
-    tuh_hid_send_report(dev_addr, instance, 5, &ds5_fb, sizeof(ds5_fb));
-  }
-}
-
-// process usb hid output reports
-void task_sony_ds5(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds) {
-  const uint32_t interval_ms = 20;
-  static uint32_t start_ms = 0;
-
-  uint32_t current_time_ms = board_millis();
-  if (current_time_ms - start_ms >= interval_ms) {
-    start_ms = current_time_ms;
-    output_sony_ds5(dev_addr, instance, player_index, rumble);
+    hid_output_send(dev_addr, instance, HID_OUTPUT_FEEDBACK, 5, &ds5_fb, sizeof(ds5_fb));
   }
 }
 
@@ -429,8 +406,9 @@ void unmount_sony_ds5(uint8_t dev_addr, uint8_t instance)
 
 DeviceInterface sony_ds5_interface = {
   .name = "Sony DualSense",
-  .is_device = is_sony_ds5,
+  .ids = sony_ds5_ids,
+  .id_count = TU_ARRAY_SIZE(sony_ds5_ids),
   .process = input_sony_ds5,
-  .task = task_sony_ds5,
+  .task = output_sony_ds5,
   .unmount = unmount_sony_ds5,
 };
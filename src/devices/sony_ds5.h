@@ -101,8 +101,5 @@ typedef struct {
 } ds5_feedback_t;
 
 uint32_t buttons;
-extern int16_t spinner;
-uint16_t tpadLastPos;
-bool tpadDragging;
 
 #endif
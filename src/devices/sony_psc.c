@@ -2,10 +2,10 @@
 #include "sony_psc.h"
 #include "globals.h"
 
-// check if device is PlayStation Classic controller
-bool is_sony_psc(uint16_t vid, uint16_t pid) {
-  return ((vid == 0x054c && pid == 0x0cda)); // Sony PSClassic
-}
+// vid/pid of PlayStation Classic controller
+static const device_id_t sony_psc_ids[] = {
+  { 0x054c, 0x0cda }, // Sony PSClassic
+};
 
 // check if 2 reports are different enough
 bool diff_report_psc(sony_psc_report_t const* rpt1, sony_psc_report_t const* rpt2) {
@@ -16,15 +16,15 @@ bool diff_report_psc(sony_psc_report_t const* rpt1, sony_psc_report_t const* rpt
 // process usb hid input reports
 void process_sony_psc(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static sony_psc_report_t prev_report[5] = { 0 };
+  static sony_psc_report_t prev_report[MAX_DEVICES] = { 0 };
 
   sony_psc_report_t psc_report;
   memcpy(&psc_report, report, sizeof(psc_report));
 
   // counter is +1, assign to make it easier to compare 2 report
-  prev_report[dev_addr-1].counter = psc_report.counter;
+  prev_report[dev_addr].counter = psc_report.counter;
 
-  if (diff_report_psc(&prev_report[dev_addr-1], &psc_report)) {
+  if (diff_report_psc(&prev_report[dev_addr], &psc_report)) {
     TU_LOG1("DPad = %d ", psc_report.dpad);
 
     if (psc_report.square   ) TU_LOG1("Square ");
@@ -68,15 +68,25 @@ void process_sony_psc(uint8_t dev_addr, uint8_t instance, uint8_t const* report,
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, 128, 128, 128, 128, 0, 0, 0, 0);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = 128,
+      .analog_1y = 128,
+      .analog_2x = 128,
+      .analog_2y = 128,
+    };
+    post_input(&input);
 
-    prev_report[dev_addr-1] = psc_report;
+    prev_report[dev_addr] = psc_report;
   }
 }
 
 DeviceInterface sony_psc_interface = {
   .name = "Sony PlayStation Classic",
-  .is_device = is_sony_psc,
+  .ids = sony_psc_ids,
+  .id_count = TU_ARRAY_SIZE(sony_psc_ids),
   .process = process_sony_psc,
   .task = NULL,
   .init = NULL
@@ -1,7 +1,7 @@
 // switch_pro.c
 #include "switch_pro.h"
 #include "globals.h"
-#include "bsp/board_api.h"
+#include "hid_output.h"
 
 // Switch instance state
 typedef struct TU_ATTR_PACKED
@@ -29,14 +29,11 @@ typedef struct TU_ATTR_PACKED
 
 static switch_device_t switch_devices[MAX_DEVICES] = { 0 };
 
-// check if device is Nintendo Switch
-static inline bool is_switch_pro(uint16_t vid, uint16_t pid)
-{
-  return ((vid == 0x057e && (
-           pid == 0x2009 || // Nintendo Switch Pro
-           pid == 0x200e    // JoyCon Charge Grip
-  )));
-}
+// vid/pid of Nintendo Switch
+static const device_id_t switch_pro_ids[] = {
+  { 0x057e, 0x2009 }, // Nintendo Switch Pro
+  { 0x057e, 0x200e }, // JoyCon Charge Grip
+};
 
 // check if 2 reports are different enough
 bool diff_report_switch_pro(switch_pro_report_t const* rpt1, switch_pro_report_t const* rpt2)
@@ -62,8 +59,9 @@ uint8_t scale_analog_switch_pro(uint16_t switch_val)
         return 1;
     }
 
-    // Otherwise, scale the switch value from [1, 4095] to [1, 255]
-    return 1 + ((switch_val - 1) * 255) / 4095;
+    // Otherwise, scale the switch value from [1, 4095] to [1, 255].
+    // 4081 / 65536 is 255 / 4095 close enough to be exact for any 16-bit value
+    return 1 + (((uint32_t)(switch_val - 1) * 4081) >> 16);
 }
 
 // resets default values in case devices are hotswapped
@@ -112,7 +110,7 @@ void print_report_switch_pro(switch_pro_report_01_t* report, uint32_t length)
 void input_report_switch_pro(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
 {
   // previous report used to compare for changes
-  static switch_pro_report_t prev_report[5][5];
+  static switch_pro_report_t prev_report[MAX_DEVICES][5];
 
   switch_pro_report_t update_report;
   memcpy(&update_report, report, sizeof(update_report));
@@ -126,7 +124,7 @@ void input_report_switch_pro(uint8_t dev_addr, uint8_t instance, uint8_t const*
     update_report.right_x = (update_report.right_stick[0] & 0xFF) | ((update_report.right_stick[1] & 0x0F) << 8);
     update_report.right_y = ((update_report.right_stick[1] & 0xF0) >> 4) | ((update_report.right_stick[2] & 0xFF) << 4);
 
-    if (diff_report_switch_pro(&prev_report[dev_addr-1][instance], &update_report))
+    if (diff_report_switch_pro(&prev_report[dev_addr][instance], &update_report))
     {
       TU_LOG1("SWITCH[%d|%d]: Report ID = 0x%x\r\n", dev_addr, instance, update_report.report_id);
       TU_LOG1("(lx, ly, rx, ry) = (%u, %u, %u, %u)\r\n", update_report.left_x, update_report.left_y, update_report.right_x, update_report.right_y);
@@ -233,9 +231,18 @@ void input_report_switch_pro(uint8_t dev_addr, uint8_t instance, uint8_t const*
       // add to accumulator and post to the state machine
       // if a scan from the host machine is ongoing, wait
       bool is_root = instance == switch_devices[dev_addr].instance_root;
-      post_globals(dev_addr, is_root ? instance : -1, buttons, leftX, leftY, rightX, rightY, 0, 0, 0, 0);
-
-      prev_report[dev_addr-1][instance] = update_report;
+      input_state_t input = {
+        .dev_addr = dev_addr,
+        .instance = is_root ? instance : -1,
+        .buttons = buttons,
+        .analog_1x = leftX,
+        .analog_1y = leftY,
+        .analog_2x = rightX,
+        .analog_2y = rightY,
+      };
+      post_input(&input);
+
+      prev_report[dev_addr][instance] = update_report;
     }
   }
   else // process input reports for events and command acknowledgments
@@ -284,7 +291,7 @@ bool send_command_switch_pro(uint8_t dev_addr, uint8_t instance, uint8_t *data,
 
   memcpy(buf + 8, data, len);
 
-  tuh_hid_send_report(dev_addr, instance, buf[0], &(buf[0])+1, sizeof(buf) - 1);
+  return hid_output_send(dev_addr, instance, HID_OUTPUT_COMMAND, buf[0], &(buf[0])+1, sizeof(buf) - 1);
 }
 
 // process usb hid output reports
@@ -313,7 +320,7 @@ void output_switch_pro(uint8_t dev_addr, uint8_t instance, int player_index, uin
 
       TU_LOG1("SWITCH[%d|%d]: Handshake\r\n", dev_addr, instance);
       uint8_t buf1[1] = { 0x02 /* PROCON_USB_HANDSHAKE */ };
-      tuh_hid_send_report(dev_addr, instance, 0x80, buf1, sizeof(buf1));
+      hid_output_send(dev_addr, instance, HID_OUTPUT_COMMAND, 0x80, buf1, sizeof(buf1));
 
     // wait for handshake ack and then send USB enable mode
     } else if (!switch_devices[dev_addr].instances[instance].usb_enable && switch_devices[dev_addr].instances[instance].handshake_ack) {
@@ -321,7 +328,7 @@ void output_switch_pro(uint8_t dev_addr, uint8_t instance, int player_index, uin
 
       TU_LOG1("SWITCH[%d|%d]: Enable USB\r\n", dev_addr, instance);
       uint8_t buf3[1] = { 0x04 /* PROCON_USB_ENABLE */ };
-      tuh_hid_send_report(dev_addr, instance, 0x80, buf3, sizeof(buf3));
+      hid_output_send(dev_addr, instance, HID_OUTPUT_COMMAND, 0x80, buf3, sizeof(buf3));
 
     // wait for usb enabled acknowledgment
     } else if (switch_devices[dev_addr].instances[instance].usb_enable_ack) {
@@ -442,20 +449,6 @@ void output_switch_pro(uint8_t dev_addr, uint8_t instance, int player_index, uin
   }
 }
 
-// process usb hid output reports
-void task_switch_pro(uint8_t dev_addr, uint8_t instance, int player_index, uint8_t rumble, uint8_t leds)
-{
-  const uint32_t interval_ms = 20;
-  static uint32_t start_ms = 0;
-
-  uint32_t current_time_ms = board_millis();
-  if (current_time_ms - start_ms >= interval_ms)
-  {
-    start_ms = current_time_ms;
-    output_switch_pro(dev_addr, instance, player_index, rumble, leds);
-  }
-}
-
 // initialize usb hid input
 static inline bool init_switch_pro(uint8_t dev_addr, uint8_t instance)
 {
@@ -468,7 +461,8 @@ static inline bool init_switch_pro(uint8_t dev_addr, uint8_t instance)
 
 DeviceInterface switch_pro_interface = {
   .name = "Switch Pro",
-  .is_device = is_switch_pro,
+  .ids = switch_pro_ids,
+  .id_count = TU_ARRAY_SIZE(switch_pro_ids),
   .process = input_report_switch_pro,
   .task = output_switch_pro,
   .unmount = unmount_switch_pro,
@@ -2,22 +2,6 @@
 #include "triple_adapter_v1.h"
 #include "globals.h"
 
-// check if device is TripleController (Arduino based HID)
-static inline bool is_triple_adapter_v1(uint16_t vid, uint16_t pid) {
-  bool serial_match = false;
-  bool vidpid_match = (vid == 0x2341 && pid == 0x8036); // Arduino Leonardo
-
-  if (!vidpid_match) return false;
-
-  // Compare the the fetched serial with "NES-SNES-GENESIS"
-  // if(memcmp(devices[dev_addr].serial, tplctr_serial_v1, sizeof(tplctr_serial_v1)) == 0)
-  // {
-  //   serial_match = true;
-  // }
-
-  return serial_match;
-}
-
 // check if 2 reports are different enough
 bool diff_report_triple_adapter_v1(triple_adapter_v1_report_t const* rpt1, triple_adapter_v1_report_t const* rpt2) {
   bool result;
@@ -40,12 +24,12 @@ bool diff_report_triple_adapter_v1(triple_adapter_v1_report_t const* rpt1, tripl
 // process usb hid input reports
 void process_triple_adapter_v1(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
   // previous report used to compare for changes
-  static triple_adapter_v1_report_t prev_report[5][5];
+  static triple_adapter_v1_report_t prev_report[MAX_DEVICES][5];
 
   triple_adapter_v1_report_t update_report;
   memcpy(&update_report, report, sizeof(update_report));
 
-  if (diff_report_triple_adapter_v1(&prev_report[dev_addr-1][instance], &update_report) )
+  if (diff_report_triple_adapter_v1(&prev_report[dev_addr][instance], &update_report) )
   {
     TU_LOG1("(x, y) = (%u, %u)\r\n", update_report.axis_x, update_report.axis_y);
     if (update_report.b) TU_LOG1("B ");
@@ -86,15 +70,24 @@ void process_triple_adapter_v1(uint8_t dev_addr, uint8_t instance, uint8_t const
 
     // add to accumulator and post to the state machine
     // if a scan from the host machine is ongoing, wait
-    post_globals(dev_addr, instance, buttons, 128, 128, 128, 128, 0, 0, 0, 0);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = 128,
+      .analog_1y = 128,
+      .analog_2x = 128,
+      .analog_2y = 128,
+    };
+    post_input(&input);
 
-    prev_report[dev_addr-1][instance] = update_report;
+    prev_report[dev_addr][instance] = update_report;
   }
 }
 
 DeviceInterface triple_adapter_v1_interface = {
   .name = "TripleController Adapter v1",
-  .is_device = is_triple_adapter_v1,
+  .ids = NULL, // Arduino Leonardo 2341:8036, needs serial "NES-SNES-GENESIS" match
   .process = process_triple_adapter_v1,
   .task = NULL,
   .init = NULL
@@ -1,22 +1,31 @@
 // hid_app.c
+#include <string.h>
 #include "tusb.h"
+#include "pico/time.h"
 #include "globals.h"
 #include "devices/device_utils.h"
 #include "devices/device_registry.h"
+#include "devices/hid_output.h"
+#include "devices/hid_cache.h"
+#include "trace.h"
+#include "latency.h"
 
 // #define LANGUAGE_ID 0x0409
 #define MAX_REPORTS 5
 
-// Each HID instance can have multiple reports
-typedef struct TU_ATTR_PACKED
+// Each HID instance can have multiple reports. not packed: tinyusb
+// parses into report_info in place, and its fields need their alignment
+typedef struct
 {
   dev_type_t type;
   uint8_t report_count;
   tuh_hid_report_info_t report_info[MAX_REPORTS];
+  uint8_t next_addr; // next instance with a task hook (0 ends the list)
+  uint8_t next_instance;
 } instance_t;
 
 // Cached device report properties on mount
-typedef struct TU_ATTR_PACKED
+typedef struct
 {
   uint16_t vid, pid;
   instance_t instances[CFG_TUH_HID];
@@ -24,14 +33,86 @@ typedef struct TU_ATTR_PACKED
 } device_t;
 
 static device_t devices[MAX_DEVICES] = { 0 };
-int16_t spinner = 0;
+
+// report descriptors larger than the enumeration buffer reach the mount
+// callback empty. they are fetched again here into one buffer, interfaces
+// waiting their turn in a queue. tinyusb takes the data stage in a single
+// buffer and a descriptor request has no offset, so a longer descriptor is
+// classified from its first LARGE_DESC_MAX bytes by the stream parser
+// (input items lead in practice, a field cut off at the end is dropped).
+#define LARGE_DESC_MAX   4096
+#define LARGE_DESC_QUEUE 8 // interfaces fetching or waiting
+
+typedef struct
+{
+  uint8_t dev_addr;
+  uint8_t instance;
+} large_desc_itf_t;
+
+static uint8_t large_desc[LARGE_DESC_MAX];
+static large_desc_itf_t large_desc_queue[LARGE_DESC_QUEUE]; // first one fetches
+static uint8_t large_desc_count = 0;
+static bool large_desc_busy = false; // fetch of the first one in flight
+
+// head of the mounted instances whose driver has a task hook
+static uint8_t task_head_addr = 0;
+static uint8_t task_head_instance = 0;
 uint32_t buttons;
 
 static void process_generic_report(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len);
+static void large_desc_task(void);
 
 void hid_app_init()
 {
   register_devices();
+  hid_cache_init();
+}
+
+// link a mounted instance into the task list if its driver has a task hook
+static void task_list_add(uint8_t dev_addr, uint8_t instance)
+{
+  dev_type_t dev_type = devices[dev_addr].instances[instance].type;
+  if (dev_type == CONTROLLER_UNKNOWN || !device_interfaces[dev_type] ||
+      !device_interfaces[dev_type]->task) return;
+
+  devices[dev_addr].instances[instance].next_addr = task_head_addr;
+  devices[dev_addr].instances[instance].next_instance = task_head_instance;
+  task_head_addr = dev_addr;
+  task_head_instance = instance;
+}
+
+// unlink an instance from the task list (no-op when not linked)
+static void task_list_remove(uint8_t dev_addr, uint8_t instance)
+{
+  uint8_t prev_addr = 0;
+  uint8_t prev_instance = 0;
+  uint8_t addr = task_head_addr;
+  uint8_t inst = task_head_instance;
+
+  while (addr)
+  {
+    instance_t* node = &devices[addr].instances[inst];
+    if (addr == dev_addr && inst == instance)
+    {
+      if (prev_addr)
+      {
+        devices[prev_addr].instances[prev_instance].next_addr = node->next_addr;
+        devices[prev_addr].instances[prev_instance].next_instance = node->next_instance;
+      }
+      else
+      {
+        task_head_addr = node->next_addr;
+        task_head_instance = node->next_instance;
+      }
+      node->next_addr = 0;
+      return;
+    }
+
+    prev_addr = addr;
+    prev_instance = inst;
+    addr = node->next_addr;
+    inst = node->next_instance;
+  }
 }
 
 void hid_app_task(uint8_t rumble, uint8_t leds)
@@ -41,28 +122,23 @@ void hid_app_task(uint8_t rumble, uint8_t leds)
     if (!fun_inc) fun_player = ++fun_player%0x20;
   }
 
-  // iterate devices and instances that can receive responses
-  for(uint8_t dev_addr=1; dev_addr<MAX_DEVICES; dev_addr++)
+  // send init, LED, rumble to the instances that take responses
+  // (DS3/DS4/DS5, Switch Pro, GameCube adapter, keyboards)
+  uint8_t dev_addr = task_head_addr;
+  uint8_t instance = task_head_instance;
+  while (dev_addr)
   {
-    for(uint8_t instance=0; instance<CFG_TUH_HID; instance++)
-    {
-      int8_t player_index = find_player_index(dev_addr, instance);
-      int8_t ctrl_type = devices[dev_addr].instances[instance].type;
-      switch (ctrl_type)
-      {
-      case CONTROLLER_DUALSENSE: // send DS5 LED and rumble
-      case CONTROLLER_DUALSHOCK3: // send DS3 Init, LED and rumble
-      case CONTROLLER_DUALSHOCK4: // send DS4 LED and rumble
-      case CONTROLLER_GAMECUBE: // send GameCube WiiU/Switch Adapter rumble
-      case CONTROLLER_KEYBOARD: // send Keyboard LEDs
-      case CONTROLLER_SWITCH: // send Switch Pro init, LED and rumble commands
-        device_interfaces[ctrl_type]->task(dev_addr, instance, player_index, rumble, leds);
-        break;
-      default:
-        break;
-      }
-    }
+    instance_t* node = &devices[dev_addr].instances[instance];
+    int8_t player_index = find_player_index(dev_addr, instance);
+    device_interfaces[node->type]->task(dev_addr, instance, player_index, rumble, leds);
+
+    dev_addr = node->next_addr;
+    instance = node->next_instance;
   }
+
+  large_desc_task();
+  hid_cache_task();
+  hid_output_task();
 }
 
 dev_type_t get_dev_type(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len)
@@ -71,12 +147,11 @@ dev_type_t get_dev_type(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_
   tuh_vid_pid_get(dev_addr, &vid, &pid);
   printf("VID = %04x, PID = %04x\r\n", vid, pid);
 
-  for (int i = 0; i < CONTROLLER_TYPE_COUNT-2; i++) {
-    if (device_interfaces[i] &&
-        device_interfaces[i]->is_device(vid, pid)) {
-      printf("DEVICE:[%s]\n", device_interfaces[i]->name);
-      return (dev_type_t)i;
-    }
+  dev_type_t dev_type = find_device_type(vid, pid);
+  if (dev_type != CONTROLLER_UNKNOWN)
+  {
+    printf("DEVICE:[%s]\n", device_interfaces[dev_type]->name);
+    return dev_type;
   }
 
   // Interface protocol (hid_interface_protocol_enum_t)
@@ -112,17 +187,11 @@ dev_type_t get_dev_type(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_
 // TinyUSB Callbacks
 //--------------------------------------------------------------------+
 
-// Invoked when device with hid interface is mounted
-// Report descriptor is also available for use. tuh_hid_parse_report_descriptor()
-// can be used to parse common/simple enough descriptor.
-// Note: if report descriptor length > CFG_TUH_ENUMERATION_BUFSIZE, it will be skipped
-// therefore report_desc = NULL, desc_len = 0
-void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len)
+// sets up a classified instance and starts receiving its reports
+static void mount_instance(uint8_t dev_addr, uint8_t instance, dev_type_t dev_type, uint8_t const* desc_report, uint16_t desc_len)
 {
-  printf("HID device address = %d, instance = %d is mounted\r\n", dev_addr, instance);
-
-  dev_type_t dev_type = get_dev_type(dev_addr, instance, desc_report, desc_len);
   devices[dev_addr].instances[instance].type = dev_type;
+  task_list_add(dev_addr, instance);
 
   // Set device type and defaults
   switch (dev_type)
@@ -159,6 +228,115 @@ void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_re
   }
 }
 
+// drops the first queued interface
+static void large_desc_pop(void)
+{
+  large_desc_count--;
+  memmove(large_desc_queue, large_desc_queue + 1, large_desc_count * sizeof(large_desc_itf_t));
+}
+
+// classifies a report descriptor fetched after mount
+static void large_desc_complete(tuh_xfer_t* xfer)
+{
+  uint8_t dev_addr = xfer->daddr;
+  uint8_t instance = (uint8_t)xfer->user_data;
+
+  // unmounted meanwhile, its entry is already gone
+  if (!large_desc_busy || !large_desc_count ||
+      large_desc_queue[0].dev_addr != dev_addr || large_desc_queue[0].instance != instance) return;
+  large_desc_busy = false;
+  large_desc_pop();
+
+  uint16_t desc_len = 0;
+  if (xfer->result == XFER_RESULT_SUCCESS)
+  {
+    desc_len = xfer->actual_len;
+    if (desc_len == sizeof(large_desc)) printf("HID report descriptor cut at %u bytes\r\n", desc_len);
+  }
+  else
+  {
+    printf("Error: cannot fetch report descriptor\r\n");
+  }
+
+  dev_type_t dev_type = CONTROLLER_UNKNOWN;
+  if (desc_len && device_interfaces[CONTROLLER_DINPUT]->check_descriptor(dev_addr, instance, large_desc, desc_len))
+  {
+    dev_type = CONTROLLER_DINPUT;
+  }
+  printf("DEVICE:[%s]\n", dev_type == CONTROLLER_DINPUT ? device_interfaces[dev_type]->name : "UKNOWN");
+
+  mount_instance(dev_addr, instance, dev_type, large_desc, desc_len);
+}
+
+// starts the fetch of the first queued interface once the buffer is free
+static void large_desc_task(void)
+{
+  while (large_desc_count && !large_desc_busy)
+  {
+    large_desc_itf_t itf = large_desc_queue[0];
+    tuh_itf_info_t itf_info;
+    if (tuh_hid_itf_get_info(itf.dev_addr, itf.instance, &itf_info) &&
+        tuh_descriptor_get_hid_report(itf.dev_addr, itf_info.desc.bInterfaceNumber, HID_DESC_TYPE_REPORT, 0,
+                                      large_desc, sizeof(large_desc), large_desc_complete, itf.instance))
+    {
+      large_desc_busy = true;
+      return;
+    }
+
+    // mounted without a descriptor, as if it was never fetched
+    printf("Error: cannot fetch report descriptor\r\n");
+    large_desc_pop();
+    mount_instance(itf.dev_addr, itf.instance, CONTROLLER_UNKNOWN, NULL, 0);
+  }
+}
+
+// queues the report descriptor tinyusb skipped for being too large
+static bool fetch_large_descriptor(uint8_t dev_addr, uint8_t instance)
+{
+  if (large_desc_count == LARGE_DESC_QUEUE) return false;
+
+  printf("HID report descriptor exceeds the enumeration buffer, fetching\r\n");
+  large_desc_queue[large_desc_count++] = (large_desc_itf_t){ dev_addr, instance };
+  return true;
+}
+
+// drops a queued interface, a fetch in flight for it is ignored when done
+static void large_desc_remove(uint8_t dev_addr, uint8_t instance)
+{
+  for (uint8_t i = 0; i < large_desc_count; i++)
+  {
+    if (large_desc_queue[i].dev_addr != dev_addr || large_desc_queue[i].instance != instance) continue;
+
+    if (!i) large_desc_busy = false;
+    large_desc_count--;
+    memmove(large_desc_queue + i, large_desc_queue + i + 1, (large_desc_count - i) * sizeof(large_desc_itf_t));
+    return;
+  }
+}
+
+// Invoked when device with hid interface is mounted
+// Report descriptor is also available for use. tuh_hid_parse_report_descriptor()
+// can be used to parse common/simple enough descriptor.
+// Note: if report descriptor length > CFG_TUH_ENUMERATION_BUFSIZE, it will be skipped
+// therefore report_desc = NULL, desc_len = 0
+void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len)
+{
+  printf("HID device address = %d, instance = %d is mounted\r\n", dev_addr, instance);
+
+#ifdef CONFIG_REPORT_TRACE
+  uint16_t vid, pid;
+  tuh_vid_pid_get(dev_addr, &vid, &pid);
+  trace_mount('H', dev_addr, instance, vid, pid, tuh_hid_interface_protocol(dev_addr, instance), desc_report, desc_len);
+#endif
+
+  dev_type_t dev_type = get_dev_type(dev_addr, instance, desc_report, desc_len);
+
+  // a skipped descriptor is fetched again, classification continues once it arrives
+  if (dev_type == CONTROLLER_UNKNOWN && !desc_len && fetch_large_descriptor(dev_addr, instance)) return;
+
+  mount_instance(dev_addr, instance, dev_type, desc_report, desc_len);
+}
+
 // Invoked when device with hid interface is un-mounted
 void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance)
 {
@@ -179,12 +357,19 @@ void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance)
     break;
   }
 
+  large_desc_remove(dev_addr, instance);
+  task_list_remove(dev_addr, instance);
+  hid_output_unmount(dev_addr, instance);
   devices[dev_addr].instances[instance].type = CONTROLLER_UNKNOWN;
 }
 
 // Invoked when received report from device via interrupt endpoint
 void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len)
 {
+  latency_report_received();
+#ifdef CONFIG_REPORT_TRACE
+  uint32_t start_us = time_us_32();
+#endif
   dev_type_t dev_type = devices[dev_addr].instances[instance].type;
   if (dev_type == CONTROLLER_UNKNOWN)
   {
@@ -213,6 +398,10 @@ void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t cons
     device_interfaces[dev_type]->process(dev_addr, instance, report, len);
   }
 
+#ifdef CONFIG_REPORT_TRACE
+  trace_report('H', dev_type, dev_addr, instance, report, len, time_us_32() - start_us);
+#endif
+
   // continue to request to receive report
   if ( !tuh_hid_receive_report(dev_addr, instance) )
   {
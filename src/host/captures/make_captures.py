@@ -0,0 +1,322 @@
+#!/usr/bin/env python3
+# make_captures.py - writes the synthetic report traces replayed by the host
+# tests. Each one scripts a device through its buttons and stick ranges in
+# the REPORT_TRACE format (see common/trace.h), at the device's report rate.
+#
+# usage: make_captures.py [out_dir]
+
+import os
+import sys
+
+MOUNT_US = 500000  # after main()'s start-up pause
+
+
+class Capture:
+    def __init__(self, name, note):
+        self.name = name
+        self.lines = ["# synthetic capture: " + note]
+
+    def mount(self, t, source, dev, inst, vid, pid, protocol, desc=b""):
+        self.lines.append("M %d %s %d %d %04x %04x %d %d" % (t, source, dev, inst, vid, pid, protocol, len(desc)))
+        for i in range(0, len(desc), 64):
+            self.lines.append("d %d %d %d %s" % (t, dev, inst, " ".join("%02x" % b for b in desc[i:i + 64])))
+
+    def report(self, t, source, dev, inst, data):
+        self.lines.append("R %d %s -1 %d %d 0 %s" % (t, source, dev, inst, " ".join("%02x" % b for b in data)))
+
+    def unmount(self, t, dev):
+        self.lines.append("U %d %d" % (t, dev))
+
+    def write(self, out_dir):
+        with open(os.path.join(out_dir, self.name + ".trace"), "w") as f:
+            f.write("\n".join(self.lines) + "\n")
+
+
+def sweep(steps=8):
+    # stick positions around the full range, including both ends
+    return [round(i * 255 / (steps - 1)) for i in range(steps)]
+
+
+def play(cap, t, interval_us, hold_us, script, encode, send):
+    for state in script:
+        for _ in range(hold_us // interval_us):
+            send(t, encode(state))
+            t += interval_us
+    return t
+
+
+def ds4(out_dir):
+    cap = Capture("ds4", "Sony DualShock 4 (054c:09cc), report id 1 every 4 ms")
+    cap.mount(MOUNT_US, "H", 1, 0, 0x054C, 0x09CC, 0)
+    counter = [0]
+
+    script = [{"button": ("dpad", d)} for d in range(8)]
+    script += [{"button": ("b5", 1 << i)} for i in range(4)]  # square cross circle triangle
+    script += [{"button": ("b6", 1 << i)} for i in range(8)]  # l1 r1 l2 r2 share option l3 r3
+    script += [{"button": ("b7", 1 << i)} for i in range(2)]  # ps tpad
+    script += [{"axis": a, "value": v} for a in range(6) for v in sweep()]
+
+    def encode(state):
+        r = bytearray(64)
+        r[0] = 0x01
+        r[1:5] = bytes([128, 128, 128, 128])
+        r[5] = 0x08
+        b = state.get("button")
+        if b and b[0] == "dpad":
+            r[5] = b[1]
+        elif b and b[0] == "b5":
+            r[5] = 0x08 | (b[1] << 4)
+        elif b and b[0] == "b6":
+            r[6] = b[1]
+        elif b and b[0] == "b7":
+            r[7] = b[1]
+        if "axis" in state:
+            a = state["axis"]
+            if a < 4:
+                r[1 + a] = state["value"]
+            else:
+                r[8 + a - 4] = state["value"]
+        r[7] |= (counter[0] & 0x3f) << 2
+        counter[0] += 1
+        r[35] = 0x80  # no touch
+        return bytes(r)
+
+    t = play(cap, MOUNT_US + 10000, 4000, 48000, script, encode,
+             lambda t, r: cap.report(t, "H", 1, 0, r))
+    cap.unmount(t + 10000, 1)
+    cap.write(out_dir)
+
+
+def switch_pro(out_dir):
+    cap = Capture("switch_pro", "Nintendo Switch Pro (057e:2009), full input report 0x30 every 8 ms")
+    cap.mount(MOUNT_US, "H", 1, 0, 0x057E, 0x2009, 0)
+    timer = [0]
+
+    script = [{"button": (byte, 1 << bit)} for byte in (3, 4, 5) for bit in range(8)]
+    script += [{"axis": a, "value": v} for a in range(4) for v in sweep()]
+
+    def stick(x, y):
+        # 12 bits each, little endian
+        return bytes([x & 0xff, ((x >> 8) & 0x0f) | ((y & 0x0f) << 4), (y >> 4) & 0xff])
+
+    def encode(state):
+        r = bytearray(64)
+        r[0] = 0x30
+        r[1] = timer[0] & 0xff
+        timer[0] += 1
+        r[2] = 0x91
+        b = state.get("button")
+        if b:
+            r[b[0]] = b[1]
+        axes = [2048, 2048, 2048, 2048]
+        if "axis" in state:
+            axes[state["axis"]] = state["value"] * 4095 // 255
+        r[6:9] = stick(axes[0], axes[1])
+        r[9:12] = stick(axes[2], axes[3])
+        return bytes(r)
+
+    t = play(cap, MOUNT_US + 10000, 8000, 48000, script, encode,
+             lambda t, r: cap.report(t, "H", 1, 0, r))
+    cap.unmount(t + 10000, 1)
+    cap.write(out_dir)
+
+
+def gamecube_adapter(out_dir):
+    cap = Capture("gamecube_adapter", "GameCube adapter (057e:0337), two pads on report 0x21 every 8 ms")
+    cap.mount(MOUNT_US, "H", 1, 0, 0x057E, 0x0337, 0)
+
+    script = [{"port": p, "button": (byte, 1 << bit)} for p in (0, 1) for byte in (1, 2) for bit in range(8)
+              if not (byte == 2 and bit >= 4)]
+    script += [{"port": 0, "axis": a, "value": v} for a in range(6) for v in sweep()]
+
+    def encode(state):
+        r = bytearray(37)
+        r[0] = 0x21
+        for p in range(4):
+            port = r[1 + p * 9:10 + p * 9]
+            if p < 2:
+                port[0] = 0x10  # wired pad connected
+                port[3:9] = bytes([128, 128, 128, 128, 0, 0])
+            if state.get("port") == p:
+                b = state.get("button")
+                if b:
+                    port[b[0]] = b[1]
+                if "axis" in state:
+                    port[3 + state["axis"]] = state["value"]
+            r[1 + p * 9:10 + p * 9] = port
+        return bytes(r)
+
+    t = play(cap, MOUNT_US + 10000, 8000, 48000, script, encode,
+             lambda t, r: cap.report(t, "H", 1, 0, r))
+    cap.unmount(t + 10000, 1)
+    cap.write(out_dir)
+
+
+def xinput(out_dir):
+    cap = Capture("xinput", "Xbox 360 wired pad (045e:028e), xinput pad state every 4 ms")
+    cap.mount(MOUNT_US, "X", 1, 0, 0x045E, 0x028E, 3)
+
+    script = [{"button": 1 << bit} for bit in range(16) if bit not in (10, 11)]
+    script += [{"trigger": i, "value": v} for i in range(2) for v in sweep()]
+    script += [{"axis": a, "value": v} for a in range(4) for v in sweep()]
+
+    def encode(state):
+        buttons = state.get("button", 0)
+        triggers = [0, 0]
+        axes = [0, 0, 0, 0]
+        if "trigger" in state:
+            triggers[state["trigger"]] = state["value"]
+        if "axis" in state:
+            axes[state["axis"]] = max(-32768, min(32767, (state["value"] - 128) * 256))
+        r = bytearray()
+        r += buttons.to_bytes(2, "little")
+        r += bytes(triggers)
+        for a in axes:
+            r += a.to_bytes(2, "little", signed=True)
+        return bytes(r)
+
+    t = play(cap, MOUNT_US + 10000, 4000, 48000, script, encode,
+             lambda t, r: cap.report(t, "X", 1, 0, r))
+    cap.unmount(t + 10000, 1)
+    cap.write(out_dir)
+
+
+# generic gamepad: four 8-bit axes, 12 buttons, hat switch
+DINPUT_DESC = bytes([
+    0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,
+    0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x04,
+    0x09, 0x30, 0x09, 0x31, 0x09, 0x32, 0x09, 0x35, 0x81, 0x02,
+    0x05, 0x09, 0x19, 0x01, 0x29, 0x0C, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x0C, 0x81, 0x02,
+    0x75, 0x01, 0x95, 0x04, 0x81, 0x03,
+    0x05, 0x01, 0x09, 0x39, 0x15, 0x00, 0x25, 0x07, 0x35, 0x00, 0x46, 0x3B, 0x01, 0x65, 0x14,
+    0x75, 0x04, 0x95, 0x01, 0x81, 0x42,
+    0x75, 0x04, 0x95, 0x01, 0x81, 0x03,
+    0xC0,
+])
+
+
+def dinput(out_dir):
+    cap = Capture("dinput", "generic HID gamepad (1209:0001) parsed from its descriptor, every 8 ms")
+    cap.mount(MOUNT_US, "H", 1, 0, 0x1209, 0x0001, 0, DINPUT_DESC)
+
+    script = [{"button": i} for i in range(12)]
+    script += [{"hat": h} for h in range(8)]
+    script += [{"axis": a, "value": v} for a in range(4) for v in sweep()]
+
+    def encode(state):
+        axes = [128, 128, 128, 128]
+        if "axis" in state:
+            axes[state["axis"]] = state["value"]
+        buttons = 1 << state["button"] if "button" in state else 0
+        hat = state.get("hat", 8)  # out of range is released
+        return bytes(axes) + buttons.to_bytes(2, "little") + bytes([hat])
+
+    t = play(cap, MOUNT_US + 10000, 8000, 48000, script, encode,
+             lambda t, r: cap.report(t, "H", 1, 0, r))
+    cap.unmount(t + 10000, 1)
+    cap.write(out_dir)
+
+
+def large_desc(out_dir):
+    cap = Capture("large_desc", "dinput pads with report descriptors past the enumeration buffer: "
+                  "two interfaces of 1500 bytes on one device, and 5000 bytes (cut at 4096) on another")
+
+    def padded(size):
+        # logical minimum items after the inputs, closed by the end collection
+        body = DINPUT_DESC[:-1]
+        pad = size - len(body) - 1
+        return body + bytes([0x15, 0x00]) * (pad // 2) + bytes([0x15] if pad % 2 else []) + bytes([0xC0])
+
+    cap.mount(MOUNT_US, "H", 1, 0, 0x1209, 0x0003, 0, padded(1500))
+    cap.mount(MOUNT_US, "H", 1, 1, 0x1209, 0x0003, 0, padded(1500))
+    cap.mount(MOUNT_US + 20000, "H", 2, 0, 0x1209, 0x0004, 0, padded(5000))
+    t = MOUNT_US + 50000
+
+    # each pad presses its own buttons in turn
+    for button in range(12):
+        for _ in range(4):
+            for n, (dev, inst) in enumerate(((1, 0), (1, 1), (2, 0))):
+                buttons = 1 << ((button + 4 * n) % 12)
+                cap.report(t + 1000 * n, "H", dev, inst, bytes([128] * 4) + buttons.to_bytes(2, "little") + bytes([8]))
+            t += 8000
+    cap.unmount(t + 10000, 1)
+    cap.unmount(t + 20000, 2)
+    cap.write(out_dir)
+
+
+def keyboard_mouse(out_dir):
+    cap = Capture("keyboard_mouse", "boot keyboard and boot mouse on one receiver (1209:0002), 8 ms")
+    cap.mount(MOUNT_US, "H", 1, 0, 0x1209, 0x0002, 1)
+    cap.mount(MOUNT_US, "H", 1, 1, 0x1209, 0x0002, 2)
+    t = MOUNT_US + 10000
+
+    # every key the firmware maps: letters, digits, arrows, enter/escape, modifiers
+    keys = list(range(0x04, 0x28)) + [0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x4F, 0x50, 0x51, 0x52]
+    for key in keys:
+        for _ in range(4):
+            cap.report(t, "H", 1, 0, bytes([0, 0, key, 0, 0, 0, 0, 0]))
+            t += 8000
+        cap.report(t, "H", 1, 0, bytes(8))
+        t += 8000
+    for modifier in range(8):
+        cap.report(t, "H", 1, 0, bytes([1 << modifier, 0, 0, 0, 0, 0, 0, 0]))
+        t += 8000
+        cap.report(t, "H", 1, 0, bytes(8))
+        t += 8000
+
+    # mouse: buttons, then circles at rising speed
+    for button in range(5):
+        cap.report(t, "H", 1, 1, bytes([1 << button, 0, 0, 0]))
+        t += 8000
+        cap.report(t, "H", 1, 1, bytes(4))
+        t += 8000
+    moves = [(1, 0), (1, 1), (0, 1), (-1, 1), (-1, 0), (-1, -1), (0, -1), (1, -1)]
+    for speed in (1, 4, 16, 64, 127):
+        for dx, dy in moves:
+            for _ in range(3):
+                cap.report(t, "H", 1, 1, bytes([0, (dx * speed) & 0xff, (dy * speed) & 0xff, 0]))
+                t += 8000
+    cap.unmount(t + 10000, 1)
+    cap.write(out_dir)
+
+
+def hub(out_dir):
+    cap = Capture("hub", "DS4 and xinput pad behind a hub, at device addresses 7 and 11 (the highest)")
+    cap.mount(MOUNT_US, "H", 7, 0, 0x054C, 0x09CC, 0)
+    cap.mount(MOUNT_US + 20000, "X", 11, 0, 0x045E, 0x028E, 3)
+    t = MOUNT_US + 30000
+
+    def ds4_report(buttons5, counter):
+        r = bytearray(64)
+        r[0] = 0x01
+        r[1:5] = bytes([128, 128, 128, 128])
+        r[5] = buttons5
+        r[7] = (counter & 0x3f) << 2
+        r[35] = 0x80
+        return bytes(r)
+
+    def xinput_report(buttons):
+        return buttons.to_bytes(2, "little") + bytes(10)
+
+    # press in turn on each pad, so both players show up in one frame
+    presses = [(0x08 | (1 << (4 + i)), 1 << (12 + i)) for i in range(4)] + [(0x08, 0)]
+    counter = 0
+    for ds4_buttons, xinput_buttons in presses:
+        for _ in range(12):
+            cap.report(t, "H", 7, 0, ds4_report(ds4_buttons, counter))
+            cap.report(t + 2000, "X", 11, 0, xinput_report(xinput_buttons))
+            counter += 1
+            t += 4000
+    cap.unmount(t + 10000, 7)
+    cap.unmount(t + 20000, 11)
+    cap.write(out_dir)
+
+
+def main():
+    out_dir = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    for make in (ds4, switch_pro, gamecube_adapter, xinput, dinput, large_desc, keyboard_mouse, hub):
+        make(out_dir)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,470 @@
+// host.c - pico-sdk shim runtime: virtual time, gpio, flash, pio fifos, dma
+
+#include <stdlib.h>
+#include <time.h>
+#include "host.h"
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/bootrom.h"
+#include "pico/i2c_slave.h"
+#include "hardware/sync.h"
+#include "hardware/irq.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "hardware/structs/scb.h"
+#include "bsp/board_api.h"
+#include "GamecubeConsole.h"
+
+//--------------------------------------------------------------------+
+// time
+//--------------------------------------------------------------------+
+uint64_t host_now_us = 0;
+
+static void wait_until(uint64_t deadline_us)
+{
+  if (deadline_us > host_now_us) host_now_us = deadline_us;
+}
+
+void (*host_wait)(uint64_t deadline_us) = wait_until;
+
+uint64_t host_real_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+uint64_t time_us_64(void) { return host_now_us; }
+uint32_t time_us_32(void) { return (uint32_t)host_now_us; }
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+  host_wait(timeout_timestamp);
+  return host_now_us >= timeout_timestamp;
+}
+
+void sleep_us(uint64_t us) { wait_until(host_now_us + us); }
+void sleep_ms(uint32_t ms) { wait_until(host_now_us + 1000ull * ms); }
+void busy_wait_us(uint64_t us) { wait_until(host_now_us + us); }
+
+uint32_t board_millis(void) { return (uint32_t)(host_now_us / 1000); }
+void board_init(void) {}
+
+uint32_t __rev(uint32_t bits)
+{
+  uint32_t out = 0;
+  for (int i = 0; i < 32; i++, bits >>= 1) out = (out << 1) | (bits & 1);
+  return out;
+}
+
+//--------------------------------------------------------------------+
+// clocks, stdio, boot
+//--------------------------------------------------------------------+
+static uint32_t sys_clock_hz = 125000000;
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required)
+{
+  sys_clock_hz = freq_khz * 1000;
+  return true;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) { return sys_clock_hz; }
+bool stdio_init_all(void) { return true; }
+
+void reset_usb_boot(uint32_t usb_activity_gpio_pin_mask, uint32_t disable_interface_mask)
+{
+  fprintf(stderr, "host: reset_usb_boot\n");
+  exit(1);
+}
+
+//--------------------------------------------------------------------+
+// cores and events
+//--------------------------------------------------------------------+
+void (*host_core1_entry)(void) = NULL;
+
+void multicore_launch_core1(void (*entry)(void)) { host_core1_entry = entry; }
+void multicore_lockout_victim_init(void) {}
+bool multicore_lockout_victim_is_initialized(uint core_num) { return true; }
+void multicore_lockout_start_blocking(void) {}
+void multicore_lockout_end_blocking(void) {}
+
+void __sev(void) {}
+void __wfe(void) {}
+uint32_t save_and_disable_interrupts(void) { return 0; }
+void restore_interrupts(uint32_t status) {}
+void irq_clear(uint num) {}
+
+static scb_hw_t scb;
+scb_hw_t* scb_hw = &scb;
+
+//--------------------------------------------------------------------+
+// gpio
+//--------------------------------------------------------------------+
+#define HOST_GPIOS 30
+
+static bool gpio_out[HOST_GPIOS];
+static bool gpio_in_set[HOST_GPIOS];
+static bool gpio_in[HOST_GPIOS];
+
+void gpio_init(uint gpio) {}
+void gpio_set_dir(uint gpio, bool out) {}
+void gpio_pull_up(uint gpio) {}
+void gpio_pull_down(uint gpio) {}
+void gpio_disable_pulls(uint gpio) {}
+void gpio_set_function(uint gpio, enum gpio_function fn) {}
+
+void gpio_put(uint gpio, bool value)
+{
+  if (gpio < HOST_GPIOS) gpio_out[gpio] = value;
+}
+
+bool gpio_get(uint gpio)
+{
+  if (gpio >= HOST_GPIOS) return false;
+  return gpio_in_set[gpio] ? gpio_in[gpio] : true;
+}
+
+void host_gpio_set_input(uint gpio, bool value)
+{
+  gpio_in_set[gpio] = true;
+  gpio_in[gpio] = value;
+}
+
+bool host_gpio_level(uint gpio)
+{
+  return gpio_out[gpio];
+}
+
+//--------------------------------------------------------------------+
+// flash, erased at power on
+//--------------------------------------------------------------------+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+uint32_t host_flash_erases = 0;
+uint32_t host_flash_programs = 0;
+
+__attribute__((constructor)) static void flash_power_on(void)
+{
+  memset(host_flash, 0xff, sizeof(host_flash));
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+  if (flash_offs % FLASH_SECTOR_SIZE || count % FLASH_SECTOR_SIZE || flash_offs + count > sizeof(host_flash))
+  {
+    fprintf(stderr, "host: bad flash erase %x+%zx\n", flash_offs, count);
+    abort();
+  }
+  memset(host_flash + flash_offs, 0xff, count);
+  host_flash_erases++;
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count)
+{
+  if (flash_offs % FLASH_PAGE_SIZE || count % FLASH_PAGE_SIZE || flash_offs + count > sizeof(host_flash))
+  {
+    fprintf(stderr, "host: bad flash program %x+%zx\n", flash_offs, count);
+    abort();
+  }
+  // programming only clears bits
+  for (size_t i = 0; i < count; i++) host_flash[flash_offs + i] &= data[i];
+  host_flash_programs++;
+}
+
+//--------------------------------------------------------------------+
+// pio
+//--------------------------------------------------------------------+
+#define FIFO_DEPTH 8
+
+typedef struct
+{
+  uint32_t words[FIFO_DEPTH];
+  uint8_t head;
+  uint8_t count;
+} fifo_t;
+
+typedef struct
+{
+  fifo_t tx;
+  fifo_t rx;
+  uint8_t tx_depth;
+  uint8_t rx_depth;
+  uint pc;
+  bool enabled;
+} sm_state_t;
+
+pio_hw_t host_pio[2];
+
+static uint pio_used[2];
+static uint8_t pio_claimed[2];
+static sm_state_t sms[2][NUM_PIO_STATE_MACHINES];
+
+static inline int pio_index(PIO pio)
+{
+  return pio == pio1;
+}
+
+static inline sm_state_t* sm_state(PIO pio, uint sm)
+{
+  return &sms[pio_index(pio)][sm];
+}
+
+static bool fifo_push(fifo_t* fifo, uint depth, uint32_t word)
+{
+  if (fifo->count >= depth) return false;
+  fifo->words[(fifo->head + fifo->count++) % FIFO_DEPTH] = word;
+  return true;
+}
+
+static bool fifo_pop(fifo_t* fifo, uint32_t* word)
+{
+  if (!fifo->count) return false;
+  *word = fifo->words[fifo->head];
+  fifo->head = (fifo->head + 1) % FIFO_DEPTH;
+  fifo->count--;
+  return true;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t* program)
+{
+  uint* used = &pio_used[pio_index(pio)];
+  if (*used + program->length > PIO_INSTRUCTION_COUNT)
+  {
+    // the sdk panics here too
+    fprintf(stderr, "host: no program space on pio%d (%u used, %u more)\n",
+      pio_index(pio), *used, program->length);
+    abort();
+  }
+
+  // the sdk fills from the top of instruction memory down
+  *used += program->length;
+  return PIO_INSTRUCTION_COUNT - *used;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required)
+{
+  uint8_t* claimed = &pio_claimed[pio_index(pio)];
+  for (int sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+  {
+    if (*claimed & (1u << sm)) continue;
+    *claimed |= 1u << sm;
+    return sm;
+  }
+
+  if (required)
+  {
+    fprintf(stderr, "host: no free state machine on pio%d\n", pio_index(pio));
+    abort();
+  }
+  return -1;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config)
+{
+  sm_state_t* state = sm_state(pio, sm);
+  *state = (sm_state_t){ 0 };
+  state->tx_depth = config->join == PIO_FIFO_JOIN_TX ? 8 : config->join == PIO_FIFO_JOIN_RX ? 0 : 4;
+  state->rx_depth = config->join == PIO_FIFO_JOIN_RX ? 8 : config->join == PIO_FIFO_JOIN_TX ? 0 : 4;
+  state->pc = initial_pc;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) { sm_state(pio, sm)->enabled = enabled; }
+void pio_sm_restart(PIO pio, uint sm) {}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr)
+{
+  // only unconditional jumps move the modelled program counter
+  if ((instr & 0xffe0) == 0x0000) sm_state(pio, sm)->pc = instr & 0x1f;
+}
+
+uint host_pio_used(PIO pio) { return pio_used[pio_index(pio)]; }
+uint host_pio_pc(PIO pio, uint sm) { return sm_state(pio, sm)->pc; }
+
+void pio_sm_clear_fifos(PIO pio, uint sm)
+{
+  sm_state_t* state = sm_state(pio, sm);
+  state->tx.count = 0;
+  state->rx.count = 0;
+}
+
+// a write to a full tx fifo is lost, as on hardware
+void pio_sm_put(PIO pio, uint sm, uint32_t data)
+{
+  sm_state_t* state = sm_state(pio, sm);
+  fifo_push(&state->tx, state->tx_depth, data);
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data)
+{
+  pio_sm_put(pio, sm, data);
+}
+
+uint32_t pio_sm_get(PIO pio, uint sm)
+{
+  uint32_t word = 0;
+  fifo_pop(&sm_state(pio, sm)->rx, &word);
+  return word;
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm)
+{
+  return pio_sm_get(pio, sm);
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) { return !sm_state(pio, sm)->rx.count; }
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm)
+{
+  sm_state_t* state = sm_state(pio, sm);
+  return state->tx.count >= state->tx_depth;
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx)
+{
+  return pio_index(pio) * 8 + sm + (is_tx ? 0 : 4);
+}
+
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled) {}
+
+bool host_pio_rx_push(PIO pio, uint sm, uint32_t word)
+{
+  sm_state_t* state = sm_state(pio, sm);
+  return fifo_push(&state->rx, state->rx_depth, word);
+}
+
+//--------------------------------------------------------------------+
+// dma, only into pio tx fifos
+//--------------------------------------------------------------------+
+#define DMA_CHANNELS 12
+
+typedef struct
+{
+  bool claimed;
+  PIO pio;
+  uint sm;
+  const uint32_t* read;
+  uint32_t remaining;
+} dma_state_t;
+
+static dma_state_t dmas[DMA_CHANNELS];
+
+// moves words while the target fifo has room
+static void dma_service(dma_state_t* dma)
+{
+  if (!dma->pio) return;
+  sm_state_t* state = sm_state(dma->pio, dma->sm);
+  while (dma->remaining && fifo_push(&state->tx, state->tx_depth, *dma->read))
+  {
+    dma->read++;
+    dma->remaining--;
+  }
+}
+
+int dma_claim_unused_channel(bool required)
+{
+  for (int ch = 0; ch < DMA_CHANNELS; ch++)
+  {
+    if (dmas[ch].claimed) continue;
+    dmas[ch].claimed = true;
+    return ch;
+  }
+
+  if (required) abort();
+  return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+  return (dma_channel_config){ 0 };
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger)
+{
+  dma_state_t* dma = &dmas[channel];
+  dma->pio = NULL;
+  for (int p = 0; p < 2; p++)
+  {
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+    {
+      if (write_addr == &host_pio[p].txf[sm])
+      {
+        dma->pio = &host_pio[p];
+        dma->sm = sm;
+      }
+    }
+  }
+  dma->read = (const uint32_t*)read_addr;
+  dma->remaining = trigger ? transfer_count : 0;
+  dma_service(dma);
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void* read_addr, uint32_t transfer_count)
+{
+  dma_state_t* dma = &dmas[channel];
+  dma->read = (const uint32_t*)read_addr;
+  dma->remaining = transfer_count;
+  dma_service(dma);
+}
+
+void dma_channel_abort(uint channel) { dmas[channel].remaining = 0; }
+bool dma_channel_is_busy(uint channel) { return dmas[channel].remaining != 0; }
+
+// nothing drains the fifo while the caller waits, the transfer stays queued
+void dma_channel_wait_for_finish_blocking(uint channel) {}
+
+bool host_pio_tx_pop(PIO pio, uint sm, uint32_t* word)
+{
+  if (!fifo_pop(&sm_state(pio, sm)->tx, word)) return false;
+
+  // a paced channel refills the slot just freed
+  for (int ch = 0; ch < DMA_CHANNELS; ch++)
+  {
+    if (dmas[ch].pio == pio && dmas[ch].sm == sm) dma_service(&dmas[ch]);
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// i2c
+//--------------------------------------------------------------------+
+i2c_inst_t host_i2c[2] = { { 0 }, { 1 } };
+
+uint i2c_init(i2c_inst_t* i2c, uint baudrate) { return baudrate; }
+
+int i2c_write_blocking(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t len, bool nostop)
+{
+  return (int)len;
+}
+
+size_t i2c_get_read_available(i2c_inst_t* i2c) { return 0; }
+void i2c_read_raw_blocking(i2c_inst_t* i2c, uint8_t* dst, size_t len) { memset(dst, 0, len); }
+void i2c_write_raw_blocking(i2c_inst_t* i2c, const uint8_t* src, size_t len) {}
+void i2c_slave_init(i2c_inst_t* i2c, uint8_t address, i2c_slave_handler_t handler) {}
+
+//--------------------------------------------------------------------+
+// joybus-pio GameCube console
+//--------------------------------------------------------------------+
+void GamecubeConsole_init(GamecubeConsole* console, uint pin, PIO pio, int sm, int offset)
+{
+  // joybus-pio is not vendored, so its program space is not accounted
+  pio_claim_unused_sm(pio ? pio : pio0, true);
+
+  console->mode = GamecubeMode_3;
+  console->report = default_gc_report;
+}
+
+bool GamecubeConsole_WaitForPoll(GamecubeConsole* console)
+{
+  return false;
+}
+
+void GamecubeConsole_SendReport(GamecubeConsole* console, gc_report_t* report)
+{
+  console->report = *report;
+}
+
+void GamecubeConsole_SetMode(GamecubeConsole* console, GamecubeMode mode)
+{
+  console->mode = mode;
+}
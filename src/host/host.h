@@ -0,0 +1,42 @@
+// host.h - runtime behind the pico-sdk shims (shim/) for host builds
+//
+// Time is virtual: it only moves when the firmware sleeps or waits for an
+// event, so a replay gives the same output on every machine. core0 runs the
+// firmware's main(); core1_entry is recorded by multicore_launch_core1 but
+// never started, tests drive console code directly instead.
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/pio.h"
+
+// virtual time (microseconds since boot)
+extern uint64_t host_now_us;
+
+// called by best_effort_wfe_or_timeout and sleeps, with the time the
+// firmware wants to wake up. advances host_now_us, to the deadline at most.
+extern void (*host_wait)(uint64_t deadline_us);
+
+// real elapsed time, for measurements
+uint64_t host_real_ns(void);
+
+// the recorded core1 entry point, NULL until launched
+extern void (*host_core1_entry)(void);
+
+// pio: program space used and the console side of the fifos
+uint host_pio_used(PIO pio);
+uint host_pio_pc(PIO pio, uint sm);
+bool host_pio_tx_pop(PIO pio, uint sm, uint32_t* word);
+bool host_pio_rx_push(PIO pio, uint sm, uint32_t word);
+
+// gpio levels read by the firmware (inputs read high unless set)
+void host_gpio_set_input(uint gpio, bool value);
+bool host_gpio_level(uint gpio);
+
+// flash erase/program counts since boot
+extern uint32_t host_flash_erases;
+extern uint32_t host_flash_programs;
+
+#endif // HOST_H
@@ -0,0 +1,195 @@
+// nuon_routing.c - host test of polyface packet routing between the emulated
+// Nuon controllers. Two player slots are enumerated the way the console does
+// (RESET, then PROBE and BRAND the pending device until none is left), and
+// every later packet must reach the device whose id it carries in data bits
+// PACKET_ID_SHIFT..+4. Packets without a branded id reach device 0, apart
+// from the PROBE and BRAND of enumeration: with id bits zero it keeps
+// answering its button and stick reads while the second device joins.
+// With one device left, every id must reach device 0.
+// Settings saved while the console polls must keep flash idle during every
+// packet of a frame's polling, not only the button read.
+
+#include <stdio.h>
+#include "host.h"
+#include "console/nuon/nuon.h"
+#include "players.h"
+#include "config.h"
+#include "flash_store.h"
+
+#define CMD_RESET   0xb1
+#define CMD_MAGIC   0x90
+#define CMD_PROBE   0x94
+#define CMD_SWITCH  0x30 // {SWITCH[8:1]}, the button word
+#define CMD_CHANNEL 0x34
+#define CMD_ANALOG  0x35
+#define CMD_QUAD_X  0x32
+#define CMD_BRAND   0xb4
+
+#define FRAME_US        16667 // console frame, 60 Hz
+#define PACKET_US       50    // packet spacing within a frame's polling
+#define CONFIG_TICK_US  1000  // config_task cadence on core0 (main.c)
+#define FLASH_FRAMES    600
+
+// dataA, dataS, dataC and type0 of the packets polling one device per frame
+static const uint8_t poll[][4] = {
+  { CMD_SWITCH,  0x02, 0x00,            1 },
+  { CMD_CHANNEL, 0x01, ATOD_CHANNEL_X1, 0 },
+  { CMD_ANALOG,  0x01, 0x00,            1 },
+  { CMD_CHANNEL, 0x01, ATOD_CHANNEL_Y1, 0 },
+  { CMD_ANALOG,  0x01, 0x00,            1 },
+  { CMD_QUAD_X,  0x02, 0x00,            1 },
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+  if (ok) return;
+  fprintf(stderr, "FAIL: %s\n", what);
+  failures++;
+}
+
+// data word as the read state machine pushes it
+static uint32_t packet(uint8_t id, uint8_t dataA, uint8_t dataS, uint8_t dataC, uint8_t type0)
+{
+  return ((uint32_t)(id & PACKET_ID_MASK) << PACKET_ID_SHIFT) |
+         ((uint32_t)(type0 & 1) << 25) |
+         ((uint32_t)dataA << 17) |
+         ((uint32_t)(dataS & 0x7f) << 9) |
+         ((uint32_t)(dataC & 0x7f) << 1);
+}
+
+// hands core1 one packet, returns true with the reply word if it answered
+static bool send(uint32_t word, uint32_t* reply)
+{
+  uint32_t stop;
+
+  host_pio_rx_push(pio, sm2, word);
+  polyface_task();
+
+  if (!host_pio_tx_pop(pio1, sm1, reply)) return false;
+  check(host_pio_tx_pop(pio1, sm1, &stop) && stop == 1, "reply without its stop word");
+  return true;
+}
+
+// PROBE reply of the device answering id: its own id, or -1 for no reply
+static int probe(uint8_t id, bool* branded)
+{
+  uint32_t reply;
+  if (!send(packet(id, CMD_PROBE, 0, 0, 1), &reply)) return -1;
+
+  uint32_t word1 = __rev(reply);
+  if (branded) *branded = (word1 >> 6) & 1;
+  return (word1 >> 1) & 0b00011111;
+}
+
+static uint32_t buttons(uint8_t id)
+{
+  uint32_t reply = 0;
+  send(packet(id, CMD_SWITCH, 0x02, 0x00, 1), &reply);
+  return reply;
+}
+
+static uint32_t analog_x1(uint8_t id)
+{
+  uint32_t reply = 0;
+  send(packet(id, CMD_CHANNEL, 0x01, ATOD_CHANNEL_X1, 0), &reply);
+  send(packet(id, CMD_ANALOG, 0x01, 0x00, 1), &reply);
+  return reply;
+}
+
+int main(void)
+{
+  bool branded;
+  uint32_t reply;
+
+  config_init();
+  nuon_init();
+  players_init();
+  add_player(1, 0);
+  add_player(2, 0);
+  players[0].output_buttons = 0x0280; // D-UP, with the bit every nuon button word carries
+  players[1].output_buttons = 0x4080;
+  players[0].output_analog_1x = 0x40;
+  players[1].output_analog_1x = 0xc0;
+  players_publish();
+
+  // enumeration: the pending device answers and takes each brand
+  send(packet(0, CMD_RESET, 0, 0, 0), &reply);
+  check(probe(0, &branded) == 0 && !branded, "first probe not from an unbranded device");
+  send(packet(0, CMD_BRAND, 0, 1, 0), &reply);
+  check(probe(0, &branded) == 0 && !branded, "second device not pending after the first brand");
+
+  // id bits zero while the second device is pending: polls are device 0's
+  check(buttons(0) == __rev(crc_data_packet(0x0280, 2)), "id 0 buttons not answered by device 0");
+  uint32_t root_x1 = analog_x1(0);
+  send(packet(0, CMD_BRAND, 0, 2, 0), &reply);
+  check(!send(packet(0, CMD_MAGIC, 0, 0, 1), &reply), "MAGIC answered with every device branded");
+
+  // each id reaches its own device
+  check(probe(1, &branded) == 1 && branded, "id 1 not answered by device 1");
+  check(probe(2, &branded) == 2 && branded, "id 2 not answered by device 2");
+  check(buttons(1) == __rev(crc_data_packet(0x0280, 2)), "id 1 buttons are not player 1's");
+  check(buttons(2) == __rev(crc_data_packet(0x4080, 2)), "id 2 buttons are not player 2's");
+  check(root_x1 == analog_x1(1) && root_x1 != analog_x1(2), "id 0 stick not answered by device 0");
+
+  // and with both branded
+  check(buttons(0) == __rev(crc_data_packet(0x0280, 2)), "id 0 buttons not answered by device 0");
+  check(analog_x1(0) == root_x1, "id 0 stick not answered by device 0");
+
+  // an unbranded id falls back to the root device
+  check(probe(5, NULL) == 1, "unknown id not answered by the root device");
+
+  // a frame polls both devices. a setting changes every 90 frames and
+  // core0 saves it when flash_store_window allows; each page program keeps
+  // flash busy for FLASH_STORE_PROGRAM_US, which no packet may fall into
+  uint32_t programs = host_flash_programs;
+  uint64_t busy_until_us = 0, config_us = host_now_us;
+  unsigned long saves = 0, overlaps = 0;
+  for (int f = 0; f < FLASH_FRAMES; f++)
+  {
+    uint64_t frame_us = host_now_us - host_now_us % FRAME_US + FRAME_US;
+    if (f % 90 == 0) config_set(CONFIG_KEY_TURBO, (f / 90) & 1);
+
+    int p = 0;
+    for (uint8_t id = 1; id <= 2; id++)
+    {
+      for (int i = 0; i < sizeof(poll) / sizeof(poll[0]); i++, p++)
+      {
+        uint64_t packet_us = frame_us + p * PACKET_US;
+        for (; config_us < packet_us; config_us += CONFIG_TICK_US)
+        {
+          host_now_us = config_us;
+          config_task();
+          if (host_flash_programs != programs)
+          {
+            programs = host_flash_programs;
+            saves++;
+            busy_until_us = host_now_us + FLASH_STORE_PROGRAM_US;
+          }
+        }
+
+        host_now_us = packet_us;
+        if (host_now_us < busy_until_us) overlaps++;
+        send(packet(id, poll[i][0], poll[i][1], poll[i][2], poll[i][3]), &reply);
+      }
+    }
+  }
+  check(saves > 0, "no setting saved while polled");
+  if (overlaps)
+  {
+    fprintf(stderr, "%lu packets while flash was busy\n", overlaps);
+    check(false, "flash busy during a packet");
+  }
+
+  // one device left: whatever the id bits hold, device 0 answers
+  remove_players_by_address(2, -1);
+  players_publish();
+  for (int id = 0; id <= PACKET_ID_MASK; id++)
+  {
+    if (probe(id, NULL) != 1) { check(false, "single device missed a packet"); break; }
+  }
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+// pce_scan.c - host test of the PC Engine frame table (core1). The console's
+// scans are played through the clock program's fifo into scan_task, and the
+// words plex pulls are read back from its tx fifo, which the frame dma fills.
+// A player frame published while a frame is being scanned must not reach
+// that frame, even before core1 has seen its first scan: the table is only
+// rearmed at the frame end. Scans past the four nybble states keep reading
+// state 0 from the table, up to SCAN_MAX. Turbo II held toggles every
+// TURBO_FRAMES_SLOW or TURBO_FRAMES_FAST frames.
+
+#include <stdio.h>
+#include "host.h"
+#include "console/pcengine/pcengine.h"
+#include "players.h"
+
+// clock program events (pcengine.c)
+#define CLOCK_FRAME_END 0
+#define CLOCK_SCAN      1
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+  if (ok) return;
+  fprintf(stderr, "FAIL: %s\n", what);
+  failures++;
+}
+
+// no scan for the reset period: the frame is over
+static void frame_end(void)
+{
+  host_pio_rx_push(pio, sm2, CLOCK_FRAME_END);
+  scan_task();
+}
+
+// plex pulls the pair of a scan at CLR high, then the clock program reports
+// the scan. returns false if plex had nothing to pull
+static bool scan(uint32_t pair[2])
+{
+  bool queued = host_pio_tx_pop(pio, sm1, &pair[0]) && host_pio_tx_pop(pio, sm1, &pair[1]);
+  host_pio_rx_push(pio, sm2, CLOCK_SCAN);
+  scan_task();
+  return queued;
+}
+
+// frames between the turbo toggles of player 1's II over a number of
+// frames: 0 without a toggle, -1 if they are not evenly spaced
+static int turbo_period(int frames)
+{
+  uint32_t pair[2];
+  int period = 0, last = -1;
+  bool pressed = false;
+
+  for (int f = 0; f < frames; f++)
+  {
+    frame_end();
+    scan(pair);
+    for (int i = 1; i < SCAN_STATES; i++) scan(pair);
+
+    bool now = !(pair[1] & 0x20);
+    if (f && now != pressed)
+    {
+      if (last >= 0 && period && f - last != period) return -1;
+      if (last >= 0) period = f - last;
+      last = f;
+    }
+    pressed = now;
+  }
+  return period;
+}
+
+int main(void)
+{
+  uint32_t ref[SCAN_STATES][2], pair[2];
+
+  pce_init();
+  players_init();
+  add_player(1, 0);
+  players[0].output_buttons = 0xfffe; // I
+  players_publish();
+
+  // the frame before the first frame end reads no buttons
+  check(scan(pair) && pair[1] == 0xffffffff, "first frame not idle");
+  for (int i = 1; i < SCAN_STATES; i++) scan(pair);
+
+  frame_end();
+  for (int i = 0; i < SCAN_STATES; i++) check(scan(ref[i]), "scan without a queued pair");
+  check((ref[0][1] & 0xff) == 0xfe, "player 1 byte not in the frame");
+
+  // a new player frame lands as the next frame's first scan starts, before
+  // core1 has seen that scan
+  frame_end();
+  players[0].output_buttons = 0xfffd; // II
+  players_publish();
+  for (int i = 0; i < SCAN_STATES; i++)
+  {
+    check(scan(pair) && pair[0] == ref[i][0] && pair[1] == ref[i][1], "frame rearmed while scanned");
+  }
+
+  // and is read from the next frame on
+  frame_end();
+  check(scan(pair) && (pair[1] & 0xff) == 0xfd, "new player frame not latched at the frame end");
+  for (int i = 1; i < SCAN_STATES; i++) scan(pair);
+
+  // a frame with more scans than nybble states
+  uint32_t last[2] = { pair[0], pair[1] };
+  for (int i = SCAN_STATES; i < SCAN_MAX; i++)
+  {
+    check(scan(pair) && pair[0] == last[0] && pair[1] == last[1], "extra scan not state 0");
+  }
+  check(!scan(pair), "table longer than SCAN_MAX");
+  frame_end();
+  check(scan(pair) && (pair[1] & 0xff) == 0xfd, "frame end after extra scans not rearmed");
+  for (int i = 1; i < SCAN_STATES; i++) scan(pair);
+
+  // turbo II (X) held, at the speed turbo_init restored, then the fast one
+  players[0].output_buttons = 0xdfff;
+  players_publish();
+  turbo_period(4);
+  check(turbo_period(60) == TURBO_FRAMES_SLOW, "slow turbo period");
+  timer_threshold = timer_threshold_b;
+  players_publish();
+  turbo_period(4);
+  check(turbo_period(60) == TURBO_FRAMES_FAST, "fast turbo period");
+
+  printf("%s\n", failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+// piogen.c - builds <name>.pio.h for the host from a .pio source
+//
+// Stands in for pioasm: programs keep their real length, wrap, public labels
+// and defines, and the c-sdk init block is copied as is, but instructions are
+// not encoded since the host never executes them. Program length is what
+// pio_add_program checks against the 32 instruction memory.
+//
+// usage: piogen <in.pio> <out.pio.h>
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+  char name[64];
+  int length;
+  int wrap_target;
+  int wrap;
+} program_t;
+
+static char* trim(char* s)
+{
+  while (isspace((unsigned char)*s)) s++;
+  char* end = s + strlen(s);
+  while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+  return s;
+}
+
+static void strip_comment(char* s)
+{
+  char* c = strchr(s, ';');
+  if (c) *c = '\0';
+  c = strstr(s, "//");
+  if (c) *c = '\0';
+}
+
+static void program_end(FILE* out, program_t* p)
+{
+  if (!p->name[0]) return;
+  if (p->wrap < 0) p->wrap = p->length - 1;
+
+  fprintf(out, "#define %s_wrap_target %d\n", p->name, p->wrap_target);
+  fprintf(out, "#define %s_wrap %d\n\n", p->name, p->wrap);
+  fprintf(out, "static const uint16_t %s_program_instructions[%d] = { 0 };\n\n", p->name, p->length);
+  fprintf(out, "static const struct pio_program %s_program = {\n", p->name);
+  fprintf(out, "  .instructions = %s_program_instructions,\n", p->name);
+  fprintf(out, "  .length = %d,\n", p->length);
+  fprintf(out, "  .origin = -1,\n};\n\n");
+  fprintf(out, "static inline pio_sm_config %s_program_get_default_config(uint offset)\n{\n", p->name);
+  fprintf(out, "  pio_sm_config c = pio_get_default_sm_config();\n");
+  fprintf(out, "  sm_config_set_wrap(&c, offset + %s_wrap_target, offset + %s_wrap);\n", p->name, p->name);
+  fprintf(out, "  return c;\n}\n\n");
+  p->name[0] = '\0';
+}
+
+int main(int argc, char** argv)
+{
+  if (argc != 3)
+  {
+    fprintf(stderr, "usage: piogen <in.pio> <out.pio.h>\n");
+    return 2;
+  }
+
+  FILE* in = fopen(argv[1], "r");
+  FILE* out = fopen(argv[2], "w");
+  if (!in || !out)
+  {
+    perror("piogen");
+    return 1;
+  }
+
+  fprintf(out, "// generated by piogen from %s, do not edit\n\n", argv[1]);
+  fprintf(out, "#pragma once\n\n#include \"hardware/pio.h\"\n\n");
+
+  program_t program = { .name = "" };
+  int in_block = 0;
+  int copy_block = 0;
+  char line[512];
+
+  while (fgets(line, sizeof(line), in))
+  {
+    if (in_block)
+    {
+      char* s = line;
+      while (isspace((unsigned char)*s)) s++;
+      if (strncmp(s, "%}", 2) == 0)
+      {
+        in_block = 0;
+        if (copy_block) fputs("\n", out);
+        continue;
+      }
+      if (copy_block) fputs(line, out);
+      continue;
+    }
+
+    char* s = line;
+    strip_comment(s);
+    s = trim(s);
+    if (!*s) continue;
+
+    if (s[0] == '%')
+    {
+      in_block = 1;
+      copy_block = strstr(s, "c-sdk") != NULL;
+      if (copy_block) program_end(out, &program);
+      continue;
+    }
+
+    if (s[0] == '.')
+    {
+      char directive[32], arg1[64], arg2[64], arg3[64];
+      int n = sscanf(s, "%31s %63s %63s %63s", directive, arg1, arg2, arg3);
+
+      if (!strcmp(directive, ".program") && n >= 2)
+      {
+        program_end(out, &program);
+        program = (program_t){ .wrap_target = 0, .wrap = -1 };
+        snprintf(program.name, sizeof(program.name), "%s", arg1);
+      }
+      else if (!strcmp(directive, ".define") && n == 4 && !strcmp(arg1, "public"))
+      {
+        if (program.name[0]) fprintf(out, "#define %s_%s %s\n", program.name, arg2, arg3);
+        else fprintf(out, "#define %s %s\n", arg2, arg3);
+      }
+      else if (!strcmp(directive, ".wrap_target"))
+      {
+        program.wrap_target = program.length;
+      }
+      else if (!strcmp(directive, ".wrap"))
+      {
+        program.wrap = program.length - 1;
+      }
+      continue;
+    }
+
+    // labels, "public" ones are exported as offsets
+    char* colon = strchr(s, ':');
+    if (colon)
+    {
+      *colon = '\0';
+      char* label = trim(s);
+      if (!strncmp(label, "public ", 7))
+      {
+        fprintf(out, "#define %s_offset_%s %du\n", program.name, trim(label + 7), program.length);
+      }
+      s = trim(colon + 1);
+      if (!*s) continue;
+    }
+
+    program.length++;
+  }
+
+  program_end(out, &program);
+
+  fclose(in);
+  return fclose(out) ? 1 : 0;
+}
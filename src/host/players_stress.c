@@ -0,0 +1,162 @@
+// players_stress.c - host stress test of the core0 -> core1 player frame
+// handoff. A writer thread stamps every player field with one counter value
+// and publishes at a varying pace, while a reader thread takes snapshots
+// and fails on any frame that mixes two stamps (a torn frame) or goes back
+// in sequence.
+//
+// usage: players_stress [publishes]
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "players.h"
+
+#define STRESS_PUBLISHES 1000000
+#define STRESS_MIN_SNAPSHOTS 1000
+#define STRESS_PAUSE 512 // longest pause between publishes, in spins
+#define STRESS_YIELD 64  // one publish in this many yields the cpu
+
+// provided by the console build
+#ifdef CONFIG_PCE
+uint32_t timer_threshold;
+#endif
+#ifdef CONFIG_NGC
+gc_report_t gc_report;
+#endif
+void update_output(void) {}
+
+static uint32_t publishes = STRESS_PUBLISHES;
+static volatile bool writer_done = false;
+
+// every field of player i in frame k
+static void stamp(int i, uint32_t k)
+{
+  Player_t* player = &players[i];
+  player->dev_addr = 1 + (k + i) % 250;
+  player->input_us = k;
+  player->output_buttons = (int32_t)(k ^ (i << 24));
+  player->output_analog_1x = (int16_t)(k + i);
+  player->output_analog_1y = (int16_t)(k + i + 1);
+  player->output_analog_2x = (int16_t)(k + i + 2);
+  player->output_analog_2y = (int16_t)(k + i + 3);
+  player->output_analog_l = (int16_t)(k + i + 4);
+  player->output_analog_r = (int16_t)(k + i + 5);
+  player->global_x = (int16_t)(k - i);
+  player->global_y = (int16_t)(k + 2 * i);
+  player->keypress[0] = k;
+  player->keypress[1] = k >> 8;
+  player->keypress[2] = k >> 16;
+  player->button_mode = k & 3;
+  player->is_mouse = k & 1;
+}
+
+static bool stamped(player_output_t const* out, int i, uint32_t k)
+{
+  return out->dev_addr == (uint8_t)(1 + (k + i) % 250) &&
+    out->output_buttons == (int32_t)(k ^ (i << 24)) &&
+    out->output_analog_1x == (int16_t)(k + i) &&
+    out->output_analog_1y == (int16_t)(k + i + 1) &&
+    out->output_analog_2x == (int16_t)(k + i + 2) &&
+    out->output_analog_2y == (int16_t)(k + i + 3) &&
+    out->output_analog_l == (int16_t)(k + i + 4) &&
+    out->output_analog_r == (int16_t)(k + i + 5) &&
+    out->global_x == (int16_t)(k - i) &&
+    out->global_y == (int16_t)(k + 2 * i) &&
+    out->keypress[0] == (uint8_t)k &&
+    out->keypress[1] == (uint8_t)(k >> 8) &&
+    out->keypress[2] == (uint8_t)(k >> 16) &&
+    out->button_mode == (int)(k & 3) &&
+    out->is_mouse == (bool)(k & 1);
+}
+
+// core0: stamp, publish, then pause a little. the pauses vary so copies
+// both overlap a publish and land cleanly between two, and now and then
+// hand the cpu over so the reader also runs on a single core host.
+static void* writer(void* arg)
+{
+  uint32_t random = 0x2545f491;
+
+  for (uint32_t k = 1; k <= publishes; k++)
+  {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    for (volatile uint32_t spin = random % STRESS_PAUSE; spin; spin--);
+    if (random % STRESS_YIELD == 0) sched_yield();
+
+    for (int i = 0; i < MAX_PLAYERS; i++) stamp(i, k);
+#ifdef CONFIG_PCE
+    timer_threshold = k;
+#endif
+    players_publish();
+  }
+
+  writer_done = true;
+  return NULL;
+}
+
+// core1: snapshot and check, until the writer is done
+static void* reader(void* arg)
+{
+  static players_frame_t frame;
+  unsigned long snapshots = 0, torn = 0;
+  uint32_t last_seq = frame.seq;
+
+  while (!writer_done)
+  {
+    if (!players_snapshot(&frame))
+    {
+      sched_yield();
+      continue;
+    }
+
+    // players_init's frame carries no stamp
+    if (frame.seq == 1) continue;
+    snapshots++;
+
+    // the stamp is the publish count after the one players_init made
+    uint32_t k = frame.players[0].input_us;
+    bool ok = frame.seq > last_seq && frame.seq == k + 1;
+    for (int i = 0; i < MAX_PLAYERS; i++)
+    {
+      ok = ok && frame.players[i].input_us == k && stamped(&frame.players[i], i, k);
+    }
+#ifdef CONFIG_PCE
+    ok = ok && frame.turbo_threshold == k;
+#endif
+
+    if (!ok && torn++ < 10)
+    {
+      fprintf(stderr, "torn frame: seq %lu after %lu, stamp %lu\n",
+        (unsigned long)frame.seq, (unsigned long)last_seq, (unsigned long)k);
+    }
+    last_seq = frame.seq;
+  }
+
+  printf("%lu publishes, %lu snapshots, %lu torn\n", (unsigned long)publishes, snapshots, torn);
+  return (void*)(uintptr_t)(torn == 0 && snapshots >= STRESS_MIN_SNAPSHOTS);
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1) publishes = strtoul(argv[1], NULL, 0);
+
+  // copies only overlap publishes when both threads really run at once
+  if (sysconf(_SC_NPROCESSORS_ONLN) < 2)
+  {
+    printf("one cpu: only interleavings at yields are covered, not concurrent copies\n");
+  }
+
+  players_init();
+
+  pthread_t core0, core1;
+  void* passed;
+  pthread_create(&core1, NULL, reader, NULL);
+  pthread_create(&core0, NULL, writer, NULL);
+  pthread_join(core0, NULL);
+  pthread_join(core1, &passed);
+
+  return passed ? 0 : 1;
+}
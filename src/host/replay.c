@@ -0,0 +1,729 @@
+// replay.c - replays a report trace through the firmware's usb callbacks
+//
+// usage: replay_<console> <capture> [-q] [-s] [-t <boot_us>]
+//
+// The capture uses the REPORT_TRACE format (common/trace.h): M and d lines
+// mount an interface with its report descriptor, R lines deliver a report
+// and U lines unmount a device. Lines of any other kind (F, D, firmware
+// chatter) are ignored, so a serial log can be replayed as captured.
+//
+// The firmware's main() runs on virtual time: each event is delivered by
+// tuh_task() once the firmware's loop reaches its timestamp. The firmware
+// traces what it did to stdout; the replay's own summary goes to stderr:
+// reports per second and time per report for each driver, measured in real
+// time around the report callback. -q leaves the summary out. -t starts the
+// clock at boot_us instead of 0, to run the firmware past timer wraps.
+//
+// -s prints S lines: the player state the console side reads, after every
+// main loop pass that changed it, numbered by the capture events delivered
+// so far. They only use fields the baseline tree (93ae4da) already had, so
+// the same replay of the baseline (REPLAY_BASELINE, built without trace
+// hooks) gives the reference output of every later tree.
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "tusb.h"
+#include "xinput_host.h"
+#include "devices/device_registry.h"
+#include "players.h"
+
+extern int usbretro_main(void);
+#ifdef CONFIG_NGC
+extern gc_report_t gc_report;
+#endif
+
+// let the firmware settle after the last event before stopping
+#define REPLAY_TAIL_US 100000
+
+// a main loop pass that never waits is a hang in the firmware
+#define REPLAY_SPIN_MAX 1000000
+
+// the baseline's main loop never waits, each pass moves time this far
+#ifndef REPLAY_BASELINE_PASS_US
+#define REPLAY_BASELINE_PASS_US 1000
+#endif
+
+// players_root() came with stable slots: since then a removed player is
+// cleared in place and single-port consoles output the lowest occupied
+// slot. before, players were packed below playersCount
+int players_root(void) __attribute__((weak));
+
+typedef struct
+{
+  char kind; // M, R or U
+  char source; // H = hid, X = xinput
+  uint8_t dev_addr;
+  uint8_t instance;
+  uint64_t time_us;
+  uint16_t vid;
+  uint16_t pid;
+  uint8_t protocol;
+  uint16_t len; // report or descriptor bytes
+  uint8_t* bytes;
+} replay_event_t;
+
+typedef struct
+{
+  bool mounted;
+  char source;
+  uint8_t protocol;
+  uint16_t desc_len;
+  uint8_t* desc;
+} replay_itf_t;
+
+typedef struct
+{
+  uint16_t vid;
+  uint16_t pid;
+  uint8_t itf_count;
+  replay_itf_t itfs[CFG_TUH_HID];
+} replay_device_t;
+
+static replay_event_t* events = NULL;
+static size_t event_count = 0;
+static size_t event_next = 0;
+
+static replay_device_t devices[CFG_TUH_DEVICE_MAX + 1];
+
+// transfers completed on the next tuh_task, like tinyusb's event queue
+typedef struct
+{
+  bool desc; // report descriptor fetch, else a SET_REPORT
+  uint8_t dev_addr;
+  uint8_t instance;
+  uint8_t report_id;
+  uint8_t report_type;
+  uint16_t len;
+  tuh_xfer_t xfer;
+} replay_xfer_t;
+
+#define REPLAY_XFERS 8
+static replay_xfer_t xfers[REPLAY_XFERS];
+static int xfer_count = 0;
+
+static jmp_buf replay_done;
+static uint32_t spins = 0;
+
+static void replay_wait(uint64_t deadline_us);
+
+// main loop passes, each from tuh_task to the wait that ends it
+static uint64_t pass_start_ns = 0;
+static uint64_t pass_total_ns = 0;
+static uint64_t pass_count = 0;
+
+//--------------------------------------------------------------------+
+// driver timing
+//--------------------------------------------------------------------+
+typedef struct
+{
+  const char* name;
+  uint32_t reports;
+  uint64_t total_ns;
+  uint64_t max_ns;
+} driver_stats_t;
+
+#define REPLAY_DRIVERS (CONTROLLER_TYPE_COUNT + 4)
+static driver_stats_t drivers[REPLAY_DRIVERS];
+
+// dev_type the firmware traced for the report being timed
+static int traced_dev_type;
+static bool traced;
+
+#ifndef REPLAY_BASELINE
+// the firmware's own trace_report, wrapped at link time (--wrap)
+void __real_trace_report(char source, int dev_type, uint8_t dev_addr, uint8_t instance,
+  uint8_t const* report, uint16_t len, uint32_t elapsed_us);
+
+void __wrap_trace_report(char source, int dev_type, uint8_t dev_addr, uint8_t instance,
+  uint8_t const* report, uint16_t len, uint32_t elapsed_us)
+{
+  traced_dev_type = dev_type;
+  traced = true;
+  __real_trace_report(source, dev_type, dev_addr, instance, report, len, elapsed_us);
+}
+#endif
+
+static void driver_record(replay_event_t const* event, uint64_t ns)
+{
+  const char* name;
+  if (event->source == 'X') name = "xinput";
+  else if (!traced) name = "unclassified";
+  else if (traced_dev_type >= 0 && traced_dev_type < CONTROLLER_TYPE_COUNT) name = device_interfaces[traced_dev_type]->name;
+  else if (event->protocol == HID_ITF_PROTOCOL_KEYBOARD) name = "boot keyboard";
+  else if (event->protocol == HID_ITF_PROTOCOL_MOUSE) name = "boot mouse";
+  else name = "generic";
+
+  for (int i = 0; i < REPLAY_DRIVERS; i++)
+  {
+    driver_stats_t* stats = &drivers[i];
+    if (stats->name && strcmp(stats->name, name)) continue;
+
+    stats->name = name;
+    stats->reports++;
+    stats->total_ns += ns;
+    if (ns > stats->max_ns) stats->max_ns = ns;
+    return;
+  }
+}
+
+static void driver_summary(void)
+{
+  fprintf(stderr, "%-20s %8s %12s %10s %10s\n", "driver", "reports", "reports/s", "us/report", "max us");
+  for (int i = 0; i < REPLAY_DRIVERS && drivers[i].name; i++)
+  {
+    driver_stats_t const* stats = &drivers[i];
+    double us = stats->total_ns / 1000.0 / stats->reports;
+    fprintf(stderr, "%-20s %8lu %12.0f %10.3f %10.3f\n", stats->name, (unsigned long)stats->reports,
+      us > 0 ? 1e6 / us : 0, us, stats->max_ns / 1000.0);
+  }
+  fprintf(stderr, "flash: %lu sector erases, %lu page programs\n",
+    (unsigned long)host_flash_erases, (unsigned long)host_flash_programs);
+  if (pass_count)
+  {
+    fprintf(stderr, "main loop: %lu passes, %.3f us/pass\n", (unsigned long)pass_count,
+      pass_total_ns / 1000.0 / pass_count);
+  }
+}
+
+static void pass_end(void)
+{
+  if (!pass_start_ns) return;
+  pass_total_ns += host_real_ns() - pass_start_ns;
+  pass_count++;
+  pass_start_ns = 0;
+}
+
+//--------------------------------------------------------------------+
+// player state
+//--------------------------------------------------------------------+
+#define STATE_LINE 512
+
+static bool state_lines = false;
+static char state_last[STATE_LINE];
+
+// prints an S line if the passes since the last one changed the state
+static void state_print(void)
+{
+  char line[STATE_LINE];
+  int n = snprintf(line, sizeof(line), "%d", playersCount);
+
+#ifdef CONFIG_PCE
+  // every multitap slot: buttons as the plex encoder reads them, mouse
+  // motion not yet sent
+  for (int i = 0; i < MAX_PLAYERS; i++)
+  {
+    Player_t const* player = &players[i];
+    if (players_root ? !player->dev_addr : i >= playersCount)
+    {
+      n += snprintf(line + n, sizeof(line) - n, " [-]");
+      continue;
+    }
+    n += snprintf(line + n, sizeof(line) - n, " [%04lx %d %d %d]",
+      (unsigned long)(player->output_buttons & 0xffff),
+      player->global_x, player->global_y, player->button_mode);
+  }
+#elif defined(CONFIG_NGC)
+  // the joybus report itself
+  n += snprintf(line + n, sizeof(line) - n, " gc");
+  for (size_t i = 0; i < sizeof(gc_report); i++)
+  {
+    n += snprintf(line + n, sizeof(line) - n, " %02x", ((uint8_t const*)&gc_report)[i]);
+  }
+#else
+  // the one player a single-port console outputs
+  Player_t const* player = &players[players_root ? players_root() : 0];
+  if (!playersCount)
+  {
+    n += snprintf(line + n, sizeof(line) - n, " [-]");
+  }
+  else
+  {
+#ifdef CONFIG_NUON
+    // the words SWITCH, ANALOG and QUADX replies are built from
+    n += snprintf(line + n, sizeof(line) - n, " [%04lx %d %d %d %d %d]",
+      (unsigned long)((player->output_buttons | player->output_buttons_alt) & 0xffff),
+      player->output_analog_1x, player->output_analog_1y,
+      player->output_analog_2x, player->output_analog_2y,
+      player->output_quad_x);
+#else
+    // the buttons and axes driven onto the controller board
+    n += snprintf(line + n, sizeof(line) - n, " [%05lx %d %d %d %d %d %d]",
+      (unsigned long)(player->output_buttons & 0x3ffff),
+      player->output_analog_1x, player->output_analog_1y,
+      player->output_analog_2x, player->output_analog_2y,
+      player->output_analog_l, player->output_analog_r);
+#endif
+  }
+#endif
+
+  if (!strcmp(line, state_last)) return;
+  strcpy(state_last, line);
+  printf("S %lu %s\n", (unsigned long)event_next, line);
+}
+
+//--------------------------------------------------------------------+
+// capture
+//--------------------------------------------------------------------+
+static replay_event_t* event_add(void)
+{
+  static size_t capacity = 0;
+  if (event_count == capacity)
+  {
+    capacity = capacity ? capacity * 2 : 256;
+    events = realloc(events, capacity * sizeof(*events));
+    if (!events) abort();
+  }
+  replay_event_t* event = &events[event_count++];
+  memset(event, 0, sizeof(*event));
+  return event;
+}
+
+// reads hex bytes from the rest of a line, returns the count
+static uint16_t parse_bytes(char* s, uint8_t* out, uint16_t max)
+{
+  uint16_t len = 0;
+  char* end;
+  for (unsigned long value = strtoul(s, &end, 16); end != s && len < max; value = strtoul(s, &end, 16))
+  {
+    out[len++] = (uint8_t)value;
+    s = end;
+  }
+  return len;
+}
+
+static bool load_capture(const char* path)
+{
+  FILE* file = fopen(path, "r");
+  if (!file)
+  {
+    perror(path);
+    return false;
+  }
+
+  char line[1024];
+  int line_no = 0;
+  replay_event_t* mount = NULL; // receiving descriptor chunks
+  uint16_t desc_got = 0;
+
+  while (fgets(line, sizeof(line), file))
+  {
+    line_no++;
+    unsigned long time_us;
+    unsigned dev, inst, vid, pid, protocol, len, elapsed;
+    char source;
+    int dev_type, used = 0;
+
+    // a descriptor's chunks all come before the next record
+    if (mount && desc_got < mount->len && strchr("MRU", line[0]))
+    {
+      fprintf(stderr, "%s:%d: descriptor of %u/%u incomplete (%u of %u bytes)\n", path, line_no,
+        mount->dev_addr, mount->instance, desc_got, mount->len);
+      return false;
+    }
+
+    if (sscanf(line, "M %lu %c %u %u %x %x %u %u", &time_us, &source, &dev, &inst, &vid, &pid, &protocol, &len) == 8)
+    {
+      mount = event_add();
+      *mount = (replay_event_t){ 'M', source, dev, inst, time_us, vid, pid, protocol, len, NULL };
+      mount->bytes = len ? malloc(len) : NULL;
+      desc_got = 0;
+    }
+    else if (sscanf(line, "d %lu %u %u %n", &time_us, &dev, &inst, &used) == 3 && used)
+    {
+      if (!mount || mount->dev_addr != dev || mount->instance != inst)
+      {
+        fprintf(stderr, "%s:%d: descriptor chunk without its mount\n", path, line_no);
+        return false;
+      }
+      desc_got += parse_bytes(line + used, mount->bytes + desc_got, mount->len - desc_got);
+    }
+    else if (sscanf(line, "R %lu %c %d %u %u %u %n", &time_us, &source, &dev_type, &dev, &inst, &elapsed, &used) == 6 && used)
+    {
+      replay_event_t* event = event_add();
+      *event = (replay_event_t){ 'R', source, dev, inst, time_us };
+      event->bytes = malloc(CFG_TUH_HID_EPIN_BUFSIZE);
+      event->len = parse_bytes(line + used, event->bytes, CFG_TUH_HID_EPIN_BUFSIZE);
+    }
+    else if (sscanf(line, "U %lu %u", &time_us, &dev) == 2)
+    {
+      replay_event_t* event = event_add();
+      *event = (replay_event_t){ 'U', 0, dev, 0, time_us };
+    }
+    else
+    {
+      continue;
+    }
+
+    replay_event_t const* last = &events[event_count - 1];
+    if (last->dev_addr == 0 || last->dev_addr > CFG_TUH_DEVICE_MAX || last->instance >= CFG_TUH_HID)
+    {
+      fprintf(stderr, "%s:%d: device %u/%u out of range\n", path, line_no, last->dev_addr, last->instance);
+      return false;
+    }
+    if (event_count > 1 && last->time_us < events[event_count - 2].time_us)
+    {
+      fprintf(stderr, "%s:%d: time goes backwards\n", path, line_no);
+      return false;
+    }
+  }
+
+  fclose(file);
+
+  if (mount && desc_got < mount->len)
+  {
+    fprintf(stderr, "%s: descriptor of %u/%u incomplete at end of capture\n", path, mount->dev_addr, mount->instance);
+    return false;
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// usb host
+//--------------------------------------------------------------------+
+static void deliver_mount(replay_event_t const* event)
+{
+  replay_device_t* device = &devices[event->dev_addr];
+  replay_itf_t* itf = &device->itfs[event->instance];
+
+  if (!device->itf_count)
+  {
+    device->vid = event->vid;
+    device->pid = event->pid;
+    tuh_mount_cb(event->dev_addr);
+  }
+  device->itf_count++;
+
+  *itf = (replay_itf_t){ true, event->source, event->protocol, event->len, event->bytes };
+
+  if (event->source == 'X')
+  {
+    xinputh_interface_t xinput = { .type = event->protocol, .connected = true };
+    tuh_xinput_mount_cb(event->dev_addr, event->instance, &xinput);
+    return;
+  }
+
+  // tinyusb skips descriptors larger than its enumeration buffer
+  if (event->len > CFG_TUH_ENUMERATION_BUFSIZE) tuh_hid_mount_cb(event->dev_addr, event->instance, NULL, 0);
+  else tuh_hid_mount_cb(event->dev_addr, event->instance, event->bytes, event->len);
+}
+
+static void deliver_report(replay_event_t* event)
+{
+  replay_itf_t const* itf = &devices[event->dev_addr].itfs[event->instance];
+  if (!itf->mounted) return;
+
+  event->protocol = itf->protocol;
+  traced = false;
+
+  uint64_t start_ns;
+  if (itf->source == 'X')
+  {
+    xinputh_interface_t xinput = { .type = itf->protocol, .connected = true, .new_pad_data = true };
+    memcpy(&xinput.pad, event->bytes, TU_MIN(event->len, sizeof(xinput.pad)));
+    start_ns = host_real_ns();
+    tuh_xinput_report_received_cb(event->dev_addr, event->instance, (uint8_t const*)&xinput, sizeof(xinput));
+  }
+  else
+  {
+    start_ns = host_real_ns();
+    tuh_hid_report_received_cb(event->dev_addr, event->instance, event->bytes, event->len);
+  }
+
+  driver_record(event, host_real_ns() - start_ns);
+}
+
+static void deliver_unmount(replay_event_t const* event)
+{
+  replay_device_t* device = &devices[event->dev_addr];
+  if (!device->itf_count) return;
+
+  for (uint8_t i = 0; i < CFG_TUH_HID; i++)
+  {
+    replay_itf_t* itf = &device->itfs[i];
+    if (!itf->mounted) continue;
+
+    if (itf->source == 'X') tuh_xinput_umount_cb(event->dev_addr, i);
+    else tuh_hid_umount_cb(event->dev_addr, i);
+    itf->mounted = false;
+  }
+
+  // transfers in flight die with the device
+  for (int i = 0; i < xfer_count; i++)
+  {
+    if (xfers[i].dev_addr == event->dev_addr) xfers[i--] = xfers[--xfer_count];
+  }
+
+  tuh_umount_cb(event->dev_addr);
+  *device = (replay_device_t){ 0 };
+}
+
+bool tusb_init(void)
+{
+  return true;
+}
+
+void tuh_task(void)
+{
+  // nothing enumerates before the host stack first runs, so a console
+  // with a longer start-up pause (xb1) sees the capture start later
+  static bool started = false;
+  if (!started && event_count && events[0].time_us < host_now_us)
+  {
+    uint64_t late_us = host_now_us - events[0].time_us;
+    for (int i = 0; i < event_count; i++) events[i].time_us += late_us;
+  }
+  started = true;
+
+  pass_end();
+  if (state_lines) state_print();
+#ifdef REPLAY_BASELINE
+  replay_wait(host_now_us + REPLAY_BASELINE_PASS_US);
+#endif
+  pass_start_ns = host_real_ns();
+
+  // completions queued by the previous pass
+  int count = xfer_count;
+  replay_xfer_t done[REPLAY_XFERS];
+  memcpy(done, xfers, count * sizeof(done[0]));
+  xfer_count = 0;
+
+  for (int i = 0; i < count; i++)
+  {
+    replay_xfer_t* xfer = &done[i];
+    if (xfer->desc) xfer->xfer.complete_cb(&xfer->xfer);
+    else if (tuh_hid_set_report_complete_cb) tuh_hid_set_report_complete_cb(xfer->dev_addr, xfer->instance, xfer->report_id, xfer->report_type, xfer->len);
+  }
+
+  while (event_next < event_count && events[event_next].time_us <= host_now_us)
+  {
+    replay_event_t* event = &events[event_next++];
+    switch (event->kind)
+    {
+    case 'M': deliver_mount(event); break;
+    case 'R': deliver_report(event); break;
+    case 'U': deliver_unmount(event); break;
+    }
+  }
+
+  if (++spins > REPLAY_SPIN_MAX)
+  {
+    fprintf(stderr, "replay: main loop spins without waiting at %lu us\n", (unsigned long)host_now_us);
+    exit(1);
+  }
+}
+
+// sleeps until the deadline or the next capture event, whichever is first
+static void replay_wait(uint64_t deadline_us)
+{
+  pass_end();
+
+  uint64_t end_us = (event_count ? events[event_count - 1].time_us : 0) + REPLAY_TAIL_US;
+  uint64_t wake_us = deadline_us;
+
+  if (xfer_count) wake_us = host_now_us;
+  if (event_next < event_count && events[event_next].time_us < wake_us) wake_us = events[event_next].time_us;
+  if (wake_us > end_us && event_next == event_count) longjmp(replay_done, 1);
+
+  // a wait that neither sleeps nor has work due is part of a busy spin
+  if (wake_us > host_now_us) host_now_us = wake_us;
+  else if (!xfer_count && (event_next == event_count || events[event_next].time_us > host_now_us)) return;
+  spins = 0;
+}
+
+bool tuh_vid_pid_get(uint8_t daddr, uint16_t* vid, uint16_t* pid)
+{
+  *vid = devices[daddr].vid;
+  *pid = devices[daddr].pid;
+  return devices[daddr].itf_count != 0;
+}
+
+uint8_t tuh_hid_interface_protocol(uint8_t dev_addr, uint8_t idx)
+{
+  return devices[dev_addr].itfs[idx].protocol;
+}
+
+bool tuh_hid_itf_get_info(uint8_t daddr, uint8_t idx, tuh_itf_info_t* itf_info)
+{
+  if (!devices[daddr].itfs[idx].mounted) return false;
+
+  *itf_info = (tuh_itf_info_t){ .daddr = daddr };
+  itf_info->desc.bInterfaceNumber = idx;
+  itf_info->desc.bInterfaceClass = 3;
+  itf_info->desc.bInterfaceProtocol = devices[daddr].itfs[idx].protocol;
+  return true;
+}
+
+static replay_xfer_t* xfer_queue(uint8_t dev_addr, uint8_t instance)
+{
+  if (xfer_count == REPLAY_XFERS) return NULL;
+  replay_xfer_t* xfer = &xfers[xfer_count++];
+  *xfer = (replay_xfer_t){ .dev_addr = dev_addr, .instance = instance };
+  return xfer;
+}
+
+// the interface number is the instance, see tuh_hid_itf_get_info
+bool tuh_descriptor_get_hid_report(uint8_t daddr, uint8_t itf_num, uint8_t desc_type, uint8_t index,
+                                   void* buffer, uint16_t len, tuh_xfer_cb_t complete_cb, uintptr_t user_data)
+{
+  replay_itf_t const* itf = &devices[daddr].itfs[itf_num];
+  if (!itf->mounted || desc_type != HID_DESC_TYPE_REPORT) return false;
+
+  replay_xfer_t* xfer = xfer_queue(daddr, itf_num);
+  if (!xfer) return false;
+
+  // the device sends no more than was asked for
+  uint16_t actual = TU_MIN(len, itf->desc_len);
+  memcpy(buffer, itf->desc, actual);
+
+  xfer->desc = true;
+  xfer->xfer = (tuh_xfer_t){ .daddr = daddr, .result = XFER_RESULT_SUCCESS, .actual_len = actual,
+    .buflen = len, .buffer = buffer, .complete_cb = complete_cb, .user_data = user_data };
+  return true;
+}
+
+bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t idx)
+{
+  return devices[dev_addr].itfs[idx].mounted;
+}
+
+bool tuh_hid_send_report(uint8_t dev_addr, uint8_t idx, uint8_t report_id, const void* report, uint16_t len)
+{
+  return devices[dev_addr].itfs[idx].mounted;
+}
+
+bool tuh_hid_set_report(uint8_t dev_addr, uint8_t idx, uint8_t report_id, uint8_t report_type,
+                        void* report, uint16_t len)
+{
+  if (!devices[dev_addr].itfs[idx].mounted) return false;
+
+  replay_xfer_t* xfer = xfer_queue(dev_addr, idx);
+  if (!xfer) return false;
+
+  xfer->report_id = report_id;
+  xfer->report_type = report_type;
+  xfer->len = len;
+  return true;
+}
+
+bool tuh_xinput_receive_report(uint8_t dev_addr, uint8_t instance)
+{
+  return devices[dev_addr].itfs[instance].mounted;
+}
+
+bool tuh_xinput_set_led(uint8_t dev_addr, uint8_t instance, uint8_t quadrant, bool block)
+{
+  return true;
+}
+
+bool tuh_xinput_set_rumble(uint8_t dev_addr, uint8_t instance, uint8_t lValue, uint8_t rValue, bool block)
+{
+  return true;
+}
+
+bool tuh_xinput_init_chatpad(uint8_t dev_addr, uint8_t instance, bool block)
+{
+  return true;
+}
+
+// top level report ids and usages, as tinyusb's hid host parses them
+uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t* report_info_arr, uint8_t arr_count,
+                                        uint8_t const* desc_report, uint16_t desc_len)
+{
+  tuh_hid_report_info_t* info = report_info_arr;
+  uint8_t depth = 0;
+  uint16_t usage_page = 0;
+  uint8_t usage = 0;
+
+  memset(report_info_arr, 0, arr_count * sizeof(tuh_hid_report_info_t));
+
+  while (desc_len && arr_count)
+  {
+    uint8_t header = *desc_report;
+    uint8_t size = header & 0x03;
+    if (size == 3) size = 4;
+    if (desc_len < 1 + size) break;
+
+    uint32_t data = 0;
+    for (uint8_t i = 0; i < size; i++) data |= (uint32_t)desc_report[1 + i] << (8 * i);
+
+    switch (header & 0xfc)
+    {
+    case 0xa0: // collection
+      if (!depth)
+      {
+        info->usage_page = usage_page;
+        info->usage = usage;
+      }
+      depth++;
+      break;
+    case 0xc0: // end collection
+      if (depth && !--depth)
+      {
+        info++;
+        arr_count--;
+      }
+      break;
+    case 0x84: // report id
+      if (depth == 1 && info->report_id && info->report_id != data)
+      {
+        // a second id in one collection starts another report
+        info++;
+        arr_count--;
+        if (!arr_count) break;
+        info->usage_page = usage_page;
+        info->usage = usage;
+      }
+      info->report_id = data;
+      break;
+    case 0x04: // usage page
+      usage_page = data;
+      break;
+    case 0x08: // usage
+      if (!depth) usage = data;
+      break;
+    }
+
+    desc_report += 1 + size;
+    desc_len -= 1 + size;
+  }
+
+  return info - report_info_arr;
+}
+
+//--------------------------------------------------------------------+
+// main
+//--------------------------------------------------------------------+
+int main(int argc, char** argv)
+{
+  const char* path = NULL;
+  bool quiet = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-q")) quiet = true;
+    else if (!strcmp(argv[i], "-s")) state_lines = true;
+    else if (!strcmp(argv[i], "-t") && i + 1 < argc) host_now_us = strtoull(argv[++i], NULL, 0);
+    else path = argv[i];
+  }
+
+  if (!path)
+  {
+    fprintf(stderr, "usage: %s <capture> [-q] [-s] [-t <boot_us>]\n", argv[0]);
+    return 2;
+  }
+
+  if (!load_capture(path)) return 1;
+
+  // unbuffered, so the firmware's output interleaves as it happened
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  host_wait = replay_wait;
+  if (!setjmp(replay_done)) usbretro_main();
+  if (state_lines) state_print();
+
+  fflush(stdout);
+  if (!quiet) driver_summary();
+  return 0;
+}
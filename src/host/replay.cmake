@@ -0,0 +1,44 @@
+# replay.cmake - runs one capture and compares the trace with its golden file
+#
+# cmake -DREPLAY=<exe> -DCAPTURE=<trace> -DGOLDEN=<file> -DOUTPUT=<file> [-DSTATE=ON] [-DUPDATE=ON] -P replay.cmake
+#
+# Only trace lines are compared (common/trace.h) plus the DEVICE: lines that
+# name the driver each interface was classified to. The per-driver timing
+# summary is printed, never compared. With STATE, only the S lines of
+# replay -s are compared: the player state the console reads.
+
+if(STATE)
+    set(FLAGS -s)
+    set(KINDS "S [^\n]*")
+else()
+    set(FLAGS "")
+    set(KINDS "[MdUFD] [^\n]*|DEVICE:[^\n]*")
+endif()
+
+execute_process(
+    COMMAND ${REPLAY} ${CAPTURE} ${FLAGS}
+    OUTPUT_VARIABLE STDOUT
+    ERROR_VARIABLE STDERR
+    RESULT_VARIABLE RESULT)
+
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "${REPLAY} ${CAPTURE} failed (${RESULT}):\n${STDERR}")
+endif()
+message("${STDERR}")
+
+string(REGEX MATCHALL "(^|\n)(${KINDS})" LINES "${STDOUT}")
+string(REPLACE ";" "" TRACE "${LINES}")
+string(REGEX REPLACE "^\n" "" TRACE "${TRACE}")
+get_filename_component(OUTPUT_DIR ${OUTPUT} DIRECTORY)
+file(MAKE_DIRECTORY ${OUTPUT_DIR})
+file(WRITE ${OUTPUT} "${TRACE}\n")
+
+if(UPDATE)
+    file(COPY_FILE ${OUTPUT} ${GOLDEN})
+    return()
+endif()
+
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${OUTPUT} ${GOLDEN} RESULT_VARIABLE DIFFERENT)
+if(DIFFERENT)
+    message(FATAL_ERROR "${OUTPUT} differs from ${GOLDEN}")
+endif()
@@ -0,0 +1,16 @@
+// GamecubeConsole.h - host shim: the replay plays the console side
+
+#ifndef HOST_GAMECUBECONSOLE_H
+#define HOST_GAMECUBECONSOLE_H
+
+#include "pico.h"
+#include "hardware/pio.h"
+#include "lib/joybus-pio/include/gamecube_definitions.h"
+
+typedef struct
+{
+  GamecubeMode mode;
+  gc_report_t report; // last report sent
+} GamecubeConsole;
+
+#endif // HOST_GAMECUBECONSOLE_H
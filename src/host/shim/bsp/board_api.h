@@ -0,0 +1,11 @@
+// bsp/board_api.h - host shim
+
+#ifndef HOST_BSP_BOARD_API_H
+#define HOST_BSP_BOARD_API_H
+
+#include "pico.h"
+
+void board_init(void);
+uint32_t board_millis(void);
+
+#endif // HOST_BSP_BOARD_API_H
@@ -0,0 +1,36 @@
+// hardware/dma.h - host shim: a channel paced by a pio dreq moves words into
+// that state machine's tx fifo whenever it has room
+
+#ifndef HOST_HARDWARE_DMA_H
+#define HOST_HARDWARE_DMA_H
+
+#include "pico.h"
+
+enum dma_channel_transfer_size
+{
+  DMA_SIZE_8 = 0,
+  DMA_SIZE_16 = 1,
+  DMA_SIZE_32 = 2,
+};
+
+typedef struct
+{
+  uint32_t ctrl;
+} dma_channel_config;
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size) {}
+static inline void channel_config_set_read_increment(dma_channel_config* c, bool incr) {}
+static inline void channel_config_set_write_increment(dma_channel_config* c, bool incr) {}
+static inline void channel_config_set_dreq(dma_channel_config* c, uint dreq) { c->ctrl = dreq; }
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger);
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void* read_addr, uint32_t transfer_count);
+void dma_channel_abort(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+bool dma_channel_is_busy(uint channel);
+
+#endif // HOST_HARDWARE_DMA_H
@@ -0,0 +1,23 @@
+// hardware/i2c.h - host shim, writes are recorded for the console model
+
+#ifndef HOST_HARDWARE_I2C_H
+#define HOST_HARDWARE_I2C_H
+
+#include "pico.h"
+
+typedef struct i2c_inst
+{
+  int index;
+} i2c_inst_t;
+
+extern i2c_inst_t host_i2c[2];
+#define i2c0 (&host_i2c[0])
+#define i2c1 (&host_i2c[1])
+
+uint i2c_init(i2c_inst_t* i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t len, bool nostop);
+size_t i2c_get_read_available(i2c_inst_t* i2c);
+void i2c_read_raw_blocking(i2c_inst_t* i2c, uint8_t* dst, size_t len);
+void i2c_write_raw_blocking(i2c_inst_t* i2c, const uint8_t* src, size_t len);
+
+#endif // HOST_HARDWARE_I2C_H
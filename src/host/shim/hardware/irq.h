@@ -0,0 +1,15 @@
+// hardware/irq.h - host shim
+
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+
+#include "pico.h"
+
+#define PIO0_IRQ_0 7
+#define PIO0_IRQ_1 8
+#define PIO1_IRQ_0 9
+#define PIO1_IRQ_1 10
+
+void irq_clear(uint num);
+
+#endif // HOST_HARDWARE_IRQ_H
@@ -0,0 +1,110 @@
+// hardware/pio.h - host shim: fifos, program memory and pc of each state
+// machine. the console models in the replay play the other end of the fifos.
+
+#ifndef HOST_HARDWARE_PIO_H
+#define HOST_HARDWARE_PIO_H
+
+#include "pico.h"
+#include "hardware/gpio.h"
+
+#define PIO_INSTRUCTION_COUNT 32
+#define NUM_PIO_STATE_MACHINES 4
+
+typedef struct pio_hw
+{
+  volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+  volatile uint32_t rxf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t* PIO;
+
+extern pio_hw_t host_pio[2];
+#define pio0 (&host_pio[0])
+#define pio1 (&host_pio[1])
+
+struct pio_program
+{
+  const uint16_t* instructions;
+  uint8_t length;
+  int8_t origin;
+};
+typedef struct pio_program pio_program_t;
+
+enum pio_fifo_join
+{
+  PIO_FIFO_JOIN_NONE = 0,
+  PIO_FIFO_JOIN_TX = 1,
+  PIO_FIFO_JOIN_RX = 2,
+};
+
+typedef struct
+{
+  uint wrap_target;
+  uint wrap;
+  enum pio_fifo_join join;
+} pio_sm_config;
+
+enum pio_interrupt_source
+{
+  pis_interrupt0 = 8,
+  pis_sm0_tx_fifo_not_full = 4,
+  pis_sm0_rx_fifo_not_empty = 0,
+};
+
+static inline pio_sm_config pio_get_default_sm_config(void)
+{
+  pio_sm_config c = { 0, 31, PIO_FIFO_JOIN_NONE };
+  return c;
+}
+
+static inline void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap)
+{
+  c->wrap_target = wrap_target;
+  c->wrap = wrap;
+}
+
+static inline void sm_config_set_fifo_join(pio_sm_config* c, enum pio_fifo_join join)
+{
+  c->join = join;
+}
+
+// pin, shift and clock setup has nothing to model on the host
+static inline void sm_config_set_in_pins(pio_sm_config* c, uint in_base) {}
+static inline void sm_config_set_out_pins(pio_sm_config* c, uint out_base, uint out_count) {}
+static inline void sm_config_set_set_pins(pio_sm_config* c, uint set_base, uint set_count) {}
+static inline void sm_config_set_sideset_pins(pio_sm_config* c, uint sideset_base) {}
+static inline void sm_config_set_sideset(pio_sm_config* c, uint bit_count, bool optional, bool pindirs) {}
+static inline void sm_config_set_jmp_pin(pio_sm_config* c, uint pin) {}
+static inline void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold) {}
+static inline void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold) {}
+static inline void sm_config_set_clkdiv(pio_sm_config* c, float div) {}
+static inline void pio_gpio_init(PIO pio, uint pin) {}
+static inline void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {}
+
+// program memory, 32 instructions per pio (panics when full, like the sdk)
+uint pio_add_program(PIO pio, const pio_program_t* program);
+int pio_claim_unused_sm(PIO pio, bool required);
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+
+static inline uint pio_encode_jmp(uint addr)
+{
+  return 0x0000 | (addr & 0x1f);
+}
+
+// fifos
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+uint32_t pio_sm_get(PIO pio, uint sm);
+uint32_t pio_sm_get_blocking(PIO pio, uint sm);
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled);
+
+#endif // HOST_HARDWARE_PIO_H
@@ -0,0 +1,17 @@
+// hardware/structs/scb.h - host shim
+
+#ifndef HOST_HARDWARE_STRUCTS_SCB_H
+#define HOST_HARDWARE_STRUCTS_SCB_H
+
+#include "pico.h"
+
+typedef struct
+{
+  uint32_t scr;
+} scb_hw_t;
+
+extern scb_hw_t* scb_hw;
+
+#define M0PLUS_SCR_SEVONPEND_BITS 0x00000010
+
+#endif // HOST_HARDWARE_STRUCTS_SCB_H
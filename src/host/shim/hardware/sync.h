@@ -0,0 +1,19 @@
+// hardware/sync.h - host shim: barriers are real fences, events wake core1
+
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include "pico.h"
+
+static inline void __dmb(void)
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void __sev(void);
+void __wfe(void);
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+#endif // HOST_HARDWARE_SYNC_H
@@ -0,0 +1,5 @@
+// joybus.pio.h - host shim, the joybus program is loaded by GamecubeConsole_init
+
+#pragma once
+
+#include "hardware/pio.h"
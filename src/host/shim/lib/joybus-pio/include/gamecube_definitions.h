@@ -0,0 +1,156 @@
+// gamecube_definitions.h - host shim of the joybus-pio report layout
+
+#ifndef HOST_GAMECUBE_DEFINITIONS_H
+#define HOST_GAMECUBE_DEFINITIONS_H
+
+#include <stdint.h>
+
+typedef enum
+{
+  GamecubeMode_0 = 0,
+  GamecubeMode_1,
+  GamecubeMode_2,
+  GamecubeMode_3,
+  GamecubeMode_4,
+  GamecubeMode_KB = 0x54,
+} GamecubeMode;
+
+typedef union
+{
+  struct __attribute__((packed))
+  {
+    uint8_t a : 1;
+    uint8_t b : 1;
+    uint8_t x : 1;
+    uint8_t y : 1;
+    uint8_t start : 1;
+    uint8_t origin : 1;
+    uint8_t err_latch : 1;
+    uint8_t err_stat : 1;
+
+    uint8_t dpad_left : 1;
+    uint8_t dpad_right : 1;
+    uint8_t dpad_down : 1;
+    uint8_t dpad_up : 1;
+    uint8_t z : 1;
+    uint8_t r : 1;
+    uint8_t l : 1;
+    uint8_t high1 : 1;
+
+    uint8_t stick_x;
+    uint8_t stick_y;
+    uint8_t cstick_x;
+    uint8_t cstick_y;
+    uint8_t l_analog;
+    uint8_t r_analog;
+  };
+  struct __attribute__((packed))
+  {
+    uint8_t counter : 4;
+    uint8_t unknown : 4;
+    uint8_t pad[3];
+    uint8_t keypress[3];
+    uint8_t checksum;
+  } keyboard;
+} gc_report_t;
+
+static const gc_report_t default_gc_report = {
+  .high1 = 1,
+  .stick_x = 128,
+  .stick_y = 128,
+  .cstick_x = 128,
+  .cstick_y = 128,
+};
+
+static const gc_report_t default_gc_kb_report = {
+  .keyboard = { 0 },
+};
+
+// keyboard scan codes
+#define GC_KEY_HOME         0x06
+#define GC_KEY_END          0x07
+#define GC_KEY_PAGEUP       0x08
+#define GC_KEY_PAGEDOWN     0x09
+#define GC_KEY_SCROLLLOCK   0x0A
+#define GC_KEY_A            0x10
+#define GC_KEY_B            0x11
+#define GC_KEY_C            0x12
+#define GC_KEY_D            0x13
+#define GC_KEY_E            0x14
+#define GC_KEY_F            0x15
+#define GC_KEY_G            0x16
+#define GC_KEY_H            0x17
+#define GC_KEY_I            0x18
+#define GC_KEY_J            0x19
+#define GC_KEY_K            0x1A
+#define GC_KEY_L            0x1B
+#define GC_KEY_M            0x1C
+#define GC_KEY_N            0x1D
+#define GC_KEY_O            0x1E
+#define GC_KEY_P            0x1F
+#define GC_KEY_Q            0x20
+#define GC_KEY_R            0x21
+#define GC_KEY_S            0x22
+#define GC_KEY_T            0x23
+#define GC_KEY_U            0x24
+#define GC_KEY_V            0x25
+#define GC_KEY_W            0x26
+#define GC_KEY_X            0x27
+#define GC_KEY_Y            0x28
+#define GC_KEY_Z            0x29
+#define GC_KEY_1            0x2A
+#define GC_KEY_2            0x2B
+#define GC_KEY_3            0x2C
+#define GC_KEY_4            0x2D
+#define GC_KEY_5            0x2E
+#define GC_KEY_6            0x2F
+#define GC_KEY_7            0x30
+#define GC_KEY_8            0x31
+#define GC_KEY_9            0x32
+#define GC_KEY_0            0x33
+#define GC_KEY_MINUS        0x34
+#define GC_KEY_CARET        0x35
+#define GC_KEY_YEN          0x36
+#define GC_KEY_AT           0x37
+#define GC_KEY_LEFTBRACKET  0x38
+#define GC_KEY_SEMICOLON    0x39
+#define GC_KEY_COLON        0x3A
+#define GC_KEY_RIGHTBRACKET 0x3B
+#define GC_KEY_COMMA        0x3C
+#define GC_KEY_PERIOD       0x3D
+#define GC_KEY_SLASH        0x3E
+#define GC_KEY_BACKSLASH    0x3F
+#define GC_KEY_F1           0x40
+#define GC_KEY_F2           0x41
+#define GC_KEY_F3           0x42
+#define GC_KEY_F4           0x43
+#define GC_KEY_F5           0x44
+#define GC_KEY_F6           0x45
+#define GC_KEY_F7           0x46
+#define GC_KEY_F8           0x47
+#define GC_KEY_F9           0x48
+#define GC_KEY_F10          0x49
+#define GC_KEY_F11          0x4A
+#define GC_KEY_F12          0x4B
+#define GC_KEY_ESC          0x4C
+#define GC_KEY_INSERT       0x4D
+#define GC_KEY_DELETE       0x4E
+#define GC_KEY_GRAVE        0x4F
+#define GC_KEY_BACKSPACE    0x50
+#define GC_KEY_TAB          0x51
+#define GC_KEY_CAPSLOCK     0x53
+#define GC_KEY_LEFTSHIFT    0x54
+#define GC_KEY_RIGHTSHIFT   0x55
+#define GC_KEY_LEFTCTRL     0x56
+#define GC_KEY_LEFTALT      0x57
+#define GC_KEY_LEFTUNK1     0x58
+#define GC_KEY_SPACE        0x59
+#define GC_KEY_RIGHTUNK1    0x5A
+#define GC_KEY_RIGHTUNK2    0x5B
+#define GC_KEY_LEFT         0x5C
+#define GC_KEY_DOWN         0x5D
+#define GC_KEY_UP           0x5E
+#define GC_KEY_RIGHT        0x5F
+#define GC_KEY_ENTER        0x61
+
+#endif // HOST_GAMECUBE_DEFINITIONS_H
@@ -0,0 +1,22 @@
+// pico.h - host shim of the pico-sdk base header
+
+#ifndef HOST_PICO_H
+#define HOST_PICO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef unsigned int uint;
+
+// microseconds of virtual time, advanced by the replay (see host.h)
+typedef uint64_t absolute_time_t;
+
+// everything runs from host memory
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __not_in_flash(group)
+
+#endif // HOST_PICO_H
@@ -0,0 +1,17 @@
+// pico/multicore.h - host shim: the replay runs core0 only, core1_entry is
+// recorded but never started (see host.h)
+
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include "pico.h"
+
+void multicore_launch_core1(void (*entry)(void));
+
+// there is no second core to park while flash is written
+void multicore_lockout_victim_init(void);
+bool multicore_lockout_victim_is_initialized(uint core_num);
+void multicore_lockout_start_blocking(void);
+void multicore_lockout_end_blocking(void);
+
+#endif // HOST_PICO_MULTICORE_H
@@ -0,0 +1,19 @@
+// pico/stdlib.h - host shim: stdio, plus pico/time.h and hardware/gpio.h
+
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include "pico.h"
+
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+static inline void tight_loop_contents(void) {}
+
+// pico_bit_ops
+uint32_t __rev(uint32_t bits);
+
+bool stdio_init_all(void);
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+
+#endif // HOST_PICO_STDLIB_H
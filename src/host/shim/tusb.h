@@ -0,0 +1,445 @@
+// tusb.h - host shim of the tinyusb host api used by usbretro
+//
+// Only what the firmware touches: hid and keyboard/mouse definitions, the
+// host class calls (served by the replay, see host.c) and the callbacks the
+// firmware implements.
+
+#ifndef HOST_TUSB_H
+#define HOST_TUSB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "pico.h"
+#include "pico/time.h" // as osal_pico.h
+
+#define OPT_MCU_RP2040 1800
+#define OPT_MODE_HOST  0x02
+#define OPT_OS_NONE    1
+#define CFG_TUSB_MCU   OPT_MCU_RP2040
+#include "tusb_config.h"
+
+#define TU_ATTR_PACKED __attribute__((packed))
+#define TU_ATTR_WEAK   __attribute__((weak))
+#define TU_ARRAY_SIZE(_arr) (sizeof(_arr) / sizeof(_arr[0]))
+#define TU_MIN(_x, _y) (((_x) < (_y)) ? (_x) : (_y))
+#define TU_MAX(_x, _y) (((_x) > (_y)) ? (_x) : (_y))
+#define TU_BIT(n) (1UL << (n))
+#define TU_LOG1(...)
+#define TU_LOG2(...)
+
+//--------------------------------------------------------------------+
+// HID
+//--------------------------------------------------------------------+
+enum
+{
+  HID_ITF_PROTOCOL_NONE = 0,
+  HID_ITF_PROTOCOL_KEYBOARD = 1,
+  HID_ITF_PROTOCOL_MOUSE = 2,
+};
+
+typedef enum
+{
+  HID_REPORT_TYPE_INVALID = 0,
+  HID_REPORT_TYPE_INPUT,
+  HID_REPORT_TYPE_OUTPUT,
+  HID_REPORT_TYPE_FEATURE,
+} hid_report_type_t;
+
+enum
+{
+  HID_DESC_TYPE_HID = 0x21,
+  HID_DESC_TYPE_REPORT = 0x22,
+  HID_DESC_TYPE_PHYSICAL = 0x23,
+};
+
+enum
+{
+  HID_USAGE_PAGE_DESKTOP = 0x01,
+  HID_USAGE_PAGE_SIMULATE = 0x02,
+  HID_USAGE_PAGE_KEYBOARD = 0x07,
+  HID_USAGE_PAGE_LED = 0x08,
+  HID_USAGE_PAGE_BUTTON = 0x09,
+  HID_USAGE_PAGE_CONSUMER = 0x0c,
+  HID_USAGE_PAGE_VENDOR = 0xFF00,
+};
+
+enum
+{
+  HID_USAGE_DESKTOP_POINTER = 0x01,
+  HID_USAGE_DESKTOP_MOUSE = 0x02,
+  HID_USAGE_DESKTOP_JOYSTICK = 0x04,
+  HID_USAGE_DESKTOP_GAMEPAD = 0x05,
+  HID_USAGE_DESKTOP_KEYBOARD = 0x06,
+  HID_USAGE_DESKTOP_KEYPAD = 0x07,
+  HID_USAGE_DESKTOP_X = 0x30,
+  HID_USAGE_DESKTOP_Y = 0x31,
+  HID_USAGE_DESKTOP_Z = 0x32,
+  HID_USAGE_DESKTOP_RX = 0x33,
+  HID_USAGE_DESKTOP_RY = 0x34,
+  HID_USAGE_DESKTOP_RZ = 0x35,
+  HID_USAGE_DESKTOP_SLIDER = 0x36,
+  HID_USAGE_DESKTOP_DIAL = 0x37,
+  HID_USAGE_DESKTOP_WHEEL = 0x38,
+  HID_USAGE_DESKTOP_HAT_SWITCH = 0x39,
+  HID_USAGE_DESKTOP_DPAD_UP = 0x90,
+  HID_USAGE_DESKTOP_DPAD_DOWN = 0x91,
+  HID_USAGE_DESKTOP_DPAD_RIGHT = 0x92,
+  HID_USAGE_DESKTOP_DPAD_LEFT = 0x93,
+};
+
+typedef enum
+{
+  KEYBOARD_MODIFIER_LEFTCTRL = TU_BIT(0),
+  KEYBOARD_MODIFIER_LEFTSHIFT = TU_BIT(1),
+  KEYBOARD_MODIFIER_LEFTALT = TU_BIT(2),
+  KEYBOARD_MODIFIER_LEFTGUI = TU_BIT(3),
+  KEYBOARD_MODIFIER_RIGHTCTRL = TU_BIT(4),
+  KEYBOARD_MODIFIER_RIGHTSHIFT = TU_BIT(5),
+  KEYBOARD_MODIFIER_RIGHTALT = TU_BIT(6),
+  KEYBOARD_MODIFIER_RIGHTGUI = TU_BIT(7),
+} hid_keyboard_modifier_bm_t;
+
+typedef enum
+{
+  KEYBOARD_LED_NUMLOCK = TU_BIT(0),
+  KEYBOARD_LED_CAPSLOCK = TU_BIT(1),
+  KEYBOARD_LED_SCROLLLOCK = TU_BIT(2),
+  KEYBOARD_LED_COMPOSE = TU_BIT(3),
+  KEYBOARD_LED_KANA = TU_BIT(4),
+} hid_keyboard_led_bm_t;
+
+typedef enum
+{
+  MOUSE_BUTTON_LEFT = TU_BIT(0),
+  MOUSE_BUTTON_RIGHT = TU_BIT(1),
+  MOUSE_BUTTON_MIDDLE = TU_BIT(2),
+  MOUSE_BUTTON_BACKWARD = TU_BIT(3),
+  MOUSE_BUTTON_FORWARD = TU_BIT(4),
+} hid_mouse_button_bm_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t modifier;
+  uint8_t reserved;
+  uint8_t keycode[6];
+} hid_keyboard_report_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t buttons;
+  int8_t x;
+  int8_t y;
+  int8_t wheel;
+  int8_t pan;
+} hid_mouse_report_t;
+
+#define HID_KEY_A              0x04
+#define HID_KEY_B              0x05
+#define HID_KEY_C              0x06
+#define HID_KEY_D              0x07
+#define HID_KEY_E              0x08
+#define HID_KEY_F              0x09
+#define HID_KEY_G              0x0A
+#define HID_KEY_H              0x0B
+#define HID_KEY_I              0x0C
+#define HID_KEY_J              0x0D
+#define HID_KEY_K              0x0E
+#define HID_KEY_L              0x0F
+#define HID_KEY_M              0x10
+#define HID_KEY_N              0x11
+#define HID_KEY_O              0x12
+#define HID_KEY_P              0x13
+#define HID_KEY_Q              0x14
+#define HID_KEY_R              0x15
+#define HID_KEY_S              0x16
+#define HID_KEY_T              0x17
+#define HID_KEY_U              0x18
+#define HID_KEY_V              0x19
+#define HID_KEY_W              0x1A
+#define HID_KEY_X              0x1B
+#define HID_KEY_Y              0x1C
+#define HID_KEY_Z              0x1D
+#define HID_KEY_1              0x1E
+#define HID_KEY_2              0x1F
+#define HID_KEY_3              0x20
+#define HID_KEY_4              0x21
+#define HID_KEY_5              0x22
+#define HID_KEY_6              0x23
+#define HID_KEY_7              0x24
+#define HID_KEY_8              0x25
+#define HID_KEY_9              0x26
+#define HID_KEY_0              0x27
+#define HID_KEY_ENTER          0x28
+#define HID_KEY_ESCAPE         0x29
+#define HID_KEY_BACKSPACE      0x2A
+#define HID_KEY_TAB            0x2B
+#define HID_KEY_SPACE          0x2C
+#define HID_KEY_MINUS          0x2D
+#define HID_KEY_EQUAL          0x2E
+#define HID_KEY_BRACKET_LEFT   0x2F
+#define HID_KEY_BRACKET_RIGHT  0x30
+#define HID_KEY_BACKSLASH      0x31
+#define HID_KEY_EUROPE_1       0x32
+#define HID_KEY_SEMICOLON      0x33
+#define HID_KEY_APOSTROPHE     0x34
+#define HID_KEY_GRAVE          0x35
+#define HID_KEY_COMMA          0x36
+#define HID_KEY_PERIOD         0x37
+#define HID_KEY_SLASH          0x38
+#define HID_KEY_CAPS_LOCK      0x39
+#define HID_KEY_F1             0x3A
+#define HID_KEY_F2             0x3B
+#define HID_KEY_F3             0x3C
+#define HID_KEY_F4             0x3D
+#define HID_KEY_F5             0x3E
+#define HID_KEY_F6             0x3F
+#define HID_KEY_F7             0x40
+#define HID_KEY_F8             0x41
+#define HID_KEY_F9             0x42
+#define HID_KEY_F10            0x43
+#define HID_KEY_F11            0x44
+#define HID_KEY_F12            0x45
+#define HID_KEY_PRINT_SCREEN   0x46
+#define HID_KEY_SCROLL_LOCK    0x47
+#define HID_KEY_PAUSE          0x48
+#define HID_KEY_INSERT         0x49
+#define HID_KEY_HOME           0x4A
+#define HID_KEY_PAGE_UP        0x4B
+#define HID_KEY_DELETE         0x4C
+#define HID_KEY_END            0x4D
+#define HID_KEY_PAGE_DOWN      0x4E
+#define HID_KEY_ARROW_RIGHT    0x4F
+#define HID_KEY_ARROW_LEFT     0x50
+#define HID_KEY_ARROW_DOWN     0x51
+#define HID_KEY_ARROW_UP       0x52
+#define HID_KEY_NUM_LOCK       0x53
+#define HID_KEY_APPLICATION    0x65
+#define HID_KEY_F13            0x68
+#define HID_KEY_F14            0x69
+#define HID_KEY_F15            0x6A
+#define HID_KEY_F16            0x6B
+#define HID_KEY_F17            0x6C
+#define HID_KEY_F18            0x6D
+#define HID_KEY_F19            0x6E
+#define HID_KEY_F20            0x6F
+#define HID_KEY_F21            0x70
+#define HID_KEY_F22            0x71
+#define HID_KEY_F23            0x72
+#define HID_KEY_F24            0x73
+#define HID_KEY_KANJI1         0x87
+#define HID_KEY_KANJI2         0x88
+#define HID_KEY_KANJI3         0x89
+#define HID_KEY_KANJI4         0x8A
+#define HID_KEY_KANJI5         0x8B
+#define HID_KEY_KANJI6         0x8C
+#define HID_KEY_KANJI7         0x8D
+#define HID_KEY_KANJI8         0x8E
+#define HID_KEY_KANJI9         0x8F
+#define HID_KEY_LANG1          0x90
+#define HID_KEY_LANG2          0x91
+#define HID_KEY_LANG3          0x92
+#define HID_KEY_LANG4          0x93
+#define HID_KEY_LANG5          0x94
+#define HID_KEY_LANG6          0x95
+#define HID_KEY_LANG7          0x96
+#define HID_KEY_LANG8          0x97
+#define HID_KEY_LANG9          0x98
+#define HID_KEY_CONTROL_LEFT   0xE0
+#define HID_KEY_SHIFT_LEFT     0xE1
+#define HID_KEY_ALT_LEFT       0xE2
+#define HID_KEY_GUI_LEFT       0xE3
+#define HID_KEY_CONTROL_RIGHT  0xE4
+#define HID_KEY_SHIFT_RIGHT    0xE5
+#define HID_KEY_ALT_RIGHT      0xE6
+#define HID_KEY_GUI_RIGHT      0xE7
+
+#define HID_KEYCODE_TO_ASCII \
+  { 0     , 0      }, /* 0x00 */ \
+  { 0     , 0      }, /* 0x01 */ \
+  { 0     , 0      }, /* 0x02 */ \
+  { 0     , 0      }, /* 0x03 */ \
+  { 'a'   , 'A'    }, /* 0x04 */ \
+  { 'b'   , 'B'    }, /* 0x05 */ \
+  { 'c'   , 'C'    }, /* 0x06 */ \
+  { 'd'   , 'D'    }, /* 0x07 */ \
+  { 'e'   , 'E'    }, /* 0x08 */ \
+  { 'f'   , 'F'    }, /* 0x09 */ \
+  { 'g'   , 'G'    }, /* 0x0a */ \
+  { 'h'   , 'H'    }, /* 0x0b */ \
+  { 'i'   , 'I'    }, /* 0x0c */ \
+  { 'j'   , 'J'    }, /* 0x0d */ \
+  { 'k'   , 'K'    }, /* 0x0e */ \
+  { 'l'   , 'L'    }, /* 0x0f */ \
+  { 'm'   , 'M'    }, /* 0x10 */ \
+  { 'n'   , 'N'    }, /* 0x11 */ \
+  { 'o'   , 'O'    }, /* 0x12 */ \
+  { 'p'   , 'P'    }, /* 0x13 */ \
+  { 'q'   , 'Q'    }, /* 0x14 */ \
+  { 'r'   , 'R'    }, /* 0x15 */ \
+  { 's'   , 'S'    }, /* 0x16 */ \
+  { 't'   , 'T'    }, /* 0x17 */ \
+  { 'u'   , 'U'    }, /* 0x18 */ \
+  { 'v'   , 'V'    }, /* 0x19 */ \
+  { 'w'   , 'W'    }, /* 0x1a */ \
+  { 'x'   , 'X'    }, /* 0x1b */ \
+  { 'y'   , 'Y'    }, /* 0x1c */ \
+  { 'z'   , 'Z'    }, /* 0x1d */ \
+  { '1'   , '!'    }, /* 0x1e */ \
+  { '2'   , '@'    }, /* 0x1f */ \
+  { '3'   , '#'    }, /* 0x20 */ \
+  { '4'   , '$'    }, /* 0x21 */ \
+  { '5'   , '%'    }, /* 0x22 */ \
+  { '6'   , '^'    }, /* 0x23 */ \
+  { '7'   , '&'    }, /* 0x24 */ \
+  { '8'   , '*'    }, /* 0x25 */ \
+  { '9'   , '('    }, /* 0x26 */ \
+  { '0'   , ')'    }, /* 0x27 */ \
+  { '\r'  , '\r'   }, /* 0x28 */ \
+  { '\x1b', '\x1b' }, /* 0x29 */ \
+  { '\b'  , '\b'   }, /* 0x2a */ \
+  { '\t'  , '\t'   }, /* 0x2b */ \
+  { ' '   , ' '    }, /* 0x2c */ \
+  { '-'   , '_'    }, /* 0x2d */ \
+  { '='   , '+'    }, /* 0x2e */ \
+  { '['   , '{'    }, /* 0x2f */ \
+  { ']'   , '}'    }, /* 0x30 */ \
+  { '\\'  , '|'    }, /* 0x31 */ \
+  { '#'   , '~'    }, /* 0x32 */ \
+  { ';'   , ':'    }, /* 0x33 */ \
+  { '\''  , '\"'   }, /* 0x34 */ \
+  { '`'   , '~'    }, /* 0x35 */ \
+  { ','   , '<'    }, /* 0x36 */ \
+  { '.'   , '>'    }, /* 0x37 */ \
+  { '/'   , '?'    }, /* 0x38 */ \
+  { 0     , 0      }, /* 0x39 */ \
+  { 0     , 0      }, /* 0x3a */ \
+  { 0     , 0      }, /* 0x3b */ \
+  { 0     , 0      }, /* 0x3c */ \
+  { 0     , 0      }, /* 0x3d */ \
+  { 0     , 0      }, /* 0x3e */ \
+  { 0     , 0      }, /* 0x3f */ \
+  { 0     , 0      }, /* 0x40 */ \
+  { 0     , 0      }, /* 0x41 */ \
+  { 0     , 0      }, /* 0x42 */ \
+  { 0     , 0      }, /* 0x43 */ \
+  { 0     , 0      }, /* 0x44 */ \
+  { 0     , 0      }, /* 0x45 */ \
+  { 0     , 0      }, /* 0x46 */ \
+  { 0     , 0      }, /* 0x47 */ \
+  { 0     , 0      }, /* 0x48 */ \
+  { 0     , 0      }, /* 0x49 */ \
+  { 0     , 0      }, /* 0x4a */ \
+  { 0     , 0      }, /* 0x4b */ \
+  { 0     , 0      }, /* 0x4c */ \
+  { 0     , 0      }, /* 0x4d */ \
+  { 0     , 0      }, /* 0x4e */ \
+  { 0     , 0      }, /* 0x4f */ \
+  { 0     , 0      }, /* 0x50 */ \
+  { 0     , 0      }, /* 0x51 */ \
+  { 0     , 0      }, /* 0x52 */ \
+  { 0     , 0      }, /* 0x53 */ \
+  { '/'   , '/'    }, /* 0x54 */ \
+  { '*'   , '*'    }, /* 0x55 */ \
+  { '-'   , '-'    }, /* 0x56 */ \
+  { '+'   , '+'    }, /* 0x57 */ \
+  { '\r'  , '\r'   }, /* 0x58 */ \
+  { '1'   , 0      }, /* 0x59 */ \
+  { '2'   , 0      }, /* 0x5a */ \
+  { '3'   , 0      }, /* 0x5b */ \
+  { '4'   , 0      }, /* 0x5c */ \
+  { '5'   , 0      }, /* 0x5d */ \
+  { '6'   , 0      }, /* 0x5e */ \
+  { '7'   , 0      }, /* 0x5f */ \
+  { '8'   , 0      }, /* 0x60 */ \
+  { '9'   , 0      }, /* 0x61 */ \
+  { '0'   , 0      }, /* 0x62 */ \
+  { '.'   , 0      }, /* 0x63 */ \
+  { 0     , 0      }, /* 0x64 */ \
+  { 0     , 0      }, /* 0x65 */ \
+  { 0     , 0      }, /* 0x66 */ \
+  { '='   , '='    }, /* 0x67 */
+
+//--------------------------------------------------------------------+
+// Host
+//--------------------------------------------------------------------+
+typedef enum
+{
+  XFER_RESULT_SUCCESS = 0,
+  XFER_RESULT_FAILED,
+  XFER_RESULT_STALLED,
+  XFER_RESULT_TIMEOUT,
+  XFER_RESULT_INVALID,
+} xfer_result_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint8_t bInterfaceNumber;
+  uint8_t bAlternateSetting;
+  uint8_t bNumEndpoints;
+  uint8_t bInterfaceClass;
+  uint8_t bInterfaceSubClass;
+  uint8_t bInterfaceProtocol;
+  uint8_t iInterface;
+} tusb_desc_interface_t;
+
+typedef struct
+{
+  uint8_t daddr;
+  tusb_desc_interface_t desc;
+} tuh_itf_info_t;
+
+struct tuh_xfer_s;
+typedef struct tuh_xfer_s tuh_xfer_t;
+typedef void (*tuh_xfer_cb_t)(tuh_xfer_t* xfer);
+
+struct tuh_xfer_s
+{
+  uint8_t daddr;
+  uint8_t ep_addr;
+  xfer_result_t result;
+  uint32_t actual_len;
+  uint32_t buflen;
+  uint8_t* buffer;
+  tuh_xfer_cb_t complete_cb;
+  uintptr_t user_data;
+};
+
+typedef struct
+{
+  uint8_t report_id;
+  uint8_t usage;
+  uint16_t usage_page;
+  uint8_t in_len;
+  uint8_t out_len;
+} tuh_hid_report_info_t;
+
+bool tusb_init(void);
+void tuh_task(void);
+
+bool tuh_vid_pid_get(uint8_t daddr, uint16_t* vid, uint16_t* pid);
+bool tuh_descriptor_get_hid_report(uint8_t daddr, uint8_t itf_num, uint8_t desc_type, uint8_t index,
+                                   void* buffer, uint16_t len, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
+
+uint8_t tuh_hid_interface_protocol(uint8_t dev_addr, uint8_t idx);
+bool tuh_hid_itf_get_info(uint8_t daddr, uint8_t idx, tuh_itf_info_t* itf_info);
+bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t idx);
+bool tuh_hid_send_report(uint8_t dev_addr, uint8_t idx, uint8_t report_id, const void* report, uint16_t len);
+bool tuh_hid_set_report(uint8_t dev_addr, uint8_t idx, uint8_t report_id, uint8_t report_type,
+                        void* report, uint16_t len);
+uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t* report_info_arr, uint8_t arr_count,
+                                        uint8_t const* desc_report, uint16_t desc_len);
+
+// implemented by the firmware
+void tuh_mount_cb(uint8_t daddr);
+void tuh_umount_cb(uint8_t daddr);
+void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t idx, uint8_t const* report_desc, uint16_t desc_len);
+void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t idx);
+void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t idx, uint8_t const* report, uint16_t len);
+TU_ATTR_WEAK void tuh_hid_set_report_complete_cb(uint8_t dev_addr, uint8_t idx, uint8_t report_id, uint8_t report_type, uint16_t len);
+
+#endif // HOST_TUSB_H
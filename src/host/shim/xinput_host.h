@@ -0,0 +1,65 @@
+// xinput_host.h - host shim of the tusb_xinput driver interface
+
+#ifndef HOST_XINPUT_HOST_H
+#define HOST_XINPUT_HOST_H
+
+#include "tusb.h"
+
+typedef enum
+{
+  XINPUT_UNKNOWN = 0,
+  XBOXONE,
+  XBOX360_WIRELESS,
+  XBOX360_WIRED,
+  XBOXOG,
+} xinput_type_t;
+
+typedef struct TU_ATTR_PACKED
+{
+  uint16_t wButtons;
+  uint8_t bLeftTrigger;
+  uint8_t bRightTrigger;
+  int16_t sThumbLX;
+  int16_t sThumbLY;
+  int16_t sThumbRX;
+  int16_t sThumbRY;
+} xinput_gamepad_t;
+
+#define XINPUT_GAMEPAD_DPAD_UP        0x0001
+#define XINPUT_GAMEPAD_DPAD_DOWN      0x0002
+#define XINPUT_GAMEPAD_DPAD_LEFT      0x0004
+#define XINPUT_GAMEPAD_DPAD_RIGHT     0x0008
+#define XINPUT_GAMEPAD_START          0x0010
+#define XINPUT_GAMEPAD_BACK           0x0020
+#define XINPUT_GAMEPAD_LEFT_THUMB     0x0040
+#define XINPUT_GAMEPAD_RIGHT_THUMB    0x0080
+#define XINPUT_GAMEPAD_LEFT_SHOULDER  0x0100
+#define XINPUT_GAMEPAD_RIGHT_SHOULDER 0x0200
+#define XINPUT_GAMEPAD_GUIDE          0x0400
+#define XINPUT_GAMEPAD_SHARE          0x0800
+#define XINPUT_GAMEPAD_A              0x1000
+#define XINPUT_GAMEPAD_B              0x2000
+#define XINPUT_GAMEPAD_X              0x4000
+#define XINPUT_GAMEPAD_Y              0x8000
+
+typedef struct
+{
+  xinput_type_t type;
+  uint8_t subtype;
+  uint8_t itf_num;
+  xinput_gamepad_t pad;
+  uint8_t connected;
+  uint8_t new_pad_data;
+} xinputh_interface_t;
+
+bool tuh_xinput_receive_report(uint8_t dev_addr, uint8_t instance);
+bool tuh_xinput_set_led(uint8_t dev_addr, uint8_t instance, uint8_t quadrant, bool block);
+bool tuh_xinput_set_rumble(uint8_t dev_addr, uint8_t instance, uint8_t lValue, uint8_t rValue, bool block);
+bool tuh_xinput_init_chatpad(uint8_t dev_addr, uint8_t instance, bool block);
+
+// implemented by the firmware
+void tuh_xinput_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len);
+void tuh_xinput_mount_cb(uint8_t dev_addr, uint8_t instance, const xinputh_interface_t* xinput_itf);
+void tuh_xinput_umount_cb(uint8_t dev_addr, uint8_t instance);
+
+#endif // HOST_XINPUT_HOST_H
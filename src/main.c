@@ -16,6 +16,11 @@
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
 #include "globals.h"
+#include "latency.h"
+#include "trace.h"
+#include "config.h"
+#include "analog.h"
+#include "mouse.h"
 
 // include console specific handling
 #ifdef CONFIG_NGC
@@ -35,7 +40,40 @@ extern void xinput_task(uint8_t rumble);
 extern void neopixel_init(void);
 extern void neopixel_task(int pat);
 
-extern void players_init(void);
+// deadline scheduled background tasks (microseconds)
+#define NEOPIXEL_INTERVAL_US  10000 // status led animation
+#define OUTPUT_INTERVAL_US     1000 // device rumble/led output, one usb frame
+#define CONFIG_INTERVAL_US     1000 // settings save, only starts right after a frame's polling
+
+typedef struct
+{
+  void (*run)(void);
+  uint32_t interval_us;
+  absolute_time_t next; // 64-bit, never wraps
+} sched_task_t;
+
+static void neopixel_sched(void)
+{
+  neopixel_task(playersCount);
+}
+
+static void output_sched(void)
+{
+  // xinput rumble task
+  xinput_task(gc_rumble);
+
+#if CFG_TUH_HID
+  // hid_device rumble/led task
+  hid_app_task(gc_rumble, gc_kb_led);
+#endif
+}
+
+// next = 0: every task is due on the first pass
+static sched_task_t sched_tasks[] = {
+  { .run = neopixel_sched, .interval_us = NEOPIXEL_INTERVAL_US, .next = 0 },
+  { .run = output_sched,   .interval_us = OUTPUT_INTERVAL_US,   .next = 0 },
+  { .run = config_task,    .interval_us = CONFIG_INTERVAL_US,   .next = 0 },
+};
 
 /*------------- MAIN -------------*/
 
@@ -45,32 +83,51 @@ extern void players_init(void);
 
 //
 // process_signals - inner-loop processing of events:
-//                   - USB polling
-//                   - event processing
+//                   - USB events are serviced on every pass
+//                   - background tasks only run once their deadline is due
+//                   - sleeps until the next deadline, a USB/timer irq, or
+//                     core1 signalling consumed output
 //
 static void __not_in_flash_func(process_signals)(void)
 {
+  const int task_count = sizeof(sched_tasks) / sizeof(sched_tasks[0]);
+
   while (1)
   {
+    uint32_t loop_us = time_us_32();
+
     // tinyusb host task
     tuh_task();
 
-    // neopixel task
-    neopixel_task(playersCount);
-
-    // xinput rumble task
-    xinput_task(gc_rumble);
-
-#if CFG_TUH_HID
-    // hid_device rumble/led task
-    hid_app_task(gc_rumble, gc_kb_led);
+    // publish player output to core1
+    players_task();
 
+#ifdef CONFIG_REPORT_TRACE
+    // print what the usb callbacks queued
+    trace_task();
 #endif
-#ifdef CONFIG_PCE
-    // detection of when a PCE scan is no longer in process (reset period)
-    pce_task();
 
-#endif
+    // run due tasks, then find the nearest deadline
+    absolute_time_t now = get_absolute_time();
+    absolute_time_t next = delayed_by_us(now, NEOPIXEL_INTERVAL_US);
+    for (int i = 0; i < task_count; i++)
+    {
+      sched_task_t* task = &sched_tasks[i];
+      if (absolute_time_diff_us(task->next, now) >= 0)
+      {
+        task->run();
+        task->next = delayed_by_us(now, task->interval_us);
+      }
+      if (absolute_time_diff_us(task->next, next) > 0) next = task->next;
+    }
+
+    latency_loop(time_us_32() - loop_us);
+
+    // nothing left to do until an event or deadline
+    if (!update_pending)
+    {
+      best_effort_wfe_or_timeout(next);
+    }
   }
 }
 
@@ -83,6 +140,12 @@ int main(void)
   // pause briefly for stability before starting activity
   sleep_ms(250);
 
+  config_init(); // replay saved settings, before anything reads them
+
+  analog_init(); // pass-through analog conditioning for every player
+
+  mouse_init(MOUSE_BASE_GAIN); // mouse curves at the console's speed
+
   hid_app_init(); // init hid device interfaces
 
   tusb_init(); // init tinyusb for usb host input
@@ -128,6 +191,9 @@ void tuh_umount_cb(uint8_t dev_addr)
 {
   // application tear-down
   printf("A device with address %d is unmounted \r\n", dev_addr);
+#ifdef CONFIG_REPORT_TRACE
+  trace_unmount(dev_addr);
+#endif
 
   // if ((--playersCount) < 0) playersCount = 0;
   remove_players_by_address(dev_addr, -1);
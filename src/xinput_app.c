@@ -1,34 +1,25 @@
 // xinput_app.c
 #include "tusb.h"
+#include "pico/time.h"
 #include "globals.h"
 #include "xinput_host.h"
-#include <math.h>
+#include "trace.h"
+#include "latency.h"
+#include "spinner.h"
 
-#define PI 3.14159265
+#ifdef CONFIG_NUON
+// right stick spinner steps per stick turn, one per degree
+#define STICK_SPINNER_STEPS 360
+
+static spinner_t stick_spinner = { 0 };
+#endif
 
 uint32_t buttons;
-int16_t jsSpinner = 0;
-int16_t lastAngle = 0;
+static uint8_t jsSpinner = 0;
 int last_player_count = 0; // used by xboxone
 
-extern void __not_in_flash_func(post_globals)(
-  uint8_t dev_addr,
-  int8_t instance,
-  uint32_t buttons,
-  uint8_t analog_1x,
-  uint8_t analog_1y,
-  uint8_t analog_2x,
-  uint8_t analog_2y,
-  uint8_t analog_l,
-  uint8_t analog_r,
-  uint32_t keys,
-  uint8_t quad_x
-);
-
-const double Rad2Deg = 180.0 / PI;
-const double Deg2Rad = PI / 180.0;
-int16_t calcAngle(int16_t x, int16_t y);
 uint8_t byteScaleAnalog(int16_t xbox_val);
+uint8_t nuonScaleAnalog(int32_t xbox_val);
 
 //--------------------------------------------------------------------+
 // USB X-input
@@ -36,6 +27,10 @@ uint8_t byteScaleAnalog(int16_t xbox_val);
 #if CFG_TUH_XINPUT
 void tuh_xinput_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const *report, uint16_t len)
 {
+  latency_report_received();
+#ifdef CONFIG_REPORT_TRACE
+  uint32_t start_us = time_us_32();
+#endif
   xinputh_interface_t *xid_itf = (xinputh_interface_t *)report;
   xinput_gamepad_t *p = &xid_itf->pad;
   const char* type_str;
@@ -54,50 +49,24 @@ void tuh_xinput_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t c
            dev_addr, instance, type_str, p->wButtons, p->bLeftTrigger, p->bRightTrigger, p->sThumbLX, p->sThumbLY, p->sThumbRX, p->sThumbRY);
 
 #ifdef CONFIG_NUON
-    float max_thresh = 32768;
-    float left1X = (128 * (p->sThumbLX / max_thresh)) + ((p->sThumbLX >= 0) ? 127 : 128);
-    float left1Y = (128 * (-1 * p->sThumbLY / max_thresh)) + ((-1 * p->sThumbLY >= 0) ? 127 : 128);
-    float left2X = (128 * (p->sThumbRX / max_thresh)) + ((p->sThumbRX >= 0) ? 127 : 128);
-    float left2Y = (128 * (-1 * p->sThumbRY / max_thresh)) + ((-1 * p->sThumbRY >= 0) ? 127 : 128);
-
-    if (p->sThumbLX == 0) left1X = 127;
-    if (p->sThumbLY == 0) left1Y = 127;
-    if (p->sThumbRX == 0) left2X = 127;
-    if (p->sThumbRY == 0) left2Y = 127;
-
-    // shift axis values for nuon
-    uint8_t analog_1x = left1X+1;
-    uint8_t analog_1y = left1Y+1;
-    uint8_t analog_2x = left2X+1;
-    uint8_t analog_2y = left2Y+1;
-    if (analog_1x == 0) analog_1x = 255;
-    if (analog_1y == 0) analog_1y = 255;
-    if (analog_2x == 0) analog_2x = 255;
-    if (analog_2y == 0) analog_2y = 255;
+    // shift axis values for nuon (y inverted)
+    uint8_t analog_1x = nuonScaleAnalog(p->sThumbLX);
+    uint8_t analog_1y = nuonScaleAnalog(-p->sThumbLY);
+    uint8_t analog_2x = nuonScaleAnalog(p->sThumbRX);
+    uint8_t analog_2y = nuonScaleAnalog(-p->sThumbRY);
 
     // calc right thumb stick angle for simulated spinner
     if (analog_2x < 64 || analog_2x > 192 || analog_2y < 64 || analog_2y > 192) {
-      int16_t angle = 0;
-      angle = calcAngle(analog_2x-128, analog_2y-128)+179; // 0-359 (360deg)
-      // TU_LOG1("x: %d y: %d angle: %d \r\n", analog_2x-128, analog_2y-128, angle+180);
-
-      // get directional difference delta
-      int16_t delta = 0;
-      if (angle >= lastAngle) delta = angle - lastAngle;
-      else delta = (-1) * (lastAngle - angle);
-
-      // check max/min delta value
-      if (delta > 16) delta = 16;
-      if (delta < -16) delta = -16;
+      uint16_t angle = spinner_atan2(analog_2y - 128, analog_2x - 128);
 
-      // inc global spinner value by delta
-      jsSpinner -= delta;
+      // turn since the last sample, the int16 cast takes the short way round
+      int32_t turn = (int16_t)spinner_follow(&stick_spinner, angle);
+      int32_t substeps = turn * (STICK_SPINNER_STEPS * SPINNER_STEP) / SPINNER_TURN;
 
-      // check max/min spinner value
-      if (jsSpinner > 255) jsSpinner -= 255;
-      if (jsSpinner < 0) jsSpinner = 256 - (-1 * jsSpinner);
-
-      lastAngle = angle;
+      // at most 16 degrees per report
+      jsSpinner = spinner_move(&stick_spinner, -substeps, 16 * SPINNER_STEP);
+    } else {
+      spinner_release(&stick_spinner);
     }
 #else
     uint8_t analog_1x = byteScaleAnalog(p->sThumbLX);
@@ -129,7 +98,23 @@ void tuh_xinput_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t c
                ((p->wButtons & XINPUT_GAMEPAD_A) ? 0x00 : 0x20) |
                ((p->wButtons & XINPUT_GAMEPAD_B) ? 0x00 : 0x10));
 
-    post_globals(dev_addr, instance, buttons, analog_1x, analog_1y, analog_2x, analog_2y, analog_l, analog_r, 0, jsSpinner);
+    input_state_t input = {
+      .dev_addr = dev_addr,
+      .instance = instance,
+      .buttons = buttons,
+      .analog_1x = analog_1x,
+      .analog_1y = analog_1y,
+      .analog_2x = analog_2x,
+      .analog_2y = analog_2y,
+      .analog_l = analog_l,
+      .analog_r = analog_r,
+      .quad_x = jsSpinner,
+    };
+    post_input(&input);
+
+#ifdef CONFIG_REPORT_TRACE
+    trace_report('X', xid_itf->type, dev_addr, instance, (uint8_t const*)p, sizeof(xinput_gamepad_t), time_us_32() - start_us);
+#endif
   }
   tuh_xinput_receive_report(dev_addr, instance);
 }
@@ -137,6 +122,11 @@ void tuh_xinput_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t c
 void tuh_xinput_mount_cb(uint8_t dev_addr, uint8_t instance, const xinputh_interface_t *xinput_itf)
 {
   printf("XINPUT MOUNTED %02x %d\n", dev_addr, instance);
+#ifdef CONFIG_REPORT_TRACE
+  uint16_t vid, pid;
+  tuh_vid_pid_get(dev_addr, &vid, &pid);
+  trace_mount('X', dev_addr, instance, vid, pid, xinput_itf->type, NULL, 0);
+#endif
   // If this is a Xbox 360 Wireless controller we need to wait for a connection packet
   // on the in pipe before setting LEDs etc. So just start getting data until a controller is connected.
   if (xinput_itf->type == XBOX360_WIRELESS && xinput_itf->connected == false)
@@ -164,9 +154,14 @@ uint8_t byteScaleAnalog(int16_t xbox_val)
   return scale_val;
 }
 
-int16_t calcAngle(int16_t x, int16_t y)
+// Scales an xbox value from [-32768, 32768] to [1, 255] for nuon, 0 to 128.
+// Matches the former float math: 128 * v / 32768 truncated, offset by 128
+// (or 129 below zero).
+uint8_t nuonScaleAnalog(int32_t xbox_val)
 {
-  return atan2(y, x) * Rad2Deg;
+  int32_t scale_val = (xbox_val >> 8) + ((xbox_val >= 0) ? 128 : 129);
+  if (scale_val > 255) return 255;
+  return scale_val;
 }
 
 void xinput_task(uint8_t rumble)
@@ -182,8 +177,10 @@ void xinput_task(uint8_t rumble)
 
   // update rumble state for xinput device 1.
   unsigned short int i;
-  for (i = 0; i < playersCount; ++i)
+  for (i = 0; i < MAX_PLAYERS; ++i)
   {
+    if (!players[i].dev_addr) continue;
+
     // TODO: throttle and only fire if device is xinput
     // if (players[i].xinput)
     // {